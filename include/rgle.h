@@ -2,4 +2,11 @@
 
 #include "rgle/Application.h"
 #include "rgle/gfx/Spatial.h"
+#include "rgle/gfx/SpatialFile.h"
+#include "rgle/gfx/SpatialPaging.h"
+#include "rgle/gfx/SpatialRaycast.h"
+#include "rgle/gfx/Voxelize.h"
+#include "rgle/ray/CompiledModel.h"
+#include "rgle/ray/Mesh.h"
+#include "rgle/ray/Renderer.h"
 #include "rgle/util/Tester.h"
@@ -0,0 +1,797 @@
+// ray-benchmark.cpp
+
+#include "rgle.h"
+
+using Clock = std::chrono::steady_clock;
+
+double elapsed_ms(Clock::time_point start) {
+	return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+rgle::ray::Scene random_balls(size_t count, std::mt19937& random) {
+	// Keep density constant so the number of balls crossed by a ray is comparable between sizes
+	float extent = 4.0f * std::cbrt(static_cast<float>(count));
+	std::uniform_real_distribution<float> position(-extent, extent);
+	std::uniform_real_distribution<float> radius(0.25f, 1.0f);
+	rgle::ray::Scene scene;
+	scene.scene.reserve(count);
+	for (size_t i = 0; i < count; i++) {
+		auto matrix = glm::translate(glm::mat4(1.0f), glm::vec3(position(random), position(random), position(random)));
+		scene.scene.push_back(std::move(*rgle::ray::transform(rgle::ray::Ball(radius(random)), matrix)));
+	}
+	return scene;
+}
+
+std::vector<rgle::ray::Ray> random_rays(size_t count, float extent, std::mt19937& random) {
+	std::uniform_real_distribution<float> position(-extent, extent);
+	std::vector<rgle::ray::Ray> rays;
+	rays.reserve(count);
+	for (size_t i = 0; i < count; i++) {
+		rays.push_back(rgle::ray::Ray {
+			.eye = glm::vec3(position(random), position(random), position(random)),
+			.target = glm::vec3(position(random), position(random), position(random))
+		});
+	}
+	return rays;
+}
+
+void benchmark_scene_hierarchy(size_t rayCount) {
+	std::cout << "scene hierarchy vs linear scan (" << rayCount << " rays)" << std::endl;
+	std::cout << std::setw(10) << "balls" << std::setw(14) << "build ms" << std::setw(14) << "linear ms"
+		<< std::setw(14) << "bvh ms" << std::setw(10) << "speedup" << std::setw(12) << "mismatch" << std::endl;
+	for (size_t count : { 1000, 10000, 100000 }) {
+		std::mt19937 random(static_cast<unsigned int>(count));
+		auto model = rgle::ray::Model(random_balls(count, random));
+		auto rays = random_rays(rayCount, 4.0f * std::cbrt(static_cast<float>(count)), random);
+
+		std::vector<std::optional<rgle::ray::Intersection>> linear(rays.size());
+		auto start = Clock::now();
+		for (size_t i = 0; i < rays.size(); i++) {
+			linear[i] = model.intersect(rays[i]);
+		}
+		double linearTime = elapsed_ms(start);
+
+		start = Clock::now();
+		std::get<rgle::ray::Scene>(model).build();
+		double buildTime = elapsed_ms(start);
+
+		size_t mismatches = 0;
+		start = Clock::now();
+		for (size_t i = 0; i < rays.size(); i++) {
+			if (model.intersect(rays[i]) != linear[i]) {
+				mismatches++;
+			}
+		}
+		double hierarchyTime = elapsed_ms(start);
+
+		std::cout << std::setw(10) << count << std::fixed << std::setprecision(2)
+			<< std::setw(14) << buildTime << std::setw(14) << linearTime << std::setw(14) << hierarchyTime
+			<< std::setw(9) << linearTime / hierarchyTime << 'x' << std::setw(12) << mismatches << std::endl;
+	}
+}
+
+void benchmark_refit(size_t rayCount) {
+	const size_t count = 10000;
+	const int frames = 60;
+	std::cout << "animated scene refit vs rebuild (" << count << " balls, " << frames << " frames, " << rayCount << " rays per frame)" << std::endl;
+	std::cout << std::setw(10) << "update" << std::setw(14) << "frame ms" << std::setw(14) << "query ms"
+		<< std::setw(10) << "rebuilds" << std::setw(12) << "cost" << std::setw(12) << "mismatch" << std::endl;
+	for (bool refit : { false, true }) {
+		std::mt19937 random(static_cast<unsigned int>(count));
+		auto model = rgle::ray::Model(random_balls(count, random));
+		auto& scene = std::get<rgle::ray::Scene>(model);
+		scene.build();
+		float extent = 4.0f * std::cbrt(static_cast<float>(count));
+		std::vector<glm::vec3> centers, velocities;
+		std::uniform_real_distribution<float> velocity(-0.1f, 0.1f);
+		for (const auto& child : scene.scene) {
+			centers.push_back(std::get<rgle::ray::Transform>(child).transform.affine[3].xyz);
+			velocities.push_back(glm::vec3(velocity(random), velocity(random), velocity(random)));
+		}
+		auto rays = random_rays(rayCount, extent, random);
+
+		double frameTime = 0.0, queryTime = 0.0;
+		size_t rebuilds = 0, mismatches = 0;
+		for (int frame = 0; frame < frames; frame++) {
+			auto start = Clock::now();
+			for (size_t i = 0; i < count; i++) {
+				centers[i] += velocities[i];
+				scene.update(i, rgle::ray::RayTransform(glm::translate(glm::mat4(1.0f), centers[i])));
+			}
+			if (!refit) {
+				scene.build(scene.hierarchy->options());
+				rebuilds++;
+			}
+			else if (scene.refit()) {
+				rebuilds++;
+			}
+			frameTime += elapsed_ms(start);
+
+			start = Clock::now();
+			std::vector<std::optional<rgle::ray::Intersection>> hits(rays.size());
+			for (size_t i = 0; i < rays.size(); i++) {
+				hits[i] = model.intersect(rays[i]);
+			}
+			queryTime += elapsed_ms(start);
+
+			if (frame == frames - 1) {
+				auto hierarchy = scene.hierarchy;
+				scene.hierarchy = nullptr;
+				for (size_t i = 0; i < rays.size(); i++) {
+					if (model.intersect(rays[i]) != hits[i]) {
+						mismatches++;
+					}
+				}
+				scene.hierarchy = hierarchy;
+			}
+		}
+
+		std::cout << std::setw(10) << (refit ? "refit" : "rebuild") << std::fixed << std::setprecision(2)
+			<< std::setw(14) << frameTime / frames << std::setw(14) << queryTime / frames << std::setw(10) << rebuilds
+			<< std::setw(12) << scene.hierarchy->cost() / scene.hierarchy->buildCost() << std::setw(12) << mismatches << std::endl;
+	}
+}
+
+void benchmark_occlusion(size_t rayCount) {
+	std::cout << "any hit occlusion vs closest hit (" << rayCount << " rays)" << std::endl;
+	std::cout << std::setw(10) << "balls" << std::setw(10) << "bvh" << std::setw(14) << "closest ms"
+		<< std::setw(14) << "occluded ms" << std::setw(10) << "speedup" << std::setw(12) << "mismatch" << std::endl;
+	for (size_t count : { 1000, 10000 }) {
+		for (bool hierarchy : { false, true }) {
+			std::mt19937 random(static_cast<unsigned int>(count));
+			auto model = rgle::ray::Model(random_balls(count, random));
+			if (hierarchy) {
+				std::get<rgle::ray::Scene>(model).build();
+			}
+			float extent = 4.0f * std::cbrt(static_cast<float>(count));
+			auto rays = random_rays(rayCount, extent, random);
+
+			std::vector<bool> closest(rays.size());
+			auto start = Clock::now();
+			for (size_t i = 0; i < rays.size(); i++) {
+				closest[i] = model.intersect(rays[i], extent).has_value();
+			}
+			double closestTime = elapsed_ms(start);
+
+			size_t mismatches = 0;
+			start = Clock::now();
+			for (size_t i = 0; i < rays.size(); i++) {
+				if (model.occluded(rays[i], extent) != closest[i]) {
+					mismatches++;
+				}
+			}
+			double occludedTime = elapsed_ms(start);
+
+			std::cout << std::setw(10) << count << std::setw(10) << (hierarchy ? "yes" : "no") << std::fixed << std::setprecision(2)
+				<< std::setw(14) << closestTime << std::setw(14) << occludedTime
+				<< std::setw(9) << closestTime / occludedTime << 'x' << std::setw(12) << mismatches << std::endl;
+		}
+	}
+}
+
+// A complete binary CSG tree, every level transforms its children and alternates union, intersection and clipping
+rgle::ray::Model csg_tree(int depth, std::mt19937& random) {
+	std::uniform_real_distribution<float> offset(-0.75f, 0.75f);
+	if (depth == 0) {
+		return rgle::ray::Model(rgle::ray::Object { .object = std::make_unique<rgle::ray::Ball>(0.5f) });
+	}
+	auto child = [&]() {
+		return std::make_unique<rgle::ray::Model>(rgle::ray::Model(rgle::ray::Transform {
+			.transform = rgle::ray::RayTransform(glm::translate(glm::mat4(1.0f), glm::vec3(offset(random), offset(random), offset(random)))),
+			.model = std::make_unique<rgle::ray::Model>(csg_tree(depth - 1, random))
+		}));
+	};
+	if (depth % 3 == 0) {
+		return rgle::ray::Model(rgle::ray::Clip {
+			.clipPlane = rgle::ray::Plane(glm::vec3(0.0f, offset(random), 0.0f), glm::vec3(0.0f, 1.0f, 0.0f)),
+			.model = std::make_unique<rgle::ray::Model>(rgle::ray::Model(rgle::ray::Or { .lhs = child(), .rhs = child() }))
+		});
+	}
+	else if (depth % 3 == 1) {
+		return rgle::ray::Model(rgle::ray::And { .lhs = child(), .rhs = child() });
+	}
+	return rgle::ray::Model(rgle::ray::Or { .lhs = child(), .rhs = child() });
+}
+
+void benchmark_compiled_model(size_t rayCount) {
+	std::cout << "compiled model vs model tree (" << rayCount << " rays)" << std::endl;
+	std::cout << std::setw(10) << "depth" << std::setw(14) << "compile ms" << std::setw(14) << "tree ms"
+		<< std::setw(14) << "compiled ms" << std::setw(10) << "speedup" << std::setw(12) << "mismatch" << std::endl;
+	for (int depth : { 4, 8, 12 }) {
+		std::mt19937 random(static_cast<unsigned int>(depth));
+		auto model = csg_tree(depth, random);
+		auto rays = random_rays(rayCount, 4.0f, random);
+
+		auto start = Clock::now();
+		auto compiled = rgle::ray::CompiledModel(model);
+		double compileTime = elapsed_ms(start);
+
+		std::vector<std::optional<rgle::ray::Intersection>> expected(rays.size());
+		start = Clock::now();
+		for (size_t i = 0; i < rays.size(); i++) {
+			expected[i] = model.intersect(rays[i]);
+		}
+		double treeTime = elapsed_ms(start);
+
+		size_t mismatches = 0;
+		start = Clock::now();
+		for (size_t i = 0; i < rays.size(); i++) {
+			if (compiled.intersect(rays[i]) != expected[i]) {
+				mismatches++;
+			}
+		}
+		double compiledTime = elapsed_ms(start);
+
+		std::cout << std::setw(10) << depth << std::fixed << std::setprecision(2)
+			<< std::setw(14) << compileTime << std::setw(14) << treeTime << std::setw(14) << compiledTime
+			<< std::setw(9) << treeTime / compiledTime << 'x' << std::setw(12) << mismatches << std::endl;
+	}
+}
+
+void benchmark_batch(size_t rayCount) {
+	std::cout << "batch vs single ray intersect (" << rayCount << " rays)" << std::endl;
+	std::cout << std::setw(10) << "depth" << std::setw(14) << "single ms" << std::setw(14) << "batch ms"
+		<< std::setw(14) << "parallel ms" << std::setw(10) << "speedup" << std::setw(12) << "mismatch" << std::endl;
+	auto pool = rgle::sync::ThreadPool();
+	for (int depth : { 4, 8 }) {
+		std::mt19937 random(static_cast<unsigned int>(depth));
+		auto model = csg_tree(depth, random);
+		auto rays = random_rays(rayCount, 4.0f, random);
+
+		std::vector<std::optional<rgle::ray::Intersection>> expected(rays.size());
+		auto start = Clock::now();
+		for (size_t i = 0; i < rays.size(); i++) {
+			expected[i] = model.intersect(rays[i]);
+		}
+		double singleTime = elapsed_ms(start);
+
+		std::vector<std::optional<rgle::ray::Intersection>> batch(rays.size());
+		start = Clock::now();
+		model.intersect(rays, batch);
+		double batchTime = elapsed_ms(start);
+
+		std::vector<std::optional<rgle::ray::Intersection>> parallel(rays.size());
+		start = Clock::now();
+		model.intersect(rays, parallel, pool);
+		double parallelTime = elapsed_ms(start);
+
+		size_t mismatches = 0;
+		for (size_t i = 0; i < rays.size(); i++) {
+			if (batch[i] != expected[i] || parallel[i] != expected[i]) {
+				mismatches++;
+			}
+		}
+
+		std::cout << std::setw(10) << depth << std::fixed << std::setprecision(2)
+			<< std::setw(14) << singleTime << std::setw(14) << batchTime << std::setw(14) << parallelTime
+			<< std::setw(9) << singleTime / batchTime << 'x' << std::setw(12) << mismatches << std::endl;
+	}
+}
+
+void benchmark_optimize(size_t rayCount) {
+	std::cout << "optimized vs source model (" << rayCount << " rays)" << std::endl;
+	std::cout << std::setw(10) << "model" << std::setw(14) << "optimize ms" << std::setw(14) << "tree ms"
+		<< std::setw(14) << "optimized ms" << std::setw(10) << "speedup" << std::setw(12) << "mismatch" << std::endl;
+	auto build = [](bool csg, std::mt19937& random) {
+		if (csg) {
+			return csg_tree(10, random);
+		}
+		// Balls placed with a translation below a rotation, the kind of nesting a scene graph produces
+		auto scene = random_balls(1000, random);
+		for (auto& model : scene.scene) {
+			model = rgle::ray::Model(rgle::ray::Transform {
+				.transform = rgle::ray::RayTransform(glm::rotate(glm::mat4(1.0f), 0.5f, glm::vec3(0.0f, 1.0f, 0.0f))),
+				.model = std::make_unique<rgle::ray::Model>(std::move(model))
+			});
+		}
+		scene.build();
+		return rgle::ray::Model(std::move(scene));
+	};
+	for (bool csg : { true, false }) {
+		std::mt19937 random(7), copy(7);
+		auto model = build(csg, random);
+		auto start = Clock::now();
+		auto optimized = rgle::ray::optimize(build(csg, copy));
+		double optimizeTime = elapsed_ms(start);
+		auto rays = random_rays(rayCount, csg ? 4.0f : 40.0f, random);
+
+		std::vector<std::optional<rgle::ray::Intersection>> expected(rays.size());
+		start = Clock::now();
+		for (size_t i = 0; i < rays.size(); i++) {
+			expected[i] = model.intersect(rays[i]);
+		}
+		double treeTime = elapsed_ms(start);
+
+		std::vector<std::optional<rgle::ray::Intersection>> actual(rays.size());
+		start = Clock::now();
+		for (size_t i = 0; i < rays.size(); i++) {
+			actual[i] = optimized.intersect(rays[i]);
+		}
+		double optimizedTime = elapsed_ms(start);
+
+		// Concatenated transforms round differently, count hits that appear, vanish or move noticeably
+		size_t mismatches = 0;
+		for (size_t i = 0; i < rays.size(); i++) {
+			if (expected[i].has_value() != actual[i].has_value() || (expected[i] && glm::distance(expected[i]->position, actual[i]->position) > 1e-3f)) {
+				mismatches++;
+			}
+		}
+
+		std::cout << std::setw(10) << (csg ? "csg" : "balls") << std::fixed << std::setprecision(2)
+			<< std::setw(14) << optimizeTime << std::setw(14) << treeTime << std::setw(14) << optimizedTime
+			<< std::setw(9) << treeTime / optimizedTime << 'x' << std::setw(12) << mismatches << std::endl;
+	}
+}
+
+// Coherent rays from a pinhole camera at the origin looking down +z
+std::vector<rgle::ray::Ray> camera_rays(size_t count) {
+	size_t width = static_cast<size_t>(std::sqrt(static_cast<double>(count)));
+	std::vector<rgle::ray::Ray> rays;
+	rays.reserve(count);
+	for (size_t i = 0; i < count; i++) {
+		float u = static_cast<float>(i % width) / static_cast<float>(width) - 0.5f;
+		float v = static_cast<float>(i / width) / static_cast<float>(width) - 0.5f;
+		rays.push_back(rgle::ray::Ray {
+			.eye = glm::vec3(0.0f, 0.0f, -3.0f),
+			.target = glm::vec3(u, v, -2.0f)
+		});
+	}
+	return rays;
+}
+
+template<size_t N, typename Object>
+void benchmark_packet(const std::string& name, const Object& object, const std::vector<rgle::ray::Ray>& rays) {
+	size_t packetCount = rays.size() / N;
+	std::vector<rgle::ray::RayPacket<N>> packets(packetCount);
+	for (size_t i = 0; i < packetCount * N; i++) {
+		packets[i / N].set(i % N, rays[i]);
+	}
+
+	size_t scalarHits = 0;
+	auto start = Clock::now();
+	for (size_t i = 0; i < packetCount * N; i++) {
+		scalarHits += object.intersect(rays[i]).index();
+	}
+	double scalarTime = elapsed_ms(start);
+
+	size_t packetHits = 0;
+	start = Clock::now();
+	for (const auto& packet : packets) {
+		auto result = object.intersect(packet);
+		for (size_t lane = 0; lane < N; lane++) {
+			packetHits += static_cast<size_t>(result.hits[lane]);
+		}
+	}
+	double packetTime = elapsed_ms(start);
+
+	double total = static_cast<double>(packetCount * N);
+	std::cout << std::setw(10) << name << std::setw(6) << N << std::fixed << std::setprecision(2)
+		<< std::setw(14) << total / scalarTime / 1000.0 << std::setw(14) << total / packetTime / 1000.0
+		<< std::setw(9) << scalarTime / packetTime << 'x' << std::setw(12) << (scalarHits == packetHits ? "yes" : "no") << std::endl;
+}
+
+void benchmark_packets(size_t rayCount) {
+	std::cout << "ray packets vs single rays (" << rayCount << " rays)" << std::endl;
+	std::cout << std::setw(10) << "object" << std::setw(6) << "width" << std::setw(14) << "single Mr/s"
+		<< std::setw(14) << "packet Mr/s" << std::setw(10) << "speedup" << std::setw(12) << "agree" << std::endl;
+	auto rays = camera_rays(rayCount);
+	auto ball = rgle::ray::Ball(1.0f);
+	auto plane = rgle::ray::Plane(glm::vec3(0.0f, -0.5f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	benchmark_packet<4>("ball", ball, rays);
+	benchmark_packet<8>("ball", ball, rays);
+	benchmark_packet<16>("ball", ball, rays);
+	benchmark_packet<4>("plane", plane, rays);
+	benchmark_packet<8>("plane", plane, rays);
+	benchmark_packet<16>("plane", plane, rays);
+}
+
+// A height field of 2 * size * size triangles over [-1, 1] x [-1, 1]
+rgle::ray::Mesh height_field(size_t size, std::vector<glm::vec3>& vertices, std::vector<uint32_t>& indices) {
+	for (size_t y = 0; y <= size; y++) {
+		for (size_t x = 0; x <= size; x++) {
+			float u = 2.0f * static_cast<float>(x) / static_cast<float>(size) - 1.0f;
+			float v = 2.0f * static_cast<float>(y) / static_cast<float>(size) - 1.0f;
+			vertices.push_back(glm::vec3(u, 0.1f * std::sin(8.0f * u) * std::cos(8.0f * v), v));
+		}
+	}
+	for (uint32_t y = 0; y < size; y++) {
+		for (uint32_t x = 0; x < size; x++) {
+			uint32_t corner = y * static_cast<uint32_t>(size + 1) + x;
+			uint32_t below = corner + static_cast<uint32_t>(size + 1);
+			indices.insert(indices.end(), { corner, corner + 1, below, below, corner + 1, below + 1 });
+		}
+	}
+	return rgle::ray::Mesh(vertices, indices);
+}
+
+void benchmark_mesh(size_t rayCount) {
+	std::cout << "mesh hierarchy vs triangle scan (" << rayCount << " rays)" << std::endl;
+	std::cout << std::setw(10) << "triangles" << std::setw(14) << "build ms" << std::setw(14) << "scan ms"
+		<< std::setw(14) << "bvh ms" << std::setw(10) << "speedup" << std::setw(12) << "mismatch" << std::endl;
+	for (size_t size : { 16, 64, 256 }) {
+		std::mt19937 random(static_cast<unsigned int>(size));
+		std::vector<glm::vec3> vertices;
+		std::vector<uint32_t> indices;
+		auto start = Clock::now();
+		auto mesh = height_field(size, vertices, indices);
+		double buildTime = elapsed_ms(start);
+		auto rays = random_rays(rayCount, 2.0f, random);
+
+		std::vector<bool> scan(rays.size());
+		start = Clock::now();
+		for (size_t i = 0; i < rays.size(); i++) {
+			for (size_t j = 0; j < indices.size() && !scan[i]; j += 3) {
+				scan[i] = rgle::ray::intersect_triangle(rays[i], vertices[indices[j]], vertices[indices[j + 1]], vertices[indices[j + 2]]).has_value();
+			}
+		}
+		double scanTime = elapsed_ms(start);
+
+		size_t mismatches = 0;
+		start = Clock::now();
+		for (size_t i = 0; i < rays.size(); i++) {
+			if (mesh.closestHit(rays[i]).has_value() != scan[i]) {
+				mismatches++;
+			}
+		}
+		double hierarchyTime = elapsed_ms(start);
+
+		std::cout << std::setw(10) << mesh.triangleCount() << std::fixed << std::setprecision(2)
+			<< std::setw(14) << buildTime << std::setw(14) << scanTime << std::setw(14) << hierarchyTime
+			<< std::setw(9) << scanTime / hierarchyTime << 'x' << std::setw(12) << mismatches << std::endl;
+	}
+}
+
+void benchmark_renderer(size_t size) {
+	std::cout << "cpu renderer (" << size << "x" << size << " pixels, 1000 balls)" << std::endl;
+	std::cout << std::setw(10) << "threads" << std::setw(14) << "frame ms" << std::setw(14) << "Mr/s" << std::endl;
+	std::mt19937 random(5);
+	auto model = rgle::ray::Model(random_balls(1000, random));
+	std::get<rgle::ray::Scene>(model).build();
+	auto camera = rgle::ray::PinholeCamera {
+		.position = glm::vec3(0.0f, 0.0f, -100.0f),
+		.direction = glm::vec3(0.0f, 0.0f, 1.0f)
+	};
+	auto image = rgle::gfx::Image8(static_cast<int>(size), static_cast<int>(size), 3);
+	size_t hardware = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+	for (size_t threads : { static_cast<size_t>(1), hardware }) {
+		auto renderer = rgle::ray::Renderer(std::make_shared<rgle::sync::ThreadPool>(threads));
+		auto stats = renderer.render(model, camera, image);
+		std::cout << std::setw(10) << threads << std::fixed << std::setprecision(2)
+			<< std::setw(14) << stats.seconds * 1000.0 << std::setw(14) << stats.raysPerSecond() / 1e6 << std::endl;
+	}
+	image.write("ray-benchmark.png");
+}
+
+void benchmark_interval_set() {
+	const size_t count = 1 << 20;
+	std::cout << "interval set dirty block tracking (" << count << " pushes)" << std::endl;
+	std::cout << std::setw(12) << "pattern" << std::setw(12) << "push ms" << std::setw(12) << "ranges" << std::setw(12) << "iterate ms" << std::endl;
+	std::vector<std::pair<std::string, std::vector<size_t>>> patterns = {
+		{ "sequential", std::vector<size_t>(count) },
+		{ "reverse", std::vector<size_t>(count) },
+		// Every other block, so no two pushes merge
+		{ "strided", std::vector<size_t>(count) },
+		{ "random", std::vector<size_t>(4 * count) }
+	};
+	for (size_t i = 0; i < count; i++) {
+		patterns[0].second[i] = i;
+		patterns[1].second[i] = count - 1 - i;
+		patterns[2].second[i] = 2 * i;
+	}
+	// Distinct blocks spread over four times the range
+	auto& random = patterns[3].second;
+	for (size_t i = 0; i < random.size(); i++) {
+		random[i] = i;
+	}
+	std::mt19937 generator(11);
+	std::shuffle(random.begin(), random.end(), generator);
+	random.resize(count);
+	for (const auto& [name, blocks] : patterns) {
+		rgle::util::IntervalSet<size_t> set;
+		auto start = Clock::now();
+		for (size_t block : blocks) {
+			set.push(block);
+		}
+		double pushTime = elapsed_ms(start);
+		start = Clock::now();
+		size_t covered = 0;
+		for (auto range : set) {
+			covered += range.length();
+		}
+		double iterateTime = elapsed_ms(start);
+		std::cout << std::setw(12) << name << std::fixed << std::setprecision(2) << std::setw(12) << pushTime
+			<< std::setw(12) << set.size() << std::setw(12) << iterateTime << (covered == count ? "" : " (lost blocks)") << std::endl;
+	}
+}
+
+// Subdivides the nodes crossing the surface of a sphere centered at the origin down to depth levels below node
+void voxel_sphere(rgle::gfx::SparseVoxelNode node, size_t levels, float radius) {
+	const float diagonal = std::sqrt(3.0f) / 2.0f;
+	float size = node.size() / 2.0f;
+	std::array<glm::vec3, 8> centers;
+	std::array<glm::vec4, 8> colors;
+	for (size_t i = 0; i < 8; i++) {
+		rgle::gfx::OctreeIndex::X x;
+		rgle::gfx::OctreeIndex::Y y;
+		rgle::gfx::OctreeIndex::Z z;
+		rgle::gfx::OctreeIndex::from_index(i, x, y, z);
+		centers[i] = node.position() + (size / 2.0f) * glm::vec3(
+			x == rgle::gfx::OctreeIndex::RIGHT ? 1.0f : -1.0f,
+			y == rgle::gfx::OctreeIndex::TOP ? 1.0f : -1.0f,
+			z == rgle::gfx::OctreeIndex::FRONT ? 1.0f : -1.0f
+		);
+		bool inside = glm::length(centers[i]) - diagonal * size < radius;
+		colors[i] = inside ? glm::vec4(0.5f + 0.5f * glm::normalize(centers[i]), 1.0f) : glm::vec4(0.0f, 0.0f, 0.0f, 0.0f);
+	}
+	node.insertChildren(colors);
+	for (size_t i = 0; i < 8; i++) {
+		float distance = glm::length(centers[i]);
+		if (levels > 1 && distance - diagonal * size < radius && distance + diagonal * size > radius) {
+			rgle::gfx::OctreeIndex::X x;
+			rgle::gfx::OctreeIndex::Y y;
+			rgle::gfx::OctreeIndex::Z z;
+			rgle::gfx::OctreeIndex::from_index(i, x, y, z);
+			voxel_sphere(node.child(x, y, z), levels - 1, radius);
+		}
+	}
+}
+
+// Coverage of the box from lower to upper by walls of thickness wall repeating every cell along each axis, 0 for
+// none, 1 for partial and 2 for full
+int wall_coverage(const glm::vec3& lower, const glm::vec3& upper, float cell, float wall) {
+	int coverage = 0;
+	for (int axis = 0; axis < 3; axis++) {
+		float offset = lower[axis] - cell * std::floor(lower[axis] / cell);
+		float extent = upper[axis] - lower[axis];
+		if (offset + extent <= wall) {
+			return 2;
+		}
+		if (offset < wall || offset + extent >= cell) {
+			coverage = 1;
+		}
+	}
+	return coverage;
+}
+
+// Subdivides the nodes crossing a grid of rooms with walls, floors and ceilings down to depth levels below node
+void voxel_rooms(rgle::gfx::SparseVoxelNode node, size_t levels, float cell, float wall) {
+	float size = node.size() / 2.0f;
+	std::array<int, 8> coverage;
+	std::array<glm::vec4, 8> colors;
+	for (size_t i = 0; i < 8; i++) {
+		rgle::gfx::OctreeIndex::X x;
+		rgle::gfx::OctreeIndex::Y y;
+		rgle::gfx::OctreeIndex::Z z;
+		rgle::gfx::OctreeIndex::from_index(i, x, y, z);
+		auto center = node.position() + (size / 2.0f) * glm::vec3(
+			x == rgle::gfx::OctreeIndex::RIGHT ? 1.0f : -1.0f,
+			y == rgle::gfx::OctreeIndex::TOP ? 1.0f : -1.0f,
+			z == rgle::gfx::OctreeIndex::FRONT ? 1.0f : -1.0f
+		);
+		coverage[i] = wall_coverage(center - size / 2.0f, center + size / 2.0f, cell, wall);
+		colors[i] = coverage[i] != 0 ? glm::vec4(0.8f, 0.75f, 0.7f, 1.0f) : glm::vec4(0.0f, 0.0f, 0.0f, 0.0f);
+	}
+	node.insertChildren(colors);
+	for (size_t i = 0; i < 8; i++) {
+		if (levels > 1 && coverage[i] == 1) {
+			rgle::gfx::OctreeIndex::X x;
+			rgle::gfx::OctreeIndex::Y y;
+			rgle::gfx::OctreeIndex::Z z;
+			rgle::gfx::OctreeIndex::from_index(i, x, y, z);
+			voxel_rooms(node.child(x, y, z), levels - 1, cell, wall);
+		}
+	}
+}
+
+void benchmark_voxel_edits() {
+	std::cout << "voxel edit transaction vs immediate propagation (sphere)" << std::endl;
+	std::cout << std::setw(10) << "depth" << std::setw(12) << "blocks" << std::setw(14) << "immediate ms"
+		<< std::setw(14) << "commit ms" << std::setw(10) << "speedup" << std::endl;
+	rgle::sync::ThreadPool threads;
+	for (size_t levels : { 6, 8 }) {
+		rgle::gfx::SparseVoxelPool immediate;
+		immediate.rootSize() = 2.0f;
+		auto start = Clock::now();
+		voxel_sphere(immediate.root(), levels, 0.9f);
+		double immediateTime = elapsed_ms(start);
+
+		rgle::gfx::SparseVoxelPool deferred;
+		deferred.rootSize() = 2.0f;
+		start = Clock::now();
+		deferred.begin();
+		voxel_sphere(deferred.root(), levels, 0.9f);
+		deferred.commit(threads);
+		double deferredTime = elapsed_ms(start);
+
+		std::cout << std::setw(10) << levels << std::setw(12) << deferred.blockCount() << std::fixed << std::setprecision(2)
+			<< std::setw(14) << immediateTime << std::setw(14) << deferredTime
+			<< std::setw(9) << immediateTime / deferredTime << 'x' << std::endl;
+	}
+}
+
+void benchmark_voxel_file() {
+	// NOTE: the file was just written, so loads mostly read the page cache and show the decode cost over disk bandwidth
+	std::cout << "voxel file save and mapped load (sphere)" << std::endl;
+	std::cout << std::setw(10) << "depth" << std::setw(12) << "blocks" << std::setw(12) << "file MB"
+		<< std::setw(12) << "save ms" << std::setw(12) << "load ms" << std::setw(12) << "MB/s" << std::endl;
+	rgle::sync::ThreadPool threads;
+	auto filename = (std::filesystem::temp_directory_path() / "rgle_ray_benchmark.svo").string();
+	for (size_t levels : { 7, 9 }) {
+		rgle::gfx::SparseVoxelPool pool;
+		pool.rootSize() = 2.0f;
+		pool.begin();
+		voxel_sphere(pool.root(), levels, 0.9f);
+		pool.commit(threads);
+
+		auto start = Clock::now();
+		rgle::gfx::SparseVoxelFile::write(filename, pool);
+		double saveTime = elapsed_ms(start);
+
+		rgle::gfx::SparseVoxelPool loaded;
+		start = Clock::now();
+		{
+			rgle::gfx::SparseVoxelFile file(filename);
+			loaded.load(file, threads);
+		}
+		double loadTime = elapsed_ms(start);
+
+		double megabytes = static_cast<double>(rgle::gfx::SparseVoxelFile::fileSize(pool.blockCount())) / (1024.0 * 1024.0);
+		std::cout << std::setw(10) << levels << std::setw(12) << loaded.blockCount() << std::fixed << std::setprecision(2)
+			<< std::setw(12) << megabytes << std::setw(12) << saveTime << std::setw(12) << loadTime
+			<< std::setw(12) << megabytes / (loadTime / 1000.0) << std::endl;
+	}
+	std::filesystem::remove(filename);
+}
+
+void benchmark_voxel_compression() {
+	std::cout << "voxel DAG compression" << std::endl;
+	std::cout << std::setw(10) << "scene" << std::setw(10) << "depth" << std::setw(12) << "blocks" << std::setw(12) << "DAG blocks"
+		<< std::setw(10) << "ratio" << std::setw(14) << "compress ms" << std::endl;
+	rgle::sync::ThreadPool threads;
+	for (const std::string scene : { "sphere", "rooms" }) {
+		for (size_t levels : { 7, 9 }) {
+			rgle::gfx::SparseVoxelPool pool;
+			pool.rootSize() = 2.0f;
+			pool.begin();
+			if (scene == "sphere") {
+				voxel_sphere(pool.root(), levels, 0.9f);
+			}
+			else {
+				// 16 rooms along each axis, walls two leaves thick at depth 9
+				voxel_rooms(pool.root(), levels, 0.125f, 1.0f / 128.0f);
+			}
+			pool.commit(threads);
+			auto stats = pool.compress(threads);
+			std::cout << std::setw(10) << scene << std::setw(10) << levels << std::setw(12) << stats.blocks
+				<< std::setw(12) << stats.compressedBlocks << std::fixed << std::setprecision(2)
+				<< std::setw(9) << static_cast<double>(stats.blocks) / static_cast<double>(stats.compressedBlocks) << 'x'
+				<< std::setw(14) << stats.seconds * 1000.0 << std::endl;
+		}
+	}
+}
+
+void benchmark_voxelizer() {
+	// Latitude/longitude sphere with two triangles per quad
+	const size_t rings = 500;
+	const size_t segments = 1000;
+	rgle::gfx::VoxelMesh sphere;
+	for (size_t ring = 0; ring <= rings; ring++) {
+		float theta = glm::pi<float>() * static_cast<float>(ring) / rings;
+		for (size_t segment = 0; segment <= segments; segment++) {
+			float phi = 2.0f * glm::pi<float>() * static_cast<float>(segment) / segments;
+			auto normal = glm::vec3(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+			sphere.vertices.push_back(normal);
+			sphere.colors.push_back(glm::vec4(0.5f + 0.5f * normal, 1.0f));
+		}
+	}
+	for (uint32_t ring = 0; ring < rings; ring++) {
+		for (uint32_t segment = 0; segment < segments; segment++) {
+			uint32_t a = ring * (segments + 1) + segment;
+			uint32_t b = a + segments + 1;
+			sphere.indices.insert(sphere.indices.end(), { a, b, a + 1, a + 1, b, b + 1 });
+		}
+	}
+	std::cout << "mesh voxelizer (" << sphere.indices.size() / 3 << " triangles)" << std::endl;
+	std::cout << std::setw(10) << "depth" << std::setw(14) << "build ms" << std::setw(12) << "leaves"
+		<< std::setw(12) << "blocks" << std::setw(12) << "pool MB" << std::endl;
+	auto threads = std::make_shared<rgle::sync::ThreadPool>();
+	for (size_t depth : { 8, 10 }) {
+		rgle::gfx::SparseVoxelPool pool;
+		auto stats = rgle::gfx::Voxelizer(threads, rgle::gfx::VoxelizeOptions{ .depth = depth }).voxelize(sphere, pool);
+		std::cout << std::setw(10) << depth << std::fixed << std::setprecision(2) << std::setw(14) << stats.seconds * 1000.0
+			<< std::setw(12) << stats.leaves << std::setw(12) << stats.blocks
+			<< std::setw(12) << static_cast<double>(pool.memoryUsage()) / (1024.0 * 1024.0) << std::endl;
+	}
+}
+
+void benchmark_point_cloud() {
+	// Noisy points on the unit sphere, colored by their normal
+	const size_t count = 8 << 20;
+	std::mt19937 generator(7);
+	std::normal_distribution<float> normal(0.0f, 1.0f);
+	std::uniform_real_distribution<float> noise(0.98f, 1.02f);
+	std::vector<glm::vec3> positions(count);
+	std::vector<glm::vec4> colors(count);
+	for (size_t i = 0; i < count; i++) {
+		auto direction = glm::normalize(glm::vec3(normal(generator), normal(generator), normal(generator)));
+		positions[i] = noise(generator) * direction;
+		colors[i] = glm::vec4(0.5f + 0.5f * direction, 1.0f);
+	}
+	std::cout << "point cloud importer (" << count << " points)" << std::endl;
+	std::cout << std::setw(10) << "depth" << std::setw(14) << "chunk" << std::setw(14) << "build ms" << std::setw(12) << "Mp/s"
+		<< std::setw(12) << "leaves" << std::setw(12) << "blocks" << std::endl;
+	auto threads = std::make_shared<rgle::sync::ThreadPool>();
+	for (size_t depth : { 8, 10, 12 }) {
+		for (size_t chunk : { static_cast<size_t>(1) << 20, count }) {
+			rgle::gfx::SparseVoxelPool pool;
+			rgle::gfx::PointCloudImporter importer(threads, rgle::gfx::PointCloudOptions{ .depth = depth, .chunkSize = chunk });
+			auto stats = importer.build(positions, colors, pool);
+			std::cout << std::setw(10) << depth << std::setw(14) << chunk << std::fixed << std::setprecision(2)
+				<< std::setw(14) << stats.seconds * 1000.0 << std::setw(12) << stats.points / stats.seconds / 1.0e6
+				<< std::setw(12) << stats.leaves << std::setw(12) << stats.blocks << std::endl;
+		}
+	}
+}
+
+void benchmark_voxel_raycaster(size_t size) {
+	const size_t levels = 7;
+	std::cout << "cpu voxel raycaster (" << size << "x" << size << " pixels, sphere of depth " << levels << ")" << std::endl;
+	std::cout << std::setw(10) << "threads" << std::setw(14) << "frame ms" << std::setw(14) << "Mr/s" << std::setw(14) << "nodes/ray" << std::endl;
+	rgle::gfx::SparseVoxelPool pool;
+	pool.rootSize() = 2.0f;
+	voxel_sphere(pool.root(), levels, 0.9f);
+	rgle::gfx::SparseVoxelCamera camera(0.1f, 100.0f, 1.0f);
+	camera.translate(0.0f, 0.0f, -3.0f);
+	rgle::gfx::Image offsets(size, size, 1, 1, sizeof(GLint));
+	size_t hardware = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+	for (size_t threads : { static_cast<size_t>(1), hardware }) {
+		auto raycaster = rgle::gfx::SparseVoxelRaycaster(std::make_shared<rgle::sync::ThreadPool>(threads));
+		auto stats = raycaster.render(pool, camera, offsets);
+		std::cout << std::setw(10) << threads << std::fixed << std::setprecision(2)
+			<< std::setw(14) << stats.seconds * 1000.0 << std::setw(14) << stats.raysPerSecond() / 1e6
+			<< std::setw(14) << static_cast<double>(stats.nodes) / static_cast<double>(stats.rays) << std::endl;
+	}
+	auto image = rgle::gfx::Image8(static_cast<int>(size), static_cast<int>(size), 4);
+	rgle::gfx::SparseVoxelRaycaster::realize(pool, offsets, image);
+	image.write("voxel-benchmark.png");
+}
+
+int main(const int argc, const char* const argv[]) {
+	try {
+		size_t rayCount = 1000;
+		if (argc >= 2 && atoi(argv[1]) > 0) {
+			rayCount = static_cast<size_t>(atoi(argv[1]));
+		}
+
+		rgle::initialize();
+
+		benchmark_scene_hierarchy(rayCount);
+		benchmark_occlusion(rayCount);
+		benchmark_refit(rayCount);
+		benchmark_packets(rayCount * 1000);
+		benchmark_compiled_model(rayCount * 10);
+		benchmark_batch(1000000);
+		benchmark_optimize(rayCount * 10);
+		benchmark_mesh(rayCount * 10);
+		benchmark_renderer(512);
+		benchmark_interval_set();
+		benchmark_voxel_edits();
+		benchmark_voxel_file();
+		benchmark_voxel_compression();
+		benchmark_voxelizer();
+		benchmark_point_cloud();
+		benchmark_voxel_raycaster(512);
+	}
+	catch (rgle::Exception&) {
+		return -1;
+	}
+	catch (std::exception& e) {
+		rgle::Exception except = rgle::Exception(e.what(), LOGGER_DETAIL_DEFAULT);
+		return -1;
+	}
+	catch (...) {
+		rgle::Exception except = rgle::Exception("UNHANDLED EXCEPTION", LOGGER_DETAIL_DEFAULT);
+		return -1;
+	}
+	return 0;
+}
@@ -45,11 +45,27 @@ int main(const int argc, const char* const argv[]) {
 
 		int width = 800;
 		int height = 600;
+		// Traversal mode: "pass", "stackless" or "benchmark" to time both and exit
+		std::string mode = "pass";
+		// Octree file to load instead of building the demo octree, see SparseVoxelFile, brick files (.svb) are paged
+		std::string octreeFile;
+		// GPU milliseconds per frame the renderer holds by lowering the quality, zero renders at full quality
+		double frameBudget = 0.0;
 
 		if (argc >= 3 && atoi(argv[1]) > 0 && atoi(argv[2]) > 0) {
 			width = atoi(argv[1]);
 			height = atoi(argv[2]);
 		}
+		if (argc >= 4) {
+			mode = argv[3];
+		}
+		if (argc >= 5) {
+			octreeFile = argv[4];
+		}
+		if (argc >= 6) {
+			frameBudget = atof(argv[5]);
+		}
+		auto traversal = mode == "stackless" ? rgle::gfx::SparseVoxelRenderer::Traversal::STACKLESS : rgle::gfx::SparseVoxelRenderer::Traversal::PASS;
 
 		rgle::initialize();
 
@@ -77,6 +93,18 @@ int main(const int argc, const char* const argv[]) {
 			shaders
 		);
 		app.addShader(sparseVoxel);
+		auto stacklessShaders = { rgle::gfx::Shader::compileFile("shader/sparse-voxel/sparse-voxel-stackless.comp", GL_COMPUTE_SHADER) };
+		auto sparseVoxelStackless = std::make_shared<rgle::gfx::ShaderProgram>(
+			"sparse-voxel-stackless",
+			stacklessShaders
+		);
+		app.addShader(sparseVoxelStackless);
+		auto beamShaders = { rgle::gfx::Shader::compileFile("shader/sparse-voxel/sparse-voxel-beam.comp", GL_COMPUTE_SHADER) };
+		auto sparseVoxelBeam = std::make_shared<rgle::gfx::ShaderProgram>(
+			"sparse-voxel-beam",
+			beamShaders
+		);
+		app.addShader(sparseVoxelBeam);
 		auto sparseVoxelRealize = std::make_shared<rgle::gfx::ShaderProgram>(
 			"sparse-voxel-realize",
 			"shader/sparse-voxel/sparse-voxel-realize.vert",
@@ -101,7 +129,7 @@ int main(const int argc, const char* const argv[]) {
 		std::shared_ptr<rgle::ui::Layer> uiLayer;
 		std::shared_ptr<rgle::ui::Text> fpsText;
 
-		app.executeInContext([&app, &window, &octree, &camera, &mainLayer, &uiLayer, &fpsText]() {
+		app.executeInContext([&app, &window, &octree, &camera, &mainLayer, &uiLayer, &fpsText, &octreeFile, traversal, frameBudget]() {
 			octree = std::make_shared<rgle::gfx::SparseVoxelOctree>();
 
 			camera = std::make_shared<rgle::gfx::NoClipSparseVoxelCamera>(0.01f, 1000.0f, glm::radians(60.0f), window);
@@ -109,30 +137,44 @@ int main(const int argc, const char* const argv[]) {
 			mainLayer = std::make_shared<rgle::gfx::SparseVoxelRenderer>(
 				"mainLayer",
 				octree,
-				"sparse-voxel",
+				traversal == rgle::gfx::SparseVoxelRenderer::Traversal::STACKLESS ? "sparse-voxel-stackless" : "sparse-voxel",
 				"sparse-voxel-realize",
 				window->width(),
 				window->height(),
-				camera
+				camera,
+				traversal,
+				"sparse-voxel-beam"
 			);
+			mainLayer->quality().frameBudget = frameBudget;
 			app.addLayer(mainLayer);
 			camera->translate(glm::vec3(0.0f, 0.0f, -5.0f));
-			octree->root()->size() = 0.25f;
-			octree->root()->color() = glm::vec4(1.0f, 0.5f, 0.0f, 1.0f);
-			octree->root()->update();
-			rgle::gfx::SparseVoxelNode* node = octree->root();
-			for (int i = 0; i < 100; i++) {
-				node->insertChildren({
-					glm::vec4(0.0f, 0.0f, 0.0f, 1.0f),
-					glm::vec4(0.0f, 0.0f, 1.0f, 1.0f),
-					glm::vec4(0.0f, 1.0f, 0.0f, 1.0f),
-					glm::vec4(0.0f, 1.0f, 1.0f, 1.0f),
-					glm::vec4(1.0f, 0.0f, 0.0f, 1.0f),
-					glm::vec4(1.0f, 0.0f, 1.0f, 1.0f),
-					glm::vec4(1.0f, 1.0f, 0.0f, 1.0f),
-					glm::vec4(1.0f, 1.0f, 1.0f, 1.0f),
-				});
-				node = node->child(rgle::gfx::OctreeIndex::LEFT, rgle::gfx::OctreeIndex::TOP, rgle::gfx::OctreeIndex::FRONT);
+			if (std::filesystem::path(octreeFile).extension() == ".svb") {
+				octree->page(octreeFile);
+			}
+			else if (!octreeFile.empty()) {
+				rgle::sync::ThreadPool threads;
+				octree->load(octreeFile, threads);
+			}
+			else {
+				octree->pool().rootSize() = 0.25f;
+				rgle::gfx::SparseVoxelNode node = octree->root();
+				node.color() = glm::vec4(1.0f, 0.5f, 0.0f, 1.0f);
+				node.update();
+				octree->begin();
+				for (int i = 0; i < 100; i++) {
+					octree->insert(node, {
+						glm::vec4(0.0f, 0.0f, 0.0f, 1.0f),
+						glm::vec4(0.0f, 0.0f, 1.0f, 1.0f),
+						glm::vec4(0.0f, 1.0f, 0.0f, 1.0f),
+						glm::vec4(0.0f, 1.0f, 1.0f, 1.0f),
+						glm::vec4(1.0f, 0.0f, 0.0f, 1.0f),
+						glm::vec4(1.0f, 0.0f, 1.0f, 1.0f),
+						glm::vec4(1.0f, 1.0f, 0.0f, 1.0f),
+						glm::vec4(1.0f, 1.0f, 1.0f, 1.0f),
+					});
+					node = node.child(rgle::gfx::OctreeIndex::LEFT, rgle::gfx::OctreeIndex::TOP, rgle::gfx::OctreeIndex::FRONT);
+				}
+				octree->commit();
 			}
 
 			uiLayer = std::make_shared<rgle::ui::Layer>("ui");
@@ -149,6 +191,57 @@ int main(const int argc, const char* const argv[]) {
 			uiLayer->addElement(fpsText);
 		});
 
+		if (mode == "benchmark") {
+			// Time both traversals with and without the beam prepass on the same octree and camera, glFinish makes the CPU
+			// clock cover the GPU work
+			app.executeInContext([&window, &octree, &camera]() {
+				const int frames = 100;
+				for (auto traversal : { rgle::gfx::SparseVoxelRenderer::Traversal::PASS, rgle::gfx::SparseVoxelRenderer::Traversal::STACKLESS }) {
+					bool stackless = traversal == rgle::gfx::SparseVoxelRenderer::Traversal::STACKLESS;
+					auto renderer = std::make_shared<rgle::gfx::SparseVoxelRenderer>(
+						stackless ? "stacklessBenchmark" : "passBenchmark",
+						octree,
+						stackless ? "sparse-voxel-stackless" : "sparse-voxel",
+						"sparse-voxel-realize",
+						window->width(),
+						window->height(),
+						camera,
+						traversal,
+						"sparse-voxel-beam"
+					);
+					renderer->update();
+					for (bool beam : { false, true }) {
+						renderer->beamPrepass(beam);
+						renderer->render();
+						glFinish();
+						auto start = std::chrono::steady_clock::now();
+						for (int i = 0; i < frames; i++) {
+							renderer->render();
+						}
+						glFinish();
+						double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / frames;
+						std::string name = std::string(stackless ? "stackless" : "pass") + (beam ? "+beam" : "");
+						std::cout << std::setw(15) << name << std::fixed << std::setprecision(3)
+							<< std::setw(12) << ms << " ms/frame" << std::endl;
+						if (!stackless) {
+							// Diff the pass output against the CPU reference traversal
+							rgle::gfx::Image gpu(window->width(), window->height(), 1, 1, sizeof(GLint));
+							rgle::gfx::Image cpu(window->width(), window->height(), 1, 1, sizeof(GLint));
+							glGetTextureImage(renderer->outTexture()->id(), 0, GL_RED_INTEGER, GL_INT, static_cast<GLsizei>(gpu.size()), gpu.image);
+							auto stats = rgle::gfx::SparseVoxelRaycaster().render(octree->pool(), *camera, cpu);
+							size_t mismatches = 0;
+							for (size_t i = 0; i < gpu.size(); i += sizeof(GLint)) {
+								mismatches += std::memcmp(gpu.image + i, cpu.image + i, sizeof(GLint)) != 0 ? 1 : 0;
+							}
+							std::cout << std::setw(15) << "cpu" << std::setw(12) << stats.seconds * 1000.0 << " ms/frame"
+								<< std::setw(12) << stats.raysPerSecond() / 1e6 << " Mr/s" << std::setw(10) << mismatches << " pixels differ" << std::endl;
+						}
+					}
+				}
+			});
+			return 0;
+		}
+
 		Stack<30, int> framerate;
 		clock_t lastTime = clock();
 
@@ -166,7 +259,11 @@ int main(const int argc, const char* const argv[]) {
 			}
 
 			if (uiLayer->tick()) {
-				fpsText->update(std::string("Framerate: ") + std::to_string(static_cast<int>(framerate.sum() / framerate.size())));
+				fpsText->update(
+					std::string("Framerate: ") + std::to_string(static_cast<int>(framerate.sum() / framerate.size())) +
+					" GPU: " + std::to_string(static_cast<int>(mainLayer->gpuTime())) + " ms" +
+					" Scale: " + std::to_string(static_cast<int>(mainLayer->resolutionScale() * 100.0f)) + "%"
+				);
 			}
 
 			app.update();
@@ -1,11 +1,8 @@
 #version 460
 
 struct OctreeNode {
-	vec4 color;
-	// NOTE: only position.xyz are used, use a vec4 here to avoid alignment issues
-	vec4 position;
-	uint depth;
-	int next;
+	uint color;			// RGBA8 color
+	uint children;	// Block index of the children in the upper 24 bits, mask of non transparent children in the lower 8
 };
 
 layout(std430, binding=1) readonly buffer octree_buffer {
@@ -15,10 +12,12 @@ layout(std430, binding=1) readonly buffer octree_buffer {
 in vec2 uv_coords;
 
 uniform isampler2D texture_0;
+uniform uvec2 render_resolution;	// Traced part of the texture, stretched over the whole rect
 
 out vec4 frag_color;
 
 void main() {
-	int offset = texture(texture_0, uv_coords).x;
-	frag_color = offset >= 0 ? OctreeBuffer.nodes[offset].color : vec4(0.0f);
+	ivec2 texel = min(ivec2(uv_coords * vec2(render_resolution)), ivec2(render_resolution) - 1);
+	int offset = texelFetch(texture_0, texel, 0).x;
+	frag_color = offset >= 0 ? unpackUnorm4x8(OctreeBuffer.nodes[offset].color) : vec4(0.0f);
 }
\ No newline at end of file
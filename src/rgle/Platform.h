@@ -19,6 +19,7 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <unordered_map>
 #include <functional>
 #include <fstream>
 #include <sstream>
@@ -44,8 +45,10 @@
 #include <mutex>
 #include <condition_variable>
 #include <type_traits>
+#include <typeinfo>
 #include <optional>
 #include <variant>
+#include <span>
 
 #include <GL\glew.h>
 #include <GL\GL.h>
@@ -432,6 +432,11 @@ void rgle::gfx::PersistentTexture2D::bindImage2D()
 	glBindImageTexture(this->index(), this->id(), 0, GL_FALSE, 0, this->_access, this->_format.internal);
 }
 
+void rgle::gfx::PersistentTexture2D::clear(const void* value)
+{
+	glClearTexImage(this->id(), 0, this->_format.target, this->_type, value);
+}
+
 GLenum & rgle::gfx::PersistentTexture2D::access()
 {
 	return this->_access;
@@ -129,6 +129,9 @@ namespace rgle::gfx {
 
 		virtual void bindImage2D();
 
+		// Fills the texture with a single texel value on the GPU, without uploading the CPU image
+		void clear(const void* value);
+
 		GLenum& access();
 		const GLenum& access() const;
 
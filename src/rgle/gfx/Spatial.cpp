@@ -1,14 +1,65 @@
 #include "rgle/gfx/Spatial.h"
+#include "rgle/gfx/SpatialFile.h"
+#include "rgle/gfx/SpatialPaging.h"
+#include "rgle/sync/Thread.h"
 
-const size_t rgle::gfx::SparseVoxelNodePayload::SIZE = rgle::gfx::aligned_std430_size(8 * sizeof(GLfloat) + sizeof(GLuint) + sizeof(GLint), 4 * sizeof(GLfloat));
-const size_t rgle::gfx::SparseVoxelRayPayload::SIZE = rgle::gfx::aligned_std430_size(sizeof(GLuint) + sizeof(GLint), sizeof(GLint));
+const size_t rgle::gfx::SparseVoxelNodePayload::SIZE = rgle::gfx::aligned_std430_size(2 * sizeof(GLuint), sizeof(GLuint));
+const size_t rgle::gfx::SparseVoxelRayPayload::SIZE = rgle::gfx::aligned_std430_size(2 * sizeof(GLuint) + sizeof(GLint) + 3 * sizeof(GLfloat), sizeof(GLint));
 const size_t rgle::gfx::SparseVoxelOctree::BLOCK_SIZE = 8 * rgle::gfx::SparseVoxelNodePayload::SIZE;
 
 const int rgle::gfx::SparseVoxelRenderer::RAY_BUFFER = 0;
 const int rgle::gfx::SparseVoxelRenderer::OCTREE_BUFFER = 1;
-const int rgle::gfx::SparseVoxelRenderer::PASS_READ_BUFFER = 2;
-const int rgle::gfx::SparseVoxelRenderer::PASS_WRITE_BUFFER = 3;
-const int rgle::gfx::SparseVoxelRenderer::PASS_WRTIE_COUNTER = 0;
+const int rgle::gfx::SparseVoxelRenderer::PASS_SCHEDULE_BUFFER = 2;
+const int rgle::gfx::SparseVoxelRenderer::PASS_BUFFER = 3;
+const size_t rgle::gfx::SparseVoxelRenderer::MAX_PASS_LEVELS = 12;
+const int rgle::gfx::SparseVoxelRenderer::PAGE_FEEDBACK_BUFFER = 4;
+const int rgle::gfx::SparseVoxelRenderer::BEAM_TILE_SIZE = 8;
+
+namespace {
+	// Mirrors pass_schedule in sparse-voxel.comp, 9 header words followed by the counters and the sub pass stack
+	const size_t PASS_SCHEDULE_SIZE = (9 + 3 * rgle::gfx::SparseVoxelRenderer::MAX_PASS_LEVELS) * sizeof(GLuint);
+	// Word of subpass_size in pass_schedule, non zero after the last pass of a frame if the frame was cut short
+	const size_t PASS_SCHEDULE_SUBPASS_SIZE = 5;
+	// Words from subpass_size to passes, copied aside after the last pass of each frame
+	const size_t PASS_SCHEDULE_READBACK_WORDS = 4;
+	// Word of passes within the words copied aside
+	const size_t PASS_SCHEDULE_READBACK_PASSES = 3;
+	// Mirrors page_feedback in the traversal shaders, request count, request capacity, slot count and brick count
+	const size_t PAGE_FEEDBACK_HEADER = 4;
+	// Quality steps of the frame budget controller, one per settled frame
+	const float LOD_BIAS_STEP = 0.25f;
+	const float RESOLUTION_SCALE_STEP = 0.125f;
+	// Mirrors BeamStart in the traversal shaders, node offset, depth and position
+	const size_t BEAM_START_SIZE = 5 * sizeof(GLuint);
+	// Mirrors MAX_STACK in sparse-voxel-stackless.comp
+	const GLuint STACKLESS_MAX_STACK = 32;
+	// Index of the root node in every pool and brick cache, read from the pool it would decode a loaded file
+	const GLint ROOT_NODE = 0;
+
+	size_t beam_tiles(const glm::ivec2& resolution)
+	{
+		const int tile = rgle::gfx::SparseVoxelRenderer::BEAM_TILE_SIZE;
+		return static_cast<size_t>(((resolution.x + tile - 1) / tile) * ((resolution.y + tile - 1) / tile));
+	}
+
+	// Payloads of the 8 nodes of a block, color in the upper and merged child block in the lower half of each word
+	struct BlockKey {
+		std::array<uint64_t, 8> words;
+		size_t hash;
+
+		bool operator==(const BlockKey& other) const
+		{
+			return this->words == other.words;
+		}
+	};
+
+	struct BlockKeyHash {
+		size_t operator()(const BlockKey& key) const
+		{
+			return key.hash;
+		}
+	};
+}
 
 rgle::gfx::SparseVoxelRenderer::SparseVoxelRenderer(
 	std::string id,
@@ -17,38 +68,66 @@ rgle::gfx::SparseVoxelRenderer::SparseVoxelRenderer(
 	std::string realizeShaderId,
 	unsigned int width,
 	unsigned int height,
-	std::shared_ptr<SparseVoxelCamera> camera) :
+	std::shared_ptr<SparseVoxelCamera> camera,
+	Traversal traversal,
+	std::string beamShaderId) :
 	_octree(octree),
 	_resolution(glm::ivec2(width, height)),
+	_renderResolution(_resolution),
+	_traversal(traversal),
 	_camera(camera),
 	_maxBufferDepth(static_cast<size_t>(std::ceil(std::log2(_resolution.x)))),
+	_passBudget(4 * _maxBufferDepth),
+	_scheduleBuffer(0),
+	_passBuffer(0),
+	_passCapacity(0),
+	_scheduleReadback(0),
+	_scheduleReadbackData(nullptr),
+	_scheduleFences(),
+	_scheduleBudgets(),
 	_lastTime(std::chrono::system_clock::now()),
+	_lodBias(0.0f),
+	_resolutionScale(1.0f),
+	_gpuTime(0.0),
+	_frame(0),
+	_settleFrames(0),
+	_beamPrepass(!beamShaderId.empty()),
 	RenderLayer(id)
 {
 	this->shader() = this->context().manager.shader.lock()->getStrict(computeShaderId);
 	this->_realizeShader = this->context().manager.shader.lock()->getStrict(realizeShaderId);
 	auto shader = this->shaderLocked();
-	this->_location.bootstrap = shader->uniformStrict("bootstrap");
-	this->_location.finalize = shader->uniformStrict("finalize");
-	this->_location.subPassOffset = shader->uniformStrict("subpass_offset");
-	this->_location.subPassSize = shader->uniformStrict("subpass_size");
 	this->_location.renderResolution = shader->uniformStrict("render_resolution");
 	this->_location.rootNodeOffset = shader->uniformStrict("root_node_offset");
 	this->_location.rootNodeSize = shader->uniformStrict("root_node_size");
-	this->_location.readPassSize = shader->uniformStrict("read_pass_size");
-	this->_location.depthImage = shader->uniformStrict("depth_image");
 	this->_location.outImage = shader->uniformStrict("out_image");
+	this->_location.lodBias = shader->uniformStrict("lod_bias");
+	this->_location.realizeResolution = this->_realizeShader->uniformStrict("render_resolution");
+	this->_location.beam = shader->uniformStrict("beam");
+	this->_location.paging = SparseVoxelOctree::pagingLocation(*shader);
+	if (!beamShaderId.empty()) {
+		this->_beamShader = this->context().manager.shader.lock()->getStrict(beamShaderId);
+		this->_beamLocation.rootNodeOffset = this->_beamShader->uniformStrict("root_node_offset");
+		this->_beamLocation.rootNodeSize = this->_beamShader->uniformStrict("root_node_size");
+		this->_beamLocation.renderResolution = this->_beamShader->uniformStrict("render_resolution");
+		this->_beamLocation.lodBias = this->_beamShader->uniformStrict("lod_bias");
+		this->_beamLocation.maxDepth = this->_beamShader->uniformStrict("max_depth");
+		this->_beamLocation.paging = SparseVoxelOctree::pagingLocation(*this->_beamShader);
+	}
+	if (this->_traversal == Traversal::PASS) {
+		if (this->_maxBufferDepth > MAX_PASS_LEVELS) {
+			throw GraphicsException("render resolution needs more pass levels than the pass shader schedules", LOGGER_DETAIL_DEFAULT);
+		}
+		this->_location.schedule = shader->uniformStrict("schedule");
+		this->_location.reset = shader->uniformStrict("reset");
+		this->_location.maxBufferDepth = shader->uniformStrict("max_buffer_depth");
+		this->_location.passCapacity = shader->uniformStrict("pass_capacity");
+		this->_location.depthImage = shader->uniformStrict("depth_image");
+	}
 	this->transformer() = this->_camera;
+	// NOTE: the images only size the textures, they are reset on the GPU every frame
 	auto depthImage = std::make_shared<Image>(this->_resolution.x, this->_resolution.y, 1, 1, sizeof(GLuint));
 	auto outImage = std::make_shared<Image>(this->_resolution.x, this->_resolution.y, 1, 1, sizeof(GLint));
-	const GLuint uintMax = std::numeric_limits<GLuint>::max();
-	const GLint startIndex = -1;
-	for (int i = 0; i < this->_resolution.x; i++) {
-		for (int j = 0; j < this->_resolution.y; j++) {
-			depthImage->set(i, j, (unsigned char*)&uintMax, sizeof(GLuint));
-			outImage->set(i, j, (unsigned char*)&startIndex, sizeof(GLint));
-		}
-	}
 	this->_depthTexture = std::make_shared<PersistentTexture2D>(
 		depthImage,
 		1,
@@ -67,35 +146,29 @@ rgle::gfx::SparseVoxelRenderer::SparseVoxelRenderer(
 	this->_imageRect = ImageRect(Sampler2D(this->_realizeShader, this->_outTexture), 2.0f, 2.0f);
 	this->_imageRect.model.matrix[3][2] = 0.0f;
 
-	this->_passBuffers = std::make_unique<GLuint[]>(this->_maxBufferDepth);
-	this->_bufferSizes = std::make_unique<unsigned int[]>(this->_maxBufferDepth);
-	this->_counterBuffers = std::make_unique<GLuint[]>(this->_maxBufferDepth - 1);
-	this->_subPassStack = std::make_unique<SubPass[]>(this->_maxBufferDepth);
-
 	glGenBuffers(1, &this->_rayBuffer);
-	glGenBuffers(static_cast<GLsizei>(this->_maxBufferDepth), &this->_passBuffers[0]);
-	glGenBuffers(static_cast<GLsizei>(this->_maxBufferDepth - 1), &this->_counterBuffers[0]);
+	glGenQueries(static_cast<GLsizei>(this->_timerQueries.size()), this->_timerQueries.data());
+	// NOTE: the single dispatch traversal needs no pass buffers, their names stay zero which glDeleteBuffers ignores
+	if (this->_traversal == Traversal::PASS) {
+		glGenBuffers(1, &this->_passBuffer);
+		glGenBuffers(1, &this->_scheduleReadback);
+	}
+	// The beam prepass writes the start node of each tile behind the sub pass stack, which the single dispatch
+	// traversal leaves unused
+	if (this->_traversal == Traversal::PASS || this->_beamShader) {
+		size_t scheduleSize = PASS_SCHEDULE_SIZE + (this->_beamShader ? beam_tiles(this->_resolution) * BEAM_START_SIZE : 0);
+		std::vector<GLuint> scheduleData(scheduleSize / sizeof(GLuint), 0);
+		glGenBuffers(1, &this->_scheduleBuffer);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, this->_scheduleBuffer);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, scheduleSize, scheduleData.data(), GL_DYNAMIC_COPY);
+	}
 
-	std::vector<unsigned char> bootstrapData(this->_resolution.x * this->_resolution.y * SparseVoxelRayPayload::SIZE);
 	std::vector<glm::vec4> rayData(this->_resolution.x * this->_resolution.y);
-	SparseVoxelRayPayload payload;
-	glm::vec2 pixelAngle(this->_camera->fieldOfView() / this->_resolution.x, this->_camera->fieldOfView() / this->_resolution.y);
-	glm::ivec2 center(this->_resolution.x / 2, this->_resolution.y / 2);
-	unsigned char* bootstrapPtr = bootstrapData.data();
 	for (int j = 0; j < this->_resolution.y; j++) {
 		for (int i = 0; i < this->_resolution.x; i++) {
-			payload.pixel = i + j * this->_resolution.x;
-			payload.offset = 0;
-			payload.mapToBuffer(bootstrapPtr);
-			bootstrapPtr += SparseVoxelRayPayload::SIZE;
-			// Generate ray for pixel (i, j)
-			glm::vec2 delta = glm::ivec2(i, j) - center;
-			glm::vec2 theta(delta.x * pixelAngle.x, delta.y * pixelAngle.y);
-			rayData[payload.pixel] = glm::normalize(glm::vec4(std::tanf(theta.x), std::tanf(theta.y), 1.0f, 0.0f));
-		}
-	}
-	glBindBuffer(GL_SHADER_STORAGE_BUFFER, this->_passBuffers[0]);
-	glBufferData(GL_SHADER_STORAGE_BUFFER, bootstrapData.size(), bootstrapData.data(), GL_STATIC_DRAW);
+			rayData[i + j * this->_resolution.x] = glm::vec4(this->_camera->pixelRay(i, j, this->_resolution.x, this->_resolution.y), 0.0f);
+		}
+	}
 	glBindBuffer(GL_SHADER_STORAGE_BUFFER, this->_rayBuffer);
 	glBufferData(
 		GL_SHADER_STORAGE_BUFFER,
@@ -103,21 +176,58 @@ rgle::gfx::SparseVoxelRenderer::SparseVoxelRenderer(
 		rayData.data(),
 		GL_STATIC_DRAW
 	);
-	size_t subPassSize = this->_resolution.x * this->_resolution.y * 8;
-	for (size_t i = 1; i < this->_maxBufferDepth; i++) {
-		this->_bufferSizes[i] = static_cast<GLuint>(subPassSize * i);
-		glBindBuffer(GL_SHADER_STORAGE_BUFFER, this->_passBuffers[i]);
-		glBufferData(GL_SHADER_STORAGE_BUFFER, this->_bufferSizes[i] * SparseVoxelRayPayload::SIZE, nullptr, GL_DYNAMIC_DRAW);
-		glBindBuffer(GL_ATOMIC_COUNTER_BUFFER, this->_counterBuffers[i - 1]);
-		glBufferData(GL_ATOMIC_COUNTER_BUFFER, sizeof(GLuint), nullptr, GL_DYNAMIC_DRAW);
+	if (this->_traversal == Traversal::STACKLESS) {
+		return;
+	}
+	// The bootstrap level is derived from the invocation index, levels 1 to max_buffer_depth - 1 are stored back to back
+	// and level i holds 8 children for each of capacity * i states, so the capacity is lowered until they fit one block
+	GLint64 maxBlockSize = 0;
+	glGetInteger64v(GL_MAX_SHADER_STORAGE_BLOCK_SIZE, &maxBlockSize);
+	size_t levels = this->_maxBufferDepth;
+	size_t statesPerCapacity = std::max<size_t>(1, 4 * levels * (levels - 1));
+	size_t maxStates = static_cast<size_t>(maxBlockSize) / SparseVoxelRayPayload::SIZE;
+	this->_passCapacity = std::min(static_cast<size_t>(this->_resolution.x * this->_resolution.y), maxStates / statesPerCapacity);
+	if (this->_passCapacity == 0) {
+		throw GraphicsException("shader storage blocks are too small for the pass traversal", LOGGER_DETAIL_DEFAULT);
+	}
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, this->_passBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, this->_passCapacity * statesPerCapacity * SparseVoxelRayPayload::SIZE, nullptr, GL_DYNAMIC_DRAW);
+	// Start from levels times the sub passes of a level, level 0 takes a sub pass per capacity pixels and a deeper level
+	// at most 8 per sub pass above it, the budget then settles on the passes frames need
+	size_t pixels = static_cast<size_t>(this->_resolution.x * this->_resolution.y);
+	size_t subpasses = std::max<size_t>(8, (pixels + this->_passCapacity - 1) / this->_passCapacity);
+	this->_passBudget = std::max(this->_passBudget, levels * subpasses);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, this->_scheduleReadback);
+	glBufferStorage(
+		GL_SHADER_STORAGE_BUFFER,
+		this->_scheduleFences.size() * PASS_SCHEDULE_READBACK_WORDS * sizeof(GLuint),
+		nullptr,
+		GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT | GL_MAP_READ_BIT
+	);
+	this->_scheduleReadbackData = (GLuint*)glMapBufferRange(
+		GL_SHADER_STORAGE_BUFFER,
+		0,
+		this->_scheduleFences.size() * sizeof(GLuint),
+		GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT | GL_MAP_READ_BIT
+	);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	if (this->_scheduleReadbackData == nullptr) {
+		throw GraphicsException("failed to memory map pass schedule readback buffer", LOGGER_DETAIL_IDENTIFIER(this->id));
 	}
 }
 
 rgle::gfx::SparseVoxelRenderer::~SparseVoxelRenderer()
 {
 	glDeleteBuffers(1, &this->_rayBuffer);
-	glDeleteBuffers(static_cast<GLsizei>(this->_maxBufferDepth), &this->_passBuffers[0]);
-	glDeleteBuffers(static_cast<GLsizei>(this->_maxBufferDepth - 1), &this->_counterBuffers[0]);
+	glDeleteBuffers(1, &this->_passBuffer);
+	glDeleteBuffers(1, &this->_scheduleBuffer);
+	for (GLsync fence : this->_scheduleFences) {
+		if (fence != nullptr) {
+			glDeleteSync(fence);
+		}
+	}
+	glDeleteBuffers(1, &this->_scheduleReadback);
+	glDeleteQueries(static_cast<GLsizei>(this->_timerQueries.size()), this->_timerQueries.data());
 }
 
 std::shared_ptr<rgle::gfx::SparseVoxelCamera>& rgle::gfx::SparseVoxelRenderer::camera()
@@ -141,59 +251,27 @@ void rgle::gfx::SparseVoxelRenderer::update()
 
 void rgle::gfx::SparseVoxelRenderer::render()
 {
-	auto shader = this->shaderLocked();
-	shader->use();
-	size_t top = 0;
-	GLuint subPassSize = this->_resolution.x * this->_resolution.y;
-	this->_bootstrap(top);
-	bool first = true;
-	while (top > 0 || this->_subPassStack[top].offset < this->_subPassStack[top].count) {
-		glUniform1i(this->_location.bootstrap, first);
-		glUniform1i(this->_location.finalize, this->_lastSubPass(top));
-
-		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, RAY_BUFFER, this->_rayBuffer);
-		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, PASS_READ_BUFFER, this->_passBuffers[top]);
-		if (this->_lastSubPass(top)) {
-			subPassSize = this->_subPassStack[top].count - this->_subPassStack[top].offset;
-			glUniform1i(this->_location.finalize, true);
-			glUniform1ui(this->_location.subPassOffset, this->_subPassStack[top].offset);
-			glUniform1ui(this->_location.subPassSize, subPassSize);
-			glBindBufferBase(GL_ATOMIC_COUNTER_BUFFER, PASS_WRTIE_COUNTER, 0);
-			glBindBufferBase(GL_SHADER_STORAGE_BUFFER, PASS_WRITE_BUFFER, 0);
-		}
-		else {
-			subPassSize = this->_subPassSize(top);
-			glUniform1i(this->_location.finalize, false);
-			glBindBufferBase(GL_ATOMIC_COUNTER_BUFFER, PASS_WRTIE_COUNTER, this->_counterBuffers[top]);
-			glBindBufferBase(GL_SHADER_STORAGE_BUFFER, PASS_WRITE_BUFFER, this->_passBuffers[top + 1]);
-		}
-
-		glUniform1ui(this->_location.readPassSize, this->_subPassStack[top].count);
-		glUniform1ui(this->_location.subPassOffset, this->_subPassStack[top].offset);
-		glUniform1ui(this->_location.subPassSize, subPassSize);
-
-		glDispatchCompute(this->_numWorkGroups(subPassSize), 1, 1);
-		this->_subPassStack[top].offset += subPassSize;
-
-		if (this->_lastSubPass(top)) {
-			glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
-			top = this->_unwindStack(top);
-		}
-		else {
-			glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
-			glBindBuffer(GL_ATOMIC_COUNTER_BUFFER, this->_counterBuffers[top]);
-			glGetBufferSubData(GL_ATOMIC_COUNTER_BUFFER, 0, sizeof(GLuint), &this->_subPassStack[top + 1].count);
-			if (this->_subPassStack[top + 1].count > 0) {
-				top++;
-			} else {
-				top = this->_unwindStack(top);
-			}
-		}
-		first = false;
+	this->_beginFrame();
+	if (this->_beamPrepass) {
+		this->_beam();
+	}
+	if (this->_traversal == Traversal::STACKLESS) {
+		this->_renderStackless();
 	}
+	else {
+		this->_renderPasses();
+	}
+	this->_octree->endFrame();
+	glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
 	this->_realizeShader->use();
+	glUniform2ui(
+		this->_location.realizeResolution,
+		static_cast<GLuint>(this->_renderResolution.x),
+		static_cast<GLuint>(this->_renderResolution.y)
+	);
 	this->_octree->bind();
 	this->_imageRect.render();
+	glEndQuery(GL_TIME_ELAPSED);
 }
 
 const char * rgle::gfx::SparseVoxelRenderer::typeName() const
@@ -201,78 +279,304 @@ const char * rgle::gfx::SparseVoxelRenderer::typeName() const
 	return "rgle::gfx::SparseVoxelRenderer";
 }
 
-void rgle::gfx::SparseVoxelRenderer::_bootstrap(const size_t& index)
+rgle::gfx::SparseVoxelRenderer::Traversal rgle::gfx::SparseVoxelRenderer::traversal() const
+{
+	return this->_traversal;
+}
+
+std::shared_ptr<rgle::gfx::PersistentTexture2D> rgle::gfx::SparseVoxelRenderer::outTexture() const
+{
+	return this->_outTexture;
+}
+
+void rgle::gfx::SparseVoxelRenderer::_renderPasses()
+{
+	this->_readSchedules();
+	auto shader = this->shaderLocked();
+	shader->use();
+	this->_bootstrap();
+	// The schedule invocation writes the size of each pass into the indirect buffer, so the CPU issues a fixed number
+	// of passes and never waits on the GPU
+	this->_schedule(true);
+	for (size_t i = 0; i < this->_passBudget; i++) {
+		glUniform1i(this->_location.schedule, false);
+		glDispatchComputeIndirect(0);
+		glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+		this->_schedule(false);
+	}
+	// The size of the pass planned after the last one and the passes the frame needed are copied aside and read a few
+	// frames later, once the GPU got there, so the CPU never waits on them
+	size_t slot = this->_frame % this->_scheduleFences.size();
+	if (this->_scheduleFences[slot] != nullptr) {
+		glDeleteSync(this->_scheduleFences[slot]);
+	}
+	glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+	glCopyNamedBufferSubData(
+		this->_scheduleBuffer,
+		this->_scheduleReadback,
+		PASS_SCHEDULE_SUBPASS_SIZE * sizeof(GLuint),
+		slot * PASS_SCHEDULE_READBACK_WORDS * sizeof(GLuint),
+		PASS_SCHEDULE_READBACK_WORDS * sizeof(GLuint)
+	);
+	this->_scheduleFences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	this->_scheduleBudgets[slot] = this->_passBudget;
+}
+
+void rgle::gfx::SparseVoxelRenderer::_readSchedules()
+{
+	for (size_t slot = 0; slot < this->_scheduleFences.size(); slot++) {
+		GLsync fence = this->_scheduleFences[slot];
+		if (fence == nullptr) {
+			continue;
+		}
+		GLenum status = glClientWaitSync(fence, 0, 0);
+		if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+			continue;
+		}
+		glDeleteSync(fence);
+		this->_scheduleFences[slot] = nullptr;
+		const GLuint* words = this->_scheduleReadbackData + slot * PASS_SCHEDULE_READBACK_WORDS;
+		if (words[0] != 0) {
+			// Frames in flight ran with the same budget, doubling it from what the frame ran with avoids growing it once
+			// per frame that reports the same shortfall
+			this->_passBudget = std::max(this->_passBudget, 2 * this->_scheduleBudgets[slot]);
+			continue;
+		}
+		// A finished frame moves the budget an eighth of the way down to the passes it needed and a quarter more, so
+		// the empty dispatches left after a dense view fade out without cutting the next frames short
+		size_t needed = words[PASS_SCHEDULE_READBACK_PASSES];
+		size_t target = needed + needed / 4 + 1;
+		if (this->_passBudget > target) {
+			this->_passBudget -= (this->_passBudget - target + 7) / 8;
+		}
+	}
+}
+
+void rgle::gfx::SparseVoxelRenderer::_renderStackless()
 {
 	auto shader = this->shaderLocked();
-	// Restore the depth image
-	this->_depthTexture->update();
-	// Restore the output image
-	this->_outTexture->update();
-	glUniform1i(this->_location.rootNodeOffset, static_cast<GLint>(this->_octree->root()->index()));
-	glUniform1f(this->_location.rootNodeSize, this->_octree->root()->size());
-	this->_clearCounter(this->_counterBuffers[index]);
+	shader->use();
+	glUniform1i(this->_location.rootNodeOffset, ROOT_NODE);
+	glUniform1f(this->_location.rootNodeSize, this->_octree->rootSize());
+	glUniform1f(this->_location.lodBias, this->_lodBias);
+	glUniform1i(this->_location.beam, this->_beamPrepass);
 	this->transformer()->bind(shader);
 	glUniform2ui(
 		this->_location.renderResolution,
-		static_cast<GLuint>(this->_resolution.x),
-		static_cast<GLuint>(this->_resolution.y)
+		static_cast<GLuint>(this->_renderResolution.x),
+		static_cast<GLuint>(this->_renderResolution.y)
 	);
 	this->_octree->bind();
-	glUniform1i(this->_location.depthImage, this->_depthTexture->index());
-	this->_depthTexture->bindImage2D();
+	this->_octree->bindPaging(this->_location.paging);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, RAY_BUFFER, this->_rayBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, PASS_SCHEDULE_BUFFER, this->_scheduleBuffer);
+	// Every invocation writes its pixel, so the output image needs no reset between frames
 	glUniform1i(this->_location.outImage, this->_outTexture->index());
 	this->_outTexture->bindImage2D();
-	glUniform1i(this->_location.finalize, false);
+	GLuint pixels = static_cast<GLuint>(this->_renderResolution.x * this->_renderResolution.y);
+	glDispatchCompute((pixels + 63) / 64, 1, 1);
+}
+
+void rgle::gfx::SparseVoxelRenderer::_beam()
+{
+	this->_beamShader->use();
+	glUniform1i(this->_beamLocation.rootNodeOffset, ROOT_NODE);
+	glUniform1f(this->_beamLocation.rootNodeSize, this->_octree->rootSize());
+	glUniform1f(this->_beamLocation.lodBias, this->_lodBias);
+	// Tiles start no deeper than the traversal stops its rays, the pass traversal finalizes the level above the last
+	glUniform1ui(
+		this->_beamLocation.maxDepth,
+		this->_traversal == Traversal::PASS ? static_cast<GLuint>(this->_maxBufferDepth) - 1 : STACKLESS_MAX_STACK
+	);
+	this->transformer()->bind(this->_beamShader);
+	glUniform2ui(
+		this->_beamLocation.renderResolution,
+		static_cast<GLuint>(this->_renderResolution.x),
+		static_cast<GLuint>(this->_renderResolution.y)
+	);
+	this->_octree->bind();
+	this->_octree->bindPaging(this->_beamLocation.paging);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, RAY_BUFFER, this->_rayBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, PASS_SCHEDULE_BUFFER, this->_scheduleBuffer);
+	GLuint tiles = static_cast<GLuint>(beam_tiles(this->_renderResolution));
+	glDispatchCompute((tiles + 63) / 64, 1, 1);
 	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
-	for (size_t i = 0; i < this->_maxBufferDepth - 1; i++) {
-		this->_subPassStack[index].offset = 0;
-		this->_subPassStack[index].count = 0;
-	}
-	this->_subPassStack[index].offset = 0;
-	this->_subPassStack[index].count = this->_resolution.x * this->_resolution.y;
 }
 
-void rgle::gfx::SparseVoxelRenderer::_clearCounter(const GLuint& buffer)
+size_t & rgle::gfx::SparseVoxelRenderer::passBudget()
+{
+	return this->_passBudget;
+}
+
+const size_t & rgle::gfx::SparseVoxelRenderer::passBudget() const
+{
+	return this->_passBudget;
+}
+
+rgle::gfx::SparseVoxelQualityOptions & rgle::gfx::SparseVoxelRenderer::quality()
+{
+	return this->_quality;
+}
+
+const rgle::gfx::SparseVoxelQualityOptions & rgle::gfx::SparseVoxelRenderer::quality() const
+{
+	return this->_quality;
+}
+
+float & rgle::gfx::SparseVoxelRenderer::lodBias()
+{
+	return this->_lodBias;
+}
+
+const float & rgle::gfx::SparseVoxelRenderer::lodBias() const
 {
-	glBindBuffer(GL_ATOMIC_COUNTER_BUFFER, buffer);
-	const GLuint zero = 0;
-	glClearBufferData(GL_ATOMIC_COUNTER_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+	return this->_lodBias;
 }
 
-void rgle::gfx::SparseVoxelRenderer::_setCounter(const GLuint& buffer, const GLuint& value)
+float & rgle::gfx::SparseVoxelRenderer::resolutionScale()
 {
-	glBindBuffer(GL_ATOMIC_COUNTER_BUFFER, buffer);
-	glBufferSubData(GL_ATOMIC_COUNTER_BUFFER, 0, sizeof(GLuint), &value);
+	return this->_resolutionScale;
 }
 
-size_t rgle::gfx::SparseVoxelRenderer::_unwindStack(const size_t& top)
+const float & rgle::gfx::SparseVoxelRenderer::resolutionScale() const
 {
-	size_t result = top;
-	while (result > 0 && this->_subPassStack[result].offset >= this->_subPassStack[result].count) {
-		this->_subPassStack[result].offset = 0;
-		this->_subPassStack[result].count = 0;
-		result--;
-		this->_clearCounter(this->_counterBuffers[result]);
+	return this->_resolutionScale;
+}
+
+double rgle::gfx::SparseVoxelRenderer::gpuTime() const
+{
+	return this->_gpuTime;
+}
+
+void rgle::gfx::SparseVoxelRenderer::beamPrepass(bool enabled)
+{
+	if (enabled && !this->_beamShader) {
+		throw InvalidStateException("failed to enable the beam prepass, the renderer has no beam shader", LOGGER_DETAIL_DEFAULT);
 	}
-	return result;
+	this->_beamPrepass = enabled;
+}
+
+bool rgle::gfx::SparseVoxelRenderer::beamPrepass() const
+{
+	return this->_beamPrepass;
+}
+
+void rgle::gfx::SparseVoxelRenderer::_beginFrame()
+{
+	GLuint query = this->_timerQueries[this->_frame % this->_timerQueries.size()];
+	// The slot was last used a full ring of frames ago, reading it only once it is available never stalls the CPU
+	if (this->_frame >= this->_timerQueries.size()) {
+		GLint available = GL_FALSE;
+		glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+		if (available) {
+			GLuint64 elapsed = 0;
+			glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsed);
+			this->_adjustQuality(static_cast<double>(elapsed) / 1e6);
+		}
+	}
+	this->_applyResolution();
+	glBeginQuery(GL_TIME_ELAPSED, query);
+	this->_frame++;
 }
 
-GLuint rgle::gfx::SparseVoxelRenderer::_numWorkGroups(const GLuint& subPassSize) const
+void rgle::gfx::SparseVoxelRenderer::_adjustQuality(double milliseconds)
 {
-	return static_cast<GLuint>(std::ceil((float)subPassSize / 1024.0f));
+	this->_gpuTime = milliseconds;
+	const SparseVoxelQualityOptions& options = this->_quality;
+	if (options.frameBudget <= 0.0) {
+		return;
+	}
+	// Timings arrive a ring of queries late, acting on them before the last change shows up would overshoot
+	if (this->_settleFrames > 0) {
+		this->_settleFrames--;
+		return;
+	}
+	bool changed = false;
+	if (milliseconds > options.frameBudget) {
+		// Coarser nodes cost nothing to set up, the resolution only drops once the bias is exhausted
+		if (this->_lodBias < options.maxLodBias) {
+			this->_lodBias = std::min(this->_lodBias + LOD_BIAS_STEP, options.maxLodBias);
+			changed = true;
+		}
+		else if (this->_resolutionScale > options.minResolutionScale) {
+			this->_resolutionScale = std::max(this->_resolutionScale - RESOLUTION_SCALE_STEP, options.minResolutionScale);
+			changed = true;
+		}
+	}
+	else if (milliseconds < (1.0 - options.headroom) * options.frameBudget) {
+		// Quality returns in the reverse order it was given up
+		if (this->_resolutionScale < 1.0f) {
+			this->_resolutionScale = std::min(this->_resolutionScale + RESOLUTION_SCALE_STEP, 1.0f);
+			changed = true;
+		}
+		else if (this->_lodBias > 0.0f) {
+			this->_lodBias = std::max(this->_lodBias - LOD_BIAS_STEP, 0.0f);
+			changed = true;
+		}
+	}
+	if (changed) {
+		this->_settleFrames = this->_timerQueries.size();
+	}
 }
 
-constexpr bool rgle::gfx::SparseVoxelRenderer::_lastSubPass(const size_t& top) const
+void rgle::gfx::SparseVoxelRenderer::_applyResolution()
 {
-	return top >= this->_maxBufferDepth - 2;
+	glm::ivec2 resolution = glm::ivec2(glm::round(glm::vec2(this->_resolution) * this->_resolutionScale));
+	resolution = glm::clamp(resolution, glm::ivec2(1), this->_resolution);
+	if (resolution == this->_renderResolution) {
+		return;
+	}
+	this->_renderResolution = resolution;
+	// Rays are indexed by the pixel of the traced rectangle, so every ray moves with the scale
+	std::vector<glm::vec4> rayData(resolution.x * resolution.y);
+	for (int j = 0; j < resolution.y; j++) {
+		for (int i = 0; i < resolution.x; i++) {
+			rayData[i + j * resolution.x] = glm::vec4(this->_camera->pixelRay(i, j, resolution.x, resolution.y), 0.0f);
+		}
+	}
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, this->_rayBuffer);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, rayData.size() * sizeof(glm::vec4), rayData.data());
 }
 
-constexpr unsigned int rgle::gfx::SparseVoxelRenderer::_subPassSize(const size_t& top) const
+void rgle::gfx::SparseVoxelRenderer::_bootstrap()
 {
-	return std::min(
-		this->_subPassStack[top].count - this->_subPassStack[top].offset,
-		this->_bufferSizes[top + 1] / 8
+	auto shader = this->shaderLocked();
+	const GLuint uintMax = std::numeric_limits<GLuint>::max();
+	const GLint startIndex = -1;
+	// Restore the depth and output images on the GPU
+	this->_depthTexture->clear(&uintMax);
+	this->_outTexture->clear(&startIndex);
+	glUniform1i(this->_location.rootNodeOffset, ROOT_NODE);
+	glUniform1f(this->_location.rootNodeSize, this->_octree->rootSize());
+	glUniform1ui(this->_location.maxBufferDepth, static_cast<GLuint>(this->_maxBufferDepth));
+	glUniform1ui(this->_location.passCapacity, static_cast<GLuint>(this->_passCapacity));
+	glUniform1f(this->_location.lodBias, this->_lodBias);
+	glUniform1i(this->_location.beam, this->_beamPrepass);
+	this->transformer()->bind(shader);
+	glUniform2ui(
+		this->_location.renderResolution,
+		static_cast<GLuint>(this->_renderResolution.x),
+		static_cast<GLuint>(this->_renderResolution.y)
 	);
+	this->_octree->bind();
+	this->_octree->bindPaging(this->_location.paging);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, RAY_BUFFER, this->_rayBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, PASS_SCHEDULE_BUFFER, this->_scheduleBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, PASS_BUFFER, this->_passBuffer);
+	glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, this->_scheduleBuffer);
+	glUniform1i(this->_location.depthImage, this->_depthTexture->index());
+	this->_depthTexture->bindImage2D();
+	glUniform1i(this->_location.outImage, this->_outTexture->index());
+	this->_outTexture->bindImage2D();
+	glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+}
+
+void rgle::gfx::SparseVoxelRenderer::_schedule(bool reset)
+{
+	glUniform1i(this->_location.schedule, true);
+	glUniform1i(this->_location.reset, reset);
+	glDispatchCompute(1, 1, 1);
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
 }
 
 rgle::gfx::SparseVoxelCamera::SparseVoxelCamera(float near, float far, float fieldOfView) :
@@ -364,35 +668,62 @@ const glm::vec3 & rgle::gfx::SparseVoxelCamera::right() const
 	return this->_right;
 }
 
-rgle::gfx::SparseVoxelOctree::SparseVoxelOctree() : _top(0), _size(MIN_ALLOCATED)
+const glm::quat & rgle::gfx::SparseVoxelCamera::rotation() const
 {
-	glGenBuffers(1, &this->_octreeBuffer);
-	glBindBuffer(GL_SHADER_STORAGE_BUFFER, this->_octreeBuffer);
-	glBufferStorage(
-		GL_SHADER_STORAGE_BUFFER,
-		this->_size * BLOCK_SIZE,
-		nullptr,
-		GL_MAP_PERSISTENT_BIT | GL_MAP_WRITE_BIT
-	);
-	this->_octreeData = (unsigned char*)glMapBufferRange(
-		GL_SHADER_STORAGE_BUFFER,
-		0,
-		this->_size * BLOCK_SIZE,
-		GL_MAP_PERSISTENT_BIT | GL_MAP_WRITE_BIT | GL_MAP_FLUSH_EXPLICIT_BIT
-	);
-	if (this->_octreeData == nullptr) {
-		throw NullPointerException(LOGGER_DETAIL_DEFAULT);
-	}
-	this->_top++;
-	this->_root = new SparseVoxelNode(this);
-	this->_root->_depth = 0;
-	this->_root->_index = 0;
-	this->_root->update();
+	return this->_rotation;
+}
+
+float rgle::gfx::SparseVoxelCamera::nearClip() const
+{
+	return this->_near;
+}
+
+float rgle::gfx::SparseVoxelCamera::farClip() const
+{
+	return this->_far;
+}
+
+glm::vec3 rgle::gfx::SparseVoxelCamera::pixelRay(int x, int y, int width, int height) const
+{
+	glm::vec2 pixelAngle(this->_fieldOfView / width, this->_fieldOfView / height);
+	glm::vec2 delta = glm::ivec2(x, y) - glm::ivec2(width / 2, height / 2);
+	glm::vec2 theta(delta.x * pixelAngle.x, delta.y * pixelAngle.y);
+	return glm::normalize(glm::vec3(std::tanf(theta.x), std::tanf(theta.y), 1.0f));
+}
+
+rgle::gfx::SparseVoxelOctree::SparseVoxelOctree() :
+	_size(0),
+	_octreeBuffer(0),
+	_sparse(false),
+	_mapped{ 0, nullptr },
+	_staging{ 0, nullptr },
+	_stagingFences(),
+	_stagingSegment(0),
+	_chunkBlocks(0),
+	_uploadsPerFrame(0),
+	_feedbackCapacity(0),
+	_feedbackBuffer(0),
+	_feedbackData(nullptr),
+	_feedbackWords(0),
+	_feedbackFences(),
+	_feedbackFrames(),
+	_finishedFrame(0),
+	_frame(1)
+{
+	this->_createStorage();
 }
 
 rgle::gfx::SparseVoxelOctree::~SparseVoxelOctree()
 {
-	glDeleteBuffers(1, &this->_octreeBuffer);
+	// NOTE: the cache waits for the bricks being read before the buffers go away
+	this->_pages.reset();
+	for (GLsync fence : this->_feedbackFences) {
+		if (fence != nullptr) {
+			glDeleteSync(fence);
+		}
+	}
+	glDeleteBuffers(1, &this->_feedbackBuffer);
+	this->_releaseStorage();
 }
 
 void rgle::gfx::SparseVoxelOctree::bind() const
@@ -400,270 +731,1290 @@ void rgle::gfx::SparseVoxelOctree::bind() const
 	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SparseVoxelRenderer::OCTREE_BUFFER, this->_octreeBuffer);
 }
 
-rgle::gfx::SparseVoxelNode * rgle::gfx::SparseVoxelOctree::root() const
-{
-	return this->_root;
+void rgle::gfx::SparseVoxelOctree::bindPaging(const PagingLocation& location) const
+{
+	glUniform1i(location.paged, this->paged());
+	glUniform1ui(location.pageFrame, static_cast<GLuint>(this->_frame));
+	GLuint brickNodes = this->paged() ? 8 * this->_pages->file().header().brickBlocks : 1;
+	glUniform1ui(location.brickNodes, brickNodes);
+	if (this->paged()) {
+		size_t region = this->_frame % this->_feedbackFences.size();
+		glBindBufferRange(
+			GL_SHADER_STORAGE_BUFFER,
+			SparseVoxelRenderer::PAGE_FEEDBACK_BUFFER,
+			this->_feedbackBuffer,
+			region * this->_feedbackWords * sizeof(GLuint),
+			this->_feedbackWords * sizeof(GLuint)
+		);
+	}
 }
 
-void rgle::gfx::SparseVoxelOctree::flush()
+rgle::gfx::SparseVoxelOctree::PagingLocation rgle::gfx::SparseVoxelOctree::pagingLocation(const ShaderProgram& program)
 {
-	glBindBuffer(GL_SHADER_STORAGE_BUFFER, this->_octreeBuffer);
-	while (!this->_modifiedBlocks.empty()) {
-		util::Range<size_t> flushRange = this->_modifiedBlocks.pop();
-		glFlushMappedBufferRange(GL_SHADER_STORAGE_BUFFER, flushRange.lower * BLOCK_SIZE, flushRange.length() * BLOCK_SIZE);
-	}
-	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	return PagingLocation{ program.uniform("paged"), program.uniform("page_frame"), program.uniform("brick_nodes") };
 }
 
-const char * rgle::gfx::SparseVoxelOctree::typeName() const
+rgle::gfx::SparseVoxelNode rgle::gfx::SparseVoxelOctree::root()
 {
-	return "rgle::gfx::SparseVoxelOctree";
+	this->_decode();
+	return this->_pool.root();
 }
 
-size_t rgle::gfx::SparseVoxelOctree::_aquireBlock()
+float rgle::gfx::SparseVoxelOctree::rootSize() const
 {
-	size_t result;
-	if (this->_freeBlocks.empty()) {
-		result = this->_top++;
-		if (this->_top > this->_size) {
-			this->_realloc(ALLOCATION_FACTOR);
-		}
-		return result;
-	}
-	else {
-		result = this->_freeBlocks.back();
-		this->_freeBlocks.pop_back();
-		return result;
-	}
+	return this->_file != nullptr ? this->_file->header().rootSize : this->_pool.rootSize();
 }
 
-void rgle::gfx::SparseVoxelOctree::_realloc(float factor)
+rgle::gfx::SparseVoxelPool& rgle::gfx::SparseVoxelOctree::pool()
 {
-	size_t newsize = std::max(MIN_ALLOCATED, (size_t) factor * this->_size);
-	GLuint newbuffer;
-	glGenBuffers(1, &newbuffer);
-	glBindBuffer(GL_SHADER_STORAGE_BUFFER, newbuffer);
-	glBufferStorage(
-		GL_SHADER_STORAGE_BUFFER,
-		newsize * BLOCK_SIZE,
-		nullptr,
-		GL_MAP_PERSISTENT_BIT | GL_MAP_WRITE_BIT
-	);
-	glBindBuffer(GL_COPY_READ_BUFFER, this->_octreeBuffer);
-	glBindBuffer(GL_COPY_WRITE_BUFFER, newbuffer);
-	glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, this->_size * BLOCK_SIZE);
-	glDeleteBuffers(1, &this->_octreeBuffer);
-	this->_octreeBuffer = newbuffer;
-	this->_octreeData = (unsigned char*)glMapNamedBufferRange(
-		this->_octreeBuffer,
-		0,
-		newsize * BLOCK_SIZE,
-		GL_MAP_PERSISTENT_BIT | GL_MAP_WRITE_BIT | GL_MAP_FLUSH_EXPLICIT_BIT
-	);
-	if (this->_octreeData == nullptr) {
-		throw GraphicsException("failed to memory map octree buffer", LOGGER_DETAIL_IDENTIFIER(this->id));
-	}
-	this->_modifiedBlocks = util::CollectingQueue(util::Range<size_t>{ 0, this->_size });
-	this->_size = newsize;
+	this->_decode();
+	return this->_pool;
 }
 
-unsigned char * rgle::gfx::SparseVoxelOctree::_buffer(const size_t & at)
+const rgle::gfx::SparseVoxelPool& rgle::gfx::SparseVoxelOctree::pool() const
 {
-	if (at >= this->_top * 8) {
-		throw OutOfBoundsException(LOGGER_DETAIL_DEFAULT);
-	}
-	return this->_octreeData + at * SparseVoxelNodePayload::SIZE;
+	this->_decode();
+	return this->_pool;
 }
 
-void rgle::gfx::SparseVoxelRayPayload::mapToBuffer(unsigned char * buffer) const
+void rgle::gfx::SparseVoxelOctree::flush()
 {
-	unsigned char* next = (unsigned char*)std::memcpy(buffer, &this->pixel, sizeof(GLuint));
-	std::memcpy(next + sizeof(GLuint), &this->offset, sizeof(GLint));
+	if (this->paged()) {
+		this->_flushPages();
+		return;
+	}
+	// Edits decode the pool first, so the buffer still holds the blocks of the loaded file
+	if (this->_file != nullptr) {
+		return;
+	}
+	this->_grow(this->_pool.blockCount());
+	auto& modified = this->_pool.modifiedBlocks();
+	for (util::Range<size_t> flushRange : modified) {
+		// NOTE: defragmentation releases the blocks at the end of the pool, which may have been modified before
+		flushRange.upper = std::min(flushRange.upper, this->_pool.blockCount());
+		if (flushRange.lower >= flushRange.upper) {
+			break;
+		}
+		this->_writeBlocks(flushRange.lower, flushRange.upper, [this](size_t first, size_t count, unsigned char* data) {
+			for (size_t i = 0; i < count; i++) {
+				this->_writeBlock(first + i, data + i * BLOCK_SIZE);
+			}
+		});
+	}
+	modified.clear();
+	this->_shrink(this->_pool.blockCount());
 }
 
-rgle::gfx::SparseVoxelNode::SparseVoxelNode(SparseVoxelNode && rvalue)
+void rgle::gfx::SparseVoxelOctree::begin()
 {
-	this->_children = rvalue._children;
-	this->_color = rvalue._color;
-	this->_depth = rvalue._depth;
-	this->_index = rvalue._index;
-	this->_octree = rvalue._octree;
-	this->_parent = rvalue._parent;
-	this->_position = rvalue._position;
-	this->_size = rvalue._size;
+	this->_decode();
+	this->_pool.begin();
 }
 
-rgle::gfx::SparseVoxelNode::~SparseVoxelNode()
+void rgle::gfx::SparseVoxelOctree::insert(SparseVoxelNode node, std::array<glm::vec4, 8> colors)
 {
+	node.insertChildren(colors);
 }
 
-void rgle::gfx::SparseVoxelNode::operator=(SparseVoxelNode && rvalue)
+void rgle::gfx::SparseVoxelOctree::remove(SparseVoxelNode node)
 {
-	std::swap(this->_children, rvalue._children);
-	this->_color = rvalue._color;
-	this->_depth = rvalue._depth;
-	this->_index = rvalue._index;
-	this->_octree = rvalue._octree;
-	this->_parent = rvalue._parent;
-	this->_position = rvalue._position;
-	this->_size = rvalue._size;
+	this->_decode();
+	this->_pool.remove(node);
 }
 
-rgle::gfx::SparseVoxelNode * rgle::gfx::SparseVoxelNode::child(OctreeIndex::X x, OctreeIndex::Y y, OctreeIndex::Z z) const
+void rgle::gfx::SparseVoxelOctree::removeChildren(SparseVoxelNode node)
 {
-	if (this->_children == nullptr) {
-		return nullptr;
-	}
-	return &this->_children[OctreeIndex::to_index(x, y, z)];
+	this->_decode();
+	this->_pool.removeChildren(node);
 }
 
-rgle::gfx::SparseVoxelNode * rgle::gfx::SparseVoxelNode::parent() const
+void rgle::gfx::SparseVoxelOctree::commit()
 {
-	return this->_parent;
+	this->_decode();
+	this->_pool.commit();
 }
 
-void rgle::gfx::SparseVoxelNode::insertChildren(std::array<glm::vec4, 8> colors)
+void rgle::gfx::SparseVoxelOctree::commit(sync::ThreadPool& threads)
 {
-	if (!this->leaf()) {
-		throw InvalidStateException("failed to create octree children, they already exist", LOGGER_DETAIL_DEFAULT);
-	}
-	this->_children = new SparseVoxelNode[8];
-	size_t block = this->_octree->_aquireBlock() * 8;
-	OctreeIndex::X x;
-	OctreeIndex::Y y;
-	OctreeIndex::Z z;
-	for (int i = 0; i < 8; i++) {
-		this->_children[i] = SparseVoxelNode(this->_octree);
-		this->_children[i]._color = colors[i];
-		this->_children[i]._parent = this;
-		this->_children[i]._depth = this->_depth + 1;
-		this->_children[i]._size = this->_size / 2;
-		OctreeIndex::from_index(i, x, y, z);
-		this->_children[i]._position = this->_childPosition(x, y, z);
-		this->_children[i]._index = block + i;
-		this->_children[i].update();
-	}
-	this->_propagateChanges();
+	this->_decode();
+	this->_pool.commit(threads);
 }
 
-bool rgle::gfx::SparseVoxelNode::leaf() const
+bool rgle::gfx::SparseVoxelOctree::defragment(std::chrono::microseconds budget)
 {
-	return this->_children == nullptr;
+	this->_decode();
+	return this->_pool.defragment(budget);
 }
 
-bool rgle::gfx::SparseVoxelNode::root() const
+rgle::gfx::SparseVoxelCompressStatistics rgle::gfx::SparseVoxelOctree::compress()
 {
-	return this->_parent == nullptr;
+	this->_decode();
+	return this->_pool.compress();
 }
 
-size_t rgle::gfx::SparseVoxelNode::index() const
+rgle::gfx::SparseVoxelCompressStatistics rgle::gfx::SparseVoxelOctree::compress(sync::ThreadPool& threads)
 {
-	return this->_index;
+	this->_decode();
+	return this->_pool.compress(threads);
 }
 
-size_t rgle::gfx::SparseVoxelNode::depth() const
+void rgle::gfx::SparseVoxelOctree::save(const std::string& filename) const
 {
-	return this->_depth;
+	this->_decode();
+	SparseVoxelFile::write(filename, this->_pool);
 }
 
-float & rgle::gfx::SparseVoxelNode::size()
+void rgle::gfx::SparseVoxelOctree::load(const std::string& filename)
 {
-	return this->_size;
+	this->_load(filename, nullptr);
 }
 
-const float & rgle::gfx::SparseVoxelNode::size() const
+void rgle::gfx::SparseVoxelOctree::load(const std::string& filename, sync::ThreadPool& threads)
 {
-	return this->_size;
+	this->_load(filename, &threads);
 }
 
-glm::vec4 & rgle::gfx::SparseVoxelNode::color()
+void rgle::gfx::SparseVoxelOctree::page(const std::string& filename)
 {
-	return this->_color;
+	this->page(filename, SparseVoxelPageOptions{}, std::make_shared<sync::ThreadPool>());
 }
 
-const glm::vec4 & rgle::gfx::SparseVoxelNode::color() const
+void rgle::gfx::SparseVoxelOctree::page(const std::string& filename, const SparseVoxelPageOptions& options, std::shared_ptr<sync::ThreadPool> loader)
 {
-	return this->_color;
+	auto file = std::make_shared<SparseVoxelBrickFile>(filename);
+	size_t slots = options.budget / file->brickSize();
+	this->_pages.reset();
+	this->_pages = std::make_unique<SparseVoxelPageCache>(file, slots, loader);
+	this->_uploadsPerFrame = options.uploadsPerFrame;
+	this->_feedbackCapacity = options.feedbackCapacity;
+	this->_file.reset();
+	this->_pool = SparseVoxelPool();
+	this->_pool.rootSize() = file->header().rootSize;
+	this->_pool.modifiedBlocks().clear();
+
+	// NOTE: the cache addresses its slots in one contiguous mapping, so a paged octree always has a single chunk
+	this->_allocate(slots * file->header().brickBlocks);
+	util::Range<size_t> root = this->_pages->initialize(this->_mapped.data);
+	this->_flushBlocks(root.lower, root.upper);
+
+	// Requests, then the frame each slot was last visited, then the frame each brick was last requested, once per region
+	GLint alignment = 1;
+	glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &alignment);
+	size_t alignmentWords = std::max<size_t>(1, static_cast<size_t>(alignment) / sizeof(GLuint));
+	this->_feedbackWords = PAGE_FEEDBACK_HEADER + this->_feedbackCapacity + slots + static_cast<size_t>(file->header().brickCount);
+	this->_feedbackWords = (this->_feedbackWords + alignmentWords - 1) / alignmentWords * alignmentWords;
+	size_t words = this->_feedbackWords * this->_feedbackFences.size();
+	for (GLsync& fence : this->_feedbackFences) {
+		if (fence != nullptr) {
+			glDeleteSync(fence);
+			fence = nullptr;
+		}
+	}
+	this->_feedbackFrames.fill(0);
+	this->_finishedFrame = 0;
+	glDeleteBuffers(1, &this->_feedbackBuffer);
+	glGenBuffers(1, &this->_feedbackBuffer);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, this->_feedbackBuffer);
+	glBufferStorage(
+		GL_SHADER_STORAGE_BUFFER,
+		words * sizeof(GLuint),
+		nullptr,
+		GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT | GL_MAP_READ_BIT | GL_MAP_WRITE_BIT
+	);
+	this->_feedbackData = (GLuint*)glMapBufferRange(
+		GL_SHADER_STORAGE_BUFFER,
+		0,
+		words * sizeof(GLuint),
+		GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT | GL_MAP_READ_BIT | GL_MAP_WRITE_BIT
+	);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	if (this->_feedbackData == nullptr) {
+		throw GraphicsException("failed to memory map page feedback buffer", LOGGER_DETAIL_IDENTIFIER(this->id));
+	}
+	std::memset(this->_feedbackData, 0, words * sizeof(GLuint));
+	for (size_t region = 0; region < this->_feedbackFences.size(); region++) {
+		GLuint* header = this->_feedbackData + region * this->_feedbackWords;
+		header[1] = static_cast<GLuint>(this->_feedbackCapacity);
+		header[2] = static_cast<GLuint>(slots);
+		header[3] = static_cast<GLuint>(file->header().brickCount);
+	}
+	this->_frame = 1;
 }
 
-void rgle::gfx::SparseVoxelNode::update()
+bool rgle::gfx::SparseVoxelOctree::paged() const
 {
-	unsigned char* buffer = this->_octree->_buffer(this->_index);
-	SparseVoxelNodePayload payload = this->toPayload();
-	payload.mapToBuffer(buffer);
-	this->_octree->_modifiedBlocks.push(this->_index / 8);
+	return this->_pages != nullptr;
 }
 
-rgle::gfx::SparseVoxelNodePayload rgle::gfx::SparseVoxelNode::toPayload() const
+const rgle::gfx::SparseVoxelPageCache* rgle::gfx::SparseVoxelOctree::pageCache() const
 {
-	SparseVoxelNodePayload payload;
-	payload.color = this->_color;
-	payload.depth = static_cast<GLuint>(this->_depth);
-	payload.next = this->leaf() ? -1 : static_cast<GLint>(this->_children[0]._index);
-	payload.position = this->_position;
-	return payload;
+	return this->_pages.get();
 }
 
-rgle::gfx::SparseVoxelNode::SparseVoxelNode() :
-	_index(0),
-	_depth(0),
-	_color(0.0f, 0.0f, 0.0f, 0.0f),
-	_position(0.0f, 0.0f, 0.0f),
-	_size(0.0f),
-	_children(nullptr),
-	_octree(nullptr)
+void rgle::gfx::SparseVoxelOctree::endFrame()
 {
+	if (!this->paged()) {
+		return;
+	}
+	glMemoryBarrier(GL_CLIENT_MAPPED_BUFFER_BARRIER_BIT);
+	// A region whose feedback was not read yet collects this frame too, the new fence covers both frames
+	size_t region = this->_frame % this->_feedbackFences.size();
+	if (this->_feedbackFences[region] != nullptr) {
+		glDeleteSync(this->_feedbackFences[region]);
+	}
+	this->_feedbackFences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	this->_feedbackFrames[region] = this->_frame;
+	this->_frame++;
 }
 
-rgle::gfx::SparseVoxelNode::SparseVoxelNode(SparseVoxelOctree * octree) :
-	_index(0),
-	_depth(0),
-	_color(0.0f, 0.0f, 0.0f, 0.0f),
-	_position(0.0f, 0.0f, 0.0f),
-	_size(0.0f),
-	_children(nullptr),
-	_parent(nullptr),
-	_octree(octree)
+const char * rgle::gfx::SparseVoxelOctree::typeName() const
 {
+	return "rgle::gfx::SparseVoxelOctree";
 }
 
-glm::vec3 rgle::gfx::SparseVoxelNode::_childPosition(OctreeIndex::X x, OctreeIndex::Y y, OctreeIndex::Z z) const
+void rgle::gfx::SparseVoxelOctree::_createStorage()
 {
-	glm::vec3 result = this->_position;
-	float quarter = this->_size / 4;
-	result.x += x == OctreeIndex::RIGHT ? quarter : -quarter;
-	result.y += y == OctreeIndex::TOP ? quarter : -quarter;
-	result.z += z == OctreeIndex::FRONT ? quarter : -quarter;
-	return result;
+	this->_releaseStorage();
+	if (!GLEW_ARB_sparse_buffer) {
+		this->_allocate(MIN_ALLOCATED);
+		return;
+	}
+	// Chunks are committed as a whole, so they span whole pages
+	GLint pageSize = 0;
+	glGetIntegerv(GL_SPARSE_BUFFER_PAGE_SIZE_ARB, &pageSize);
+	size_t pageBlocks = std::max<size_t>(1, static_cast<size_t>(pageSize) / BLOCK_SIZE);
+	this->_chunkBlocks = (CHUNK_BLOCKS + pageBlocks - 1) / pageBlocks * pageBlocks;
+	size_t chunks = (SparseVoxelPool::MAX_BLOCKS + this->_chunkBlocks - 1) / this->_chunkBlocks;
+	this->_staging = this->_createChunk(this->_stagingFences.size() * this->_chunkBlocks);
+	glGenBuffers(1, &this->_octreeBuffer);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, this->_octreeBuffer);
+	glBufferStorage(GL_SHADER_STORAGE_BUFFER, chunks * this->_chunkBlocks * BLOCK_SIZE, nullptr, GL_SPARSE_STORAGE_BIT_ARB);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	this->_sparse = true;
+	this->_grow(MIN_ALLOCATED);
 }
 
-void rgle::gfx::SparseVoxelNode::_propagateChanges()
+void rgle::gfx::SparseVoxelOctree::_releaseStorage()
 {
-	if (!this->leaf()) {
-		this->_color = util::Color::blend({
-			this->_children[0]._color,
-			this->_children[1]._color,
-			this->_children[2]._color,
-			this->_children[3]._color,
-			this->_children[4]._color,
-			this->_children[5]._color,
-			this->_children[6]._color,
-			this->_children[7]._color
-		});
-		this->update();
+	for (GLsync& fence : this->_stagingFences) {
+		if (fence != nullptr) {
+			glDeleteSync(fence);
+			fence = nullptr;
+		}
 	}
-	if (!this->root()) {
-		this->_parent->_propagateChanges();
+	// NOTE: zero names are ignored, so each buffer is deleted whether the storage was sparse or not
+	glDeleteBuffers(1, &this->_staging.buffer);
+	glDeleteBuffers(1, &this->_mapped.buffer);
+	if (this->_sparse) {
+		glDeleteBuffers(1, &this->_octreeBuffer);
 	}
+	this->_staging = Chunk{ 0, nullptr };
+	this->_mapped = Chunk{ 0, nullptr };
+	this->_stagingSegment = 0;
+	this->_octreeBuffer = 0;
+	this->_sparse = false;
+	this->_size = 0;
 }
 
-void rgle::gfx::SparseVoxelNodePayload::mapToBuffer(unsigned char * buffer) const
+rgle::gfx::SparseVoxelOctree::Chunk rgle::gfx::SparseVoxelOctree::_createChunk(size_t blocks)
+{
+	Chunk chunk;
+	glGenBuffers(1, &chunk.buffer);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, chunk.buffer);
+	glBufferStorage(
+		GL_SHADER_STORAGE_BUFFER,
+		blocks * BLOCK_SIZE,
+		nullptr,
+		GL_MAP_PERSISTENT_BIT | GL_MAP_WRITE_BIT
+	);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	chunk.data = (unsigned char*)glMapNamedBufferRange(
+		chunk.buffer,
+		0,
+		blocks * BLOCK_SIZE,
+		GL_MAP_PERSISTENT_BIT | GL_MAP_WRITE_BIT | GL_MAP_FLUSH_EXPLICIT_BIT
+	);
+	if (chunk.data == nullptr) {
+		glDeleteBuffers(1, &chunk.buffer);
+		throw GraphicsException("failed to memory map octree buffer", LOGGER_DETAIL_IDENTIFIER(this->id));
+	}
+	return chunk;
+}
+
+void rgle::gfx::SparseVoxelOctree::_allocate(size_t blocks)
+{
+	Chunk chunk = this->_createChunk(blocks);
+	this->_releaseStorage();
+	this->_mapped = chunk;
+	this->_octreeBuffer = chunk.buffer;
+	this->_size = blocks;
+}
+
+void rgle::gfx::SparseVoxelOctree::_realloc(size_t minimum)
+{
+	size_t newsize = std::max(std::max(MIN_ALLOCATED, static_cast<size_t>(ALLOCATION_FACTOR * this->_size)), minimum);
+	Chunk chunk = this->_createChunk(newsize);
+	// The blocks already flushed are copied on the GPU instead of being written again from the pool
+	glCopyNamedBufferSubData(this->_mapped.buffer, chunk.buffer, 0, 0, this->_size * BLOCK_SIZE);
+	// Blocks written through the new mapping must not be overwritten by the copy, growing is rare enough to wait for it
+	GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, STAGING_TIMEOUT) == GL_TIMEOUT_EXPIRED) {
+	}
+	glDeleteSync(fence);
+	this->_releaseStorage();
+	this->_mapped = chunk;
+	this->_octreeBuffer = chunk.buffer;
+	this->_size = newsize;
+}
+
+void rgle::gfx::SparseVoxelOctree::_grow(size_t blocks)
+{
+	if (blocks <= this->_size) {
+		return;
+	}
+	if (!this->_sparse) {
+		this->_realloc(blocks);
+		return;
+	}
+	// New chunks are committed behind the others, the blocks written before stay where they are
+	const size_t chunkSize = this->_chunkBlocks * BLOCK_SIZE;
+	while (this->_size < blocks) {
+		glNamedBufferPageCommitmentARB(this->_octreeBuffer, this->_size * BLOCK_SIZE, chunkSize, GL_TRUE);
+		this->_size += this->_chunkBlocks;
+	}
+}
+
+void rgle::gfx::SparseVoxelOctree::_shrink(size_t blocks)
+{
+	if (!this->_sparse) {
+		return;
+	}
+	// One spare chunk stays committed, so a pool growing and shrinking around a chunk boundary does not commit pages
+	// every flush
+	const size_t chunkSize = this->_chunkBlocks * BLOCK_SIZE;
+	while (this->_size >= std::max(blocks, MIN_ALLOCATED) + 2 * this->_chunkBlocks) {
+		this->_size -= this->_chunkBlocks;
+		glNamedBufferPageCommitmentARB(this->_octreeBuffer, this->_size * BLOCK_SIZE, chunkSize, GL_FALSE);
+	}
+}
+
+void rgle::gfx::SparseVoxelOctree::_writeBlocks(size_t lower, size_t upper, const std::function<void(size_t, size_t, unsigned char*)>& write)
+{
+	if (!this->_sparse) {
+		write(lower, upper - lower, this->_mapped.data + lower * BLOCK_SIZE);
+		this->_flushBlocks(lower, upper);
+		return;
+	}
+	while (lower < upper) {
+		size_t count = std::min(upper - lower, this->_chunkBlocks);
+		size_t segment = this->_stagingSegment;
+		this->_stagingSegment = (segment + 1) % this->_stagingFences.size();
+		// A segment is only written again once the copy out of it is done, which waits only when a single flush writes
+		// more blocks than the ring holds
+		GLsync& fence = this->_stagingFences[segment];
+		if (fence != nullptr) {
+			while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, STAGING_TIMEOUT) == GL_TIMEOUT_EXPIRED) {
+			}
+			glDeleteSync(fence);
+		}
+		size_t offset = segment * this->_chunkBlocks * BLOCK_SIZE;
+		write(lower, count, this->_staging.data + offset);
+		glFlushMappedNamedBufferRange(this->_staging.buffer, offset, count * BLOCK_SIZE);
+		glCopyNamedBufferSubData(this->_staging.buffer, this->_octreeBuffer, offset, lower * BLOCK_SIZE, count * BLOCK_SIZE);
+		fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		lower += count;
+	}
+}
+
+void rgle::gfx::SparseVoxelOctree::_flushBlocks(size_t lower, size_t upper)
+{
+	glFlushMappedNamedBufferRange(this->_mapped.buffer, lower * BLOCK_SIZE, (upper - lower) * BLOCK_SIZE);
+}
+
+void rgle::gfx::SparseVoxelOctree::_writeBlock(size_t block, unsigned char* buffer)
+{
+	for (size_t i = 0; i < 8; i++) {
+		SparseVoxelNode(&this->_pool, static_cast<uint32_t>(8 * block + i)).toPayload().mapToBuffer(buffer + i * SparseVoxelNodePayload::SIZE);
+	}
+}
+
+void rgle::gfx::SparseVoxelOctree::_load(const std::string& filename, sync::ThreadPool* threads)
+{
+	auto file = std::make_unique<SparseVoxelFile>(filename);
+	if (this->paged()) {
+		this->_pages.reset();
+		this->_createStorage();
+	}
+	this->_file.reset();
+	this->_pool = SparseVoxelPool();
+	size_t blocks = static_cast<size_t>(file->header().blockCount);
+	this->_grow(blocks);
+	// The file stores the blocks in the buffer layout, copy them as they are instead of writing them block by block
+	this->_writeBlocks(0, blocks, [&file](size_t first, size_t count, unsigned char* data) {
+		std::memcpy(data, file->blocks() + first * BLOCK_SIZE, count * BLOCK_SIZE);
+	});
+	if (threads != nullptr) {
+		this->_pool.load(*file, *threads);
+		this->_pool.modifiedBlocks().clear();
+		return;
+	}
+	this->_file = std::move(file);
+}
+
+void rgle::gfx::SparseVoxelOctree::_decode() const
+{
+	if (this->_file == nullptr) {
+		return;
+	}
+	// The buffer already holds the blocks of the file, so the decoded pool has nothing to flush
+	this->_pool.load(*this->_file);
+	this->_pool.modifiedBlocks().clear();
+	this->_file.reset();
+}
+
+void rgle::gfx::SparseVoxelOctree::_flushPages()
+{
+	this->_pool.modifiedBlocks().clear();
+	// Frames finish in order, so the regions are read oldest frame first up to the first frame the GPU is still tracing
+	std::array<size_t, 3> regions = { 0, 1, 2 };
+	std::sort(regions.begin(), regions.end(), [this](size_t a, size_t b) {
+		return this->_feedbackFrames[a] < this->_feedbackFrames[b];
+	});
+	size_t slots = this->_pages->statistics().slots;
+	for (size_t region : regions) {
+		GLsync fence = this->_feedbackFences[region];
+		if (fence == nullptr) {
+			continue;
+		}
+		GLenum status = glClientWaitSync(fence, 0, 0);
+		if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+			break;
+		}
+		glDeleteSync(fence);
+		this->_feedbackFences[region] = nullptr;
+		GLuint* header = this->_feedbackData + region * this->_feedbackWords;
+		GLuint* requests = header + PAGE_FEEDBACK_HEADER;
+		GLuint* usage = requests + this->_feedbackCapacity;
+		for (size_t slot = 0; slot < slots; slot++) {
+			if (usage[slot] != 0) {
+				this->_pages->touch(slot, usage[slot]);
+			}
+		}
+		size_t count = std::min<size_t>(header[0], this->_feedbackCapacity);
+		this->_pages->request(std::span<const uint32_t>(requests, count));
+		header[0] = 0;
+		this->_finishedFrame = this->_feedbackFrames[region];
+	}
+
+	auto written = this->_pages->update(this->_mapped.data, this->_uploadsPerFrame, this->_finishedFrame);
+	for (const auto& range : written) {
+		this->_flushBlocks(range.lower, range.upper);
+	}
+}
+
+void rgle::gfx::SparseVoxelRayPayload::mapToBuffer(unsigned char * buffer) const
+{
+	unsigned char* next = (unsigned char*)std::memcpy(buffer, &this->pixel, sizeof(GLuint));
+	next = (unsigned char*)std::memcpy(next + sizeof(GLuint), &this->offset, sizeof(GLint));
+	next = (unsigned char*)std::memcpy(next + sizeof(GLint), &this->depth, sizeof(GLuint));
+	std::memcpy(next + sizeof(GLuint), &this->position.x, 3 * sizeof(GLfloat));
+}
+
+const uint32_t rgle::gfx::SparseVoxelPool::NO_CHILDREN = std::numeric_limits<uint32_t>::max();
+const size_t rgle::gfx::SparseVoxelPool::MAX_BLOCKS = size_t(1) << 24;
+
+rgle::gfx::SparseVoxelNode::SparseVoxelNode() : _pool(nullptr), _index(0)
+{
+}
+
+rgle::gfx::SparseVoxelNode::SparseVoxelNode(SparseVoxelPool* pool, uint32_t index) : _pool(pool), _index(index)
+{
+}
+
+rgle::gfx::SparseVoxelNode rgle::gfx::SparseVoxelNode::child(OctreeIndex::X x, OctreeIndex::Y y, OctreeIndex::Z z) const
+{
+	if (this->leaf()) {
+		return SparseVoxelNode();
+	}
+	return SparseVoxelNode(this->_pool, this->_pool->_children[this->_index] + static_cast<uint32_t>(OctreeIndex::to_index(x, y, z)));
+}
+
+rgle::gfx::SparseVoxelNode rgle::gfx::SparseVoxelNode::parent() const
+{
+	if (this->root()) {
+		return SparseVoxelNode();
+	}
+	return SparseVoxelNode(this->_pool, this->_pool->_parents[this->_index / 8]);
+}
+
+void rgle::gfx::SparseVoxelNode::insertChildren(std::array<glm::vec4, 8> colors)
+{
+	if (!this->leaf()) {
+		throw InvalidStateException("failed to create octree children, they already exist", LOGGER_DETAIL_DEFAULT);
+	}
+	if (this->_pool->_shared) {
+		throw InvalidStateException("failed to create octree children, the octree has shared blocks", LOGGER_DETAIL_DEFAULT);
+	}
+	if (this->depth() >= std::numeric_limits<uint8_t>::max()) {
+		throw InvalidStateException("failed to create octree children, the octree is too deep", LOGGER_DETAIL_DEFAULT);
+	}
+	uint32_t block = this->_pool->acquireBlock();
+	this->_pool->_parents[block] = this->_index;
+	this->_pool->_depths[block] = static_cast<uint8_t>(this->depth() + 1);
+	for (uint32_t i = 0; i < 8; i++) {
+		this->_pool->_colors[8 * block + i] = colors[i];
+		this->_pool->_children[8 * block + i] = SparseVoxelPool::NO_CHILDREN;
+	}
+	this->_pool->_children[this->_index] = 8 * block;
+	if (this->_pool->_editing) {
+		this->_pool->_editedBlocks.push_back(block);
+		this->_pool->_editedNodes.push_back(this->_index);
+		return;
+	}
+	this->_pool->_modifiedBlocks.push(block);
+	this->_propagateChanges();
+}
+
+bool rgle::gfx::SparseVoxelNode::valid() const
+{
+	return this->_pool != nullptr;
+}
+
+bool rgle::gfx::SparseVoxelNode::leaf() const
+{
+	return this->_pool->_children[this->_index] == SparseVoxelPool::NO_CHILDREN;
+}
+
+bool rgle::gfx::SparseVoxelNode::root() const
+{
+	return this->_index < 8;
+}
+
+size_t rgle::gfx::SparseVoxelNode::index() const
+{
+	return this->_index;
+}
+
+size_t rgle::gfx::SparseVoxelNode::depth() const
+{
+	return this->_pool->_depths[this->_index / 8];
+}
+
+float rgle::gfx::SparseVoxelNode::size() const
+{
+	return std::ldexp(this->_pool->_rootSize, -static_cast<int>(this->depth()));
+}
+
+glm::vec3 rgle::gfx::SparseVoxelNode::position() const
+{
+	return this->_pool->_position(this->_index);
+}
+
+glm::vec4 & rgle::gfx::SparseVoxelNode::color()
+{
+	return this->_pool->_colors[this->_index];
+}
+
+const glm::vec4 & rgle::gfx::SparseVoxelNode::color() const
+{
+	return this->_pool->_colors[this->_index];
+}
+
+void rgle::gfx::SparseVoxelNode::update()
+{
+	this->_pool->_markModified(this->_index / 8);
+	if (!this->root()) {
+		this->_pool->_markModified(this->_pool->_parents[this->_index / 8] / 8);
+	}
+}
+
+rgle::gfx::SparseVoxelNodePayload rgle::gfx::SparseVoxelNode::toPayload() const
+{
+	return this->_pool->payload(this->_index);
+}
+
+void rgle::gfx::SparseVoxelNode::_propagateChanges()
+{
+	if (!this->leaf()) {
+		this->_pool->_blend(this->_index);
+		this->update();
+	}
+	if (!this->root()) {
+		this->parent()._propagateChanges();
+	}
+}
+
+rgle::gfx::SparseVoxelPool::SparseVoxelPool() : _defragmentCursor(0), _defragmentReset(0), _rootSize(1.0f), _shared(false), _editing(false)
+{
+	// Block 0 only holds the root, its remaining slots stay transparent leaves
+	this->acquireBlock();
+	this->_parents[0] = NO_CHILDREN;
+	this->_depths[0] = 0;
+	this->_modifiedBlocks.push(0);
+}
+
+rgle::gfx::SparseVoxelNode rgle::gfx::SparseVoxelPool::root()
+{
+	return SparseVoxelNode(this, 0);
+}
+
+float& rgle::gfx::SparseVoxelPool::rootSize()
+{
+	return this->_rootSize;
+}
+
+const float& rgle::gfx::SparseVoxelPool::rootSize() const
+{
+	return this->_rootSize;
+}
+
+uint32_t rgle::gfx::SparseVoxelPool::acquireBlock()
+{
+	while (!this->_freeBlocks.empty()) {
+		uint32_t result = this->_freeBlocks.back();
+		this->_freeBlocks.pop_back();
+		if (result < this->_parents.size() && this->_free(result)) {
+			return result;
+		}
+	}
+	if (this->_parents.size() >= MAX_BLOCKS) {
+		throw OutOfBoundsException(LOGGER_DETAIL_DEFAULT);
+	}
+	uint32_t result = static_cast<uint32_t>(this->_parents.size());
+	this->_colors.resize(this->_colors.size() + 8, glm::vec4(0.0f, 0.0f, 0.0f, 0.0f));
+	this->_children.resize(this->_children.size() + 8, NO_CHILDREN);
+	this->_parents.push_back(NO_CHILDREN);
+	this->_depths.push_back(0);
+	return result;
+}
+
+size_t rgle::gfx::SparseVoxelPool::blockCount() const
+{
+	return this->_parents.size();
+}
+
+size_t rgle::gfx::SparseVoxelPool::memoryUsage() const
+{
+	return this->_colors.capacity() * sizeof(glm::vec4) +
+		this->_children.capacity() * sizeof(uint32_t) +
+		this->_parents.capacity() * sizeof(uint32_t) +
+		this->_depths.capacity() * sizeof(uint8_t) +
+		this->_freeBlocks.size() * sizeof(uint32_t);
+}
+
+rgle::util::IntervalSet<size_t>& rgle::gfx::SparseVoxelPool::modifiedBlocks()
+{
+	return this->_modifiedBlocks;
+}
+
+rgle::gfx::SparseVoxelNodePayload rgle::gfx::SparseVoxelPool::payload(uint32_t index) const
+{
+	SparseVoxelNodePayload payload;
+	payload.color = SparseVoxelNodePayload::packColor(this->_colors[index]);
+	payload.children = 0;
+	uint32_t first = this->_children[index];
+	if (first != NO_CHILDREN) {
+		payload.children = (first / 8) << 8;
+		for (uint32_t i = 0; i < 8; i++) {
+			// NOTE: the mask tests the packed alpha so it agrees with what the shaders read
+			if ((SparseVoxelNodePayload::packColor(this->_colors[first + i]) >> 24) != 0) {
+				payload.children |= 1u << i;
+			}
+		}
+	}
+	return payload;
+}
+
+void rgle::gfx::SparseVoxelPool::begin()
+{
+	if (this->_editing) {
+		throw InvalidStateException("failed to begin octree edits, a transaction is already open", LOGGER_DETAIL_DEFAULT);
+	}
+	if (this->_shared) {
+		throw InvalidStateException("failed to begin octree edits, the octree has shared blocks", LOGGER_DETAIL_DEFAULT);
+	}
+	this->_editing = true;
+}
+
+void rgle::gfx::SparseVoxelPool::commit()
+{
+	this->_commit(nullptr);
+}
+
+void rgle::gfx::SparseVoxelPool::commit(sync::ThreadPool& threads)
+{
+	this->_commit(&threads);
+}
+
+bool rgle::gfx::SparseVoxelPool::editing() const
+{
+	return this->_editing;
+}
+
+void rgle::gfx::SparseVoxelPool::remove(SparseVoxelNode node)
+{
+	if (node._pool != this) {
+		throw IllegalArgumentException("failed to remove octree node, it does not belong to this pool", LOGGER_DETAIL_DEFAULT);
+	}
+	if (this->_shared) {
+		throw InvalidStateException("failed to remove octree node, the octree has shared blocks", LOGGER_DETAIL_DEFAULT);
+	}
+	std::vector<uint32_t> stack = { node._index };
+	while (!stack.empty()) {
+		uint32_t index = stack.back();
+		stack.pop_back();
+		this->_colors[index] = glm::vec4(0.0f, 0.0f, 0.0f, 0.0f);
+		this->_markModified(index / 8);
+		uint32_t first = this->_children[index];
+		if (first != NO_CHILDREN) {
+			for (uint32_t i = 0; i < 8; i++) {
+				stack.push_back(first + i);
+			}
+		}
+	}
+	if (node.root()) {
+		return;
+	}
+	uint32_t parent = this->_parents[node._index / 8];
+	if (this->_editing) {
+		this->_editedNodes.push_back(parent);
+	}
+	else {
+		SparseVoxelNode(this, parent)._propagateChanges();
+	}
+}
+
+void rgle::gfx::SparseVoxelPool::removeChildren(SparseVoxelNode node)
+{
+	if (node._pool != this) {
+		throw IllegalArgumentException("failed to remove octree children, the node does not belong to this pool", LOGGER_DETAIL_DEFAULT);
+	}
+	if (this->_editing) {
+		throw InvalidStateException("failed to remove octree children, an edit transaction is open", LOGGER_DETAIL_DEFAULT);
+	}
+	if (this->_shared) {
+		throw InvalidStateException("failed to remove octree children, the octree has shared blocks", LOGGER_DETAIL_DEFAULT);
+	}
+	uint32_t first = this->_children[node._index];
+	if (first == NO_CHILDREN) {
+		return;
+	}
+	// The color of the node already blends its children, so its ancestors stay as they are
+	this->_children[node._index] = NO_CHILDREN;
+	this->_detached.push_back(first / 8);
+	this->_markModified(node._index / 8);
+}
+
+bool rgle::gfx::SparseVoxelPool::reclaim(std::chrono::microseconds budget)
+{
+	if (this->_editing) {
+		throw InvalidStateException("failed to reclaim octree blocks, an edit transaction is open", LOGGER_DETAIL_DEFAULT);
+	}
+	return this->_reclaim(std::chrono::steady_clock::now() + budget);
+}
+
+bool rgle::gfx::SparseVoxelPool::defragment(std::chrono::microseconds budget)
+{
+	if (this->_editing) {
+		throw InvalidStateException("failed to defragment octree, an edit transaction is open", LOGGER_DETAIL_DEFAULT);
+	}
+	if (this->_shared) {
+		throw InvalidStateException("failed to defragment octree, the octree has shared blocks", LOGGER_DETAIL_DEFAULT);
+	}
+	auto deadline = std::chrono::steady_clock::now() + budget;
+	// NOTE: nodes of detached blocks may be waiting on the stack, once freed they are leaves and skipped
+	if (!this->_reclaim(deadline)) {
+		return false;
+	}
+	if (this->_defragmentCursor == 0) {
+		this->_defragmentCursor = 1;
+		this->_defragmentStack.assign(1, 0);
+	}
+	// Placed blocks never move again, so the nodes on the stack keep their indices
+	size_t steps = 0;
+	while (!this->_defragmentStack.empty()) {
+		if (++steps % 64 == 0 && std::chrono::steady_clock::now() >= deadline) {
+			return false;
+		}
+		uint32_t node = this->_defragmentStack.back();
+		this->_defragmentStack.pop_back();
+		uint32_t first = this->_children[node];
+		if (first == NO_CHILDREN) {
+			continue;
+		}
+		uint32_t block = first / 8;
+		// Blocks inserted below placed nodes since the pass started may sit before the cursor, they stay where they are
+		if (block >= this->_defragmentCursor) {
+			if (block != this->_defragmentCursor) {
+				this->_swapBlocks(block, this->_defragmentCursor);
+			}
+			block = this->_defragmentCursor++;
+		}
+		for (uint32_t i = 8; i-- > 0;) {
+			this->_defragmentStack.push_back(8 * block + i);
+		}
+	}
+	// The end of the pool is released a block at a time, so blocks appended by edits between the calls stop it
+	if (this->_defragmentReset == 0) {
+		while (this->_parents.size() > 1 && this->_free(static_cast<uint32_t>(this->_parents.size() - 1))) {
+			if (++steps % 64 == 0 && std::chrono::steady_clock::now() >= deadline) {
+				return false;
+			}
+			this->_colors.resize(this->_colors.size() - 8);
+			this->_children.resize(this->_children.size() - 8);
+			this->_parents.pop_back();
+			this->_depths.pop_back();
+		}
+		this->_freeBlocks.clear();
+		this->_defragmentReset = this->_parents.size();
+	}
+	// Queued from the end, so the lowest free blocks are taken first, blocks freed between the calls are queued by
+	// _freeBlock and may be queued twice, which acquireBlock tolerates
+	while (this->_defragmentReset > 1) {
+		if (++steps % 64 == 0 && std::chrono::steady_clock::now() >= deadline) {
+			return false;
+		}
+		uint32_t block = static_cast<uint32_t>(--this->_defragmentReset);
+		if (block < this->_parents.size() && this->_free(block)) {
+			this->_freeBlocks.push_back(block);
+		}
+	}
+	this->_defragmentCursor = 0;
+	this->_defragmentStack.clear();
+	this->_defragmentReset = 0;
+	return true;
+}
+
+void rgle::gfx::SparseVoxelPool::load(const SparseVoxelFile& file)
+{
+	this->_load(file, nullptr);
+}
+
+void rgle::gfx::SparseVoxelPool::load(const SparseVoxelFile& file, sync::ThreadPool& threads)
+{
+	this->_load(file, &threads);
+}
+
+rgle::gfx::SparseVoxelCompressStatistics rgle::gfx::SparseVoxelPool::compress()
+{
+	return this->_compress(nullptr);
+}
+
+rgle::gfx::SparseVoxelCompressStatistics rgle::gfx::SparseVoxelPool::compress(sync::ThreadPool& threads)
+{
+	return this->_compress(&threads);
+}
+
+bool rgle::gfx::SparseVoxelPool::shared() const
+{
+	return this->_shared;
+}
+
+glm::vec3 rgle::gfx::SparseVoxelPool::_position(uint32_t index) const
+{
+	// Collect the path to the root, then offset each child from its parent's center top down
+	std::array<uint8_t, 256> slots;
+	size_t depth = 0;
+	while (index >= 8) {
+		slots[depth++] = static_cast<uint8_t>(index % 8);
+		index = this->_parents[index / 8];
+	}
+	glm::vec3 result = glm::vec3(0.0f, 0.0f, 0.0f);
+	float quarter = this->_rootSize / 4;
+	OctreeIndex::X x;
+	OctreeIndex::Y y;
+	OctreeIndex::Z z;
+	while (depth > 0) {
+		OctreeIndex::from_index(slots[--depth], x, y, z);
+		result.x += x == OctreeIndex::RIGHT ? quarter : -quarter;
+		result.y += y == OctreeIndex::TOP ? quarter : -quarter;
+		result.z += z == OctreeIndex::FRONT ? quarter : -quarter;
+		quarter /= 2;
+	}
+	return result;
+}
+
+void rgle::gfx::SparseVoxelPool::_blend(uint32_t index)
+{
+	const glm::vec4* children = &this->_colors[this->_children[index]];
+	this->_colors[index] = util::Color::blend({
+		children[0],
+		children[1],
+		children[2],
+		children[3],
+		children[4],
+		children[5],
+		children[6],
+		children[7]
+	});
+}
+
+void rgle::gfx::SparseVoxelPool::_markModified(size_t block)
+{
+	if (this->_editing) {
+		this->_editedBlocks.push_back(block);
+	}
+	else {
+		this->_modifiedBlocks.push(block);
+	}
+}
+
+void rgle::gfx::SparseVoxelPool::_commit(sync::ThreadPool* threads)
+{
+	if (!this->_editing) {
+		throw InvalidStateException("failed to commit octree edits, no transaction is open", LOGGER_DETAIL_DEFAULT);
+	}
+	// Nodes of a level only read the colors of the level below, so every level is blended once after the one below
+	const size_t chunk = 1 << 12;
+	std::vector<std::vector<uint32_t>> levels(std::numeric_limits<uint8_t>::max() + 1);
+	for (uint32_t index : this->_editedNodes) {
+		levels[this->_depths[index / 8]].push_back(index);
+	}
+	for (size_t depth = levels.size(); depth-- > 0;) {
+		auto& level = levels[depth];
+		if (level.empty()) {
+			continue;
+		}
+		std::sort(level.begin(), level.end());
+		level.erase(std::unique(level.begin(), level.end()), level.end());
+		auto blend = [this, &level](size_t first, size_t last) {
+			for (size_t i = first; i < last; i++) {
+				if (this->_children[level[i]] != NO_CHILDREN) {
+					this->_blend(level[i]);
+				}
+			}
+		};
+		if (threads != nullptr && level.size() > chunk) {
+			threads->runJobs((level.size() + chunk - 1) / chunk, [&blend, &level, chunk](size_t job) {
+				blend(job * chunk, std::min((job + 1) * chunk, level.size()));
+			});
+		}
+		else {
+			blend(0, level.size());
+		}
+		for (uint32_t index : level) {
+			this->_editedBlocks.push_back(index / 8);
+			if (index >= 8) {
+				levels[depth - 1].push_back(this->_parents[index / 8]);
+			}
+		}
+		level.clear();
+		level.shrink_to_fit();
+	}
+	std::sort(this->_editedBlocks.begin(), this->_editedBlocks.end());
+	this->_editedBlocks.erase(std::unique(this->_editedBlocks.begin(), this->_editedBlocks.end()), this->_editedBlocks.end());
+	for (size_t block : this->_editedBlocks) {
+		this->_modifiedBlocks.push(block);
+	}
+	this->_editedNodes.clear();
+	this->_editedBlocks.clear();
+	this->_editing = false;
+}
+
+void rgle::gfx::SparseVoxelPool::_load(const SparseVoxelFile& file, sync::ThreadPool* threads)
+{
+	if (this->_editing) {
+		throw InvalidStateException("failed to load octree file, an edit transaction is open", LOGGER_DETAIL_DEFAULT);
+	}
+	const size_t blocks = static_cast<size_t>(file.header().blockCount);
+	this->_colors.resize(8 * blocks);
+	this->_children.resize(8 * blocks);
+	this->_parents.assign(file.parents(), file.parents() + blocks);
+	this->_depths.assign(file.depths(), file.depths() + blocks);
+	this->_resetFreeBlocks();
+	this->_rootSize = file.header().rootSize;
+
+	std::atomic_bool corrupted = false;
+	std::atomic_bool unlinked = false;
+	std::atomic_bool shared = false;
+	auto decode = [this, &file, &corrupted, &unlinked, &shared, blocks](size_t first, size_t last) {
+		// Depths grow by one from parent to child, which also rules out cycles through the parents
+		for (size_t block = first; block < last; block++) {
+			uint32_t parent = this->_parents[block];
+			if (block == 0) {
+				unlinked = unlinked || parent != NO_CHILDREN || this->_depths[0] != 0;
+			}
+			else if (parent != NO_CHILDREN && (parent >= 8 * blocks || this->_depths[block] != this->_depths[parent / 8] + 1)) {
+				unlinked = true;
+			}
+		}
+		for (size_t index = 8 * first; index < 8 * last; index++) {
+			SparseVoxelNodePayload payload;
+			const unsigned char* data = file.blocks() + index * SparseVoxelNodePayload::SIZE;
+			std::memcpy(&payload.color, data, sizeof(GLuint));
+			std::memcpy(&payload.children, data + sizeof(GLuint), sizeof(GLuint));
+			this->_colors[index] = SparseVoxelNodePayload::unpackColor(payload.color);
+			uint32_t block = payload.children >> 8;
+			// Block 0 only holds the root, so a zero block index marks a leaf
+			this->_children[index] = block != 0 ? 8 * block : NO_CHILDREN;
+			if (block >= blocks) {
+				corrupted = true;
+			}
+			// NOTE: a block only records its first parent, any other parent means the file was compressed
+			else if (block != 0 && this->_parents[block] != index) {
+				shared = true;
+			}
+		}
+	};
+	const size_t chunk = 1 << 12;
+	if (threads != nullptr && blocks > chunk) {
+		threads->runJobs((blocks + chunk - 1) / chunk, [&decode, blocks, chunk](size_t job) {
+			decode(job * chunk, std::min((job + 1) * chunk, blocks));
+		});
+	}
+	else {
+		decode(0, blocks);
+	}
+	if (corrupted) {
+		*this = SparseVoxelPool();
+		throw IOException("corrupted sparse voxel octree file, a child block is out of range", LOGGER_DETAIL_DEFAULT);
+	}
+	if (unlinked) {
+		*this = SparseVoxelPool();
+		throw IOException("corrupted sparse voxel octree file, a parent is out of range or a depth does not follow it", LOGGER_DETAIL_DEFAULT);
+	}
+	this->_shared = shared;
+	this->_modifiedBlocks = util::IntervalSet(util::Range<size_t>{ 0, blocks });
+}
+
+rgle::gfx::SparseVoxelCompressStatistics rgle::gfx::SparseVoxelPool::_compress(sync::ThreadPool* threads)
+{
+	if (this->_editing) {
+		throw InvalidStateException("failed to compress octree, an edit transaction is open", LOGGER_DETAIL_DEFAULT);
+	}
+	auto start = std::chrono::steady_clock::now();
+	const size_t blocks = this->blockCount();
+	size_t used = 1;
+	std::vector<std::vector<uint32_t>> levels(std::numeric_limits<uint8_t>::max() + 1);
+	for (uint32_t block = 1; block < blocks; block++) {
+		if (!this->_free(block)) {
+			levels[this->_depths[block]].push_back(block);
+			used++;
+		}
+	}
+
+	// Block each block is merged into, a level is compared after the level below has been merged
+	std::vector<uint32_t> merged(blocks, 0);
+	std::vector<BlockKey> keys;
+	bool shared = this->_shared;
+	const size_t chunk = 1 << 12;
+	for (size_t depth = levels.size(); depth-- > 1;) {
+		const auto& level = levels[depth];
+		if (level.empty()) {
+			continue;
+		}
+		keys.resize(level.size());
+		auto hash = [this, &level, &keys, &merged](size_t first, size_t last) {
+			for (size_t i = first; i < last; i++) {
+				BlockKey& key = keys[i];
+				key.hash = 0;
+				for (uint32_t n = 0; n < 8; n++) {
+					uint32_t index = 8 * level[i] + n;
+					uint32_t children = this->_children[index];
+					uint64_t child = children != NO_CHILDREN ? merged[children / 8] : 0;
+					key.words[n] = (static_cast<uint64_t>(SparseVoxelNodePayload::packColor(this->_colors[index])) << 32) | child;
+					key.hash ^= std::hash<uint64_t>()(key.words[n]) + 0x9e3779b97f4a7c15ull + (key.hash << 6) + (key.hash >> 2);
+				}
+			}
+		};
+		if (threads != nullptr && level.size() > chunk) {
+			threads->runJobs((level.size() + chunk - 1) / chunk, [&hash, &level, chunk](size_t job) {
+				hash(job * chunk, std::min((job + 1) * chunk, level.size()));
+			});
+		}
+		else {
+			hash(0, level.size());
+		}
+		std::unordered_map<BlockKey, uint32_t, BlockKeyHash> unique;
+		unique.reserve(level.size());
+		for (size_t i = 0; i < level.size(); i++) {
+			auto [entry, inserted] = unique.try_emplace(keys[i], level[i]);
+			merged[level[i]] = entry->second;
+			shared = shared || !inserted;
+		}
+	}
+
+	// Renumber the merged blocks breadth first from the root, so the blocks of a level stay contiguous
+	std::vector<uint32_t> renumbered(blocks, NO_CHILDREN);
+	std::vector<uint32_t> order = { 0 };
+	renumbered[0] = 0;
+	for (size_t i = 0; i < order.size(); i++) {
+		for (uint32_t n = 0; n < 8; n++) {
+			uint32_t children = this->_children[8 * order[i] + n];
+			if (children == NO_CHILDREN) {
+				continue;
+			}
+			uint32_t block = merged[children / 8];
+			if (renumbered[block] == NO_CHILDREN) {
+				renumbered[block] = static_cast<uint32_t>(order.size());
+				order.push_back(block);
+			}
+		}
+	}
+	std::vector<glm::vec4> colors(8 * order.size());
+	std::vector<uint32_t> children(8 * order.size(), NO_CHILDREN);
+	std::vector<uint32_t> parents(order.size(), NO_CHILDREN);
+	std::vector<uint8_t> depths(order.size());
+	for (uint32_t block = 0; block < order.size(); block++) {
+		depths[block] = this->_depths[order[block]];
+		for (uint32_t n = 0; n < 8; n++) {
+			uint32_t index = 8 * block + n;
+			uint32_t source = 8 * order[block] + n;
+			colors[index] = this->_colors[source];
+			if (this->_children[source] == NO_CHILDREN) {
+				continue;
+			}
+			uint32_t child = renumbered[merged[this->_children[source] / 8]];
+			children[index] = 8 * child;
+			if (parents[child] == NO_CHILDREN) {
+				parents[child] = index;
+			}
+		}
+	}
+
+	// NOTE: detached blocks are not reachable from the root, so they are dropped with the merged ones
+	SparseVoxelCompressStatistics statistics = {
+		.blocks = used,
+		.compressedBlocks = order.size()
+	};
+	this->_colors = std::move(colors);
+	this->_children = std::move(children);
+	this->_parents = std::move(parents);
+	this->_depths = std::move(depths);
+	this->_resetFreeBlocks();
+	this->_shared = shared;
+	this->_modifiedBlocks = util::IntervalSet(util::Range<size_t>{ 0, order.size() });
+	statistics.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	return statistics;
+}
+
+bool rgle::gfx::SparseVoxelPool::_free(uint32_t block) const
+{
+	return block != 0 && this->_parents[block] == NO_CHILDREN;
+}
+
+void rgle::gfx::SparseVoxelPool::_freeBlock(uint32_t block)
+{
+	for (uint32_t i = 0; i < 8; i++) {
+		this->_colors[8 * block + i] = glm::vec4(0.0f, 0.0f, 0.0f, 0.0f);
+		this->_children[8 * block + i] = NO_CHILDREN;
+	}
+	this->_parents[block] = NO_CHILDREN;
+	this->_depths[block] = 0;
+	this->_freeBlocks.push_back(block);
+}
+
+bool rgle::gfx::SparseVoxelPool::_reclaim(std::chrono::steady_clock::time_point deadline)
+{
+	size_t steps = 0;
+	while (!this->_detached.empty()) {
+		if (++steps % 64 == 0 && std::chrono::steady_clock::now() >= deadline) {
+			return false;
+		}
+		uint32_t block = this->_detached.back();
+		this->_detached.pop_back();
+		for (uint32_t i = 0; i < 8; i++) {
+			uint32_t first = this->_children[8 * block + i];
+			if (first != NO_CHILDREN) {
+				this->_detached.push_back(first / 8);
+			}
+		}
+		this->_freeBlock(block);
+	}
+	return true;
+}
+
+void rgle::gfx::SparseVoxelPool::_swapBlocks(uint32_t a, uint32_t b)
+{
+	auto remap = [a, b](uint32_t index) {
+		uint32_t block = index / 8;
+		if (block == a) {
+			return 8 * b + index % 8;
+		}
+		if (block == b) {
+			return 8 * a + index % 8;
+		}
+		return index;
+	};
+	for (uint32_t i = 0; i < 8; i++) {
+		std::swap(this->_colors[8 * a + i], this->_colors[8 * b + i]);
+		std::swap(this->_children[8 * a + i], this->_children[8 * b + i]);
+	}
+	std::swap(this->_parents[a], this->_parents[b]);
+	std::swap(this->_depths[a], this->_depths[b]);
+	// Indices stored in the two blocks first, then the indices pointing at them, so a block holding the parent or a
+	// child of the other is not remapped twice
+	for (uint32_t block : { a, b }) {
+		if (this->_parents[block] != NO_CHILDREN) {
+			this->_parents[block] = remap(this->_parents[block]);
+		}
+		for (uint32_t i = 0; i < 8; i++) {
+			if (this->_children[8 * block + i] != NO_CHILDREN) {
+				this->_children[8 * block + i] = remap(this->_children[8 * block + i]);
+			}
+		}
+	}
+	for (uint32_t block : { a, b }) {
+		if (this->_free(block)) {
+			this->_freeBlocks.push_back(block);
+			continue;
+		}
+		uint32_t parent = this->_parents[block];
+		this->_children[parent] = 8 * block;
+		for (uint32_t i = 0; i < 8; i++) {
+			uint32_t first = this->_children[8 * block + i];
+			if (first != NO_CHILDREN) {
+				this->_parents[first / 8] = 8 * block + i;
+			}
+		}
+		this->_markModified(block);
+		this->_markModified(parent / 8);
+	}
+}
+
+void rgle::gfx::SparseVoxelPool::_resetFreeBlocks()
+{
+	// Pushed from the end, so the lowest free blocks are taken first and the pool stays compact
+	this->_freeBlocks.clear();
+	for (size_t block = this->_parents.size(); block-- > 1;) {
+		if (this->_free(static_cast<uint32_t>(block))) {
+			this->_freeBlocks.push_back(static_cast<uint32_t>(block));
+		}
+	}
+	this->_detached.clear();
+	this->_defragmentCursor = 0;
+	this->_defragmentStack.clear();
+	this->_defragmentReset = 0;
+}
+
+void rgle::gfx::SparseVoxelNodePayload::mapToBuffer(unsigned char * buffer) const
+{
+	unsigned char* next = (unsigned char*)std::memcpy(buffer, &this->color, sizeof(GLuint));
+	std::memcpy(next + sizeof(GLuint), &this->children, sizeof(GLuint));
+}
+
+GLuint rgle::gfx::SparseVoxelNodePayload::packColor(const glm::vec4& color)
+{
+	// Blending fully transparent children leaves NaN components, such colors are stored as transparent black
+	if (!(color.a > 0.0f)) {
+		return 0;
+	}
+	GLuint result = 0;
+	for (int i = 0; i < 4; i++) {
+		float value = std::isnan(color[i]) ? 0.0f : std::clamp(color[i], 0.0f, 1.0f);
+		result |= static_cast<GLuint>(std::round(value * 255.0f)) << (8 * i);
+	}
+	return result;
+}
+
+glm::vec4 rgle::gfx::SparseVoxelNodePayload::unpackColor(const GLuint& color)
 {
-	unsigned char* next = (unsigned char*)std::memcpy(buffer, &this->color.x, 4 * sizeof(GLfloat));
-	next = (unsigned char*)std::memcpy(next + 4 * sizeof(GLfloat), &this->position.x, 3 * sizeof(GLfloat));
-	// NOTE: offset by vec4 to avoid using vec3 in SSBO (vec3's are difficult to work with in interface blocks)
-	next = (unsigned char*)std::memcpy(next + 4 * sizeof(GLfloat), &this->depth, sizeof(GLuint));
-	std::memcpy(next + sizeof(GLuint), &this->next, sizeof(GLint));
+	return glm::vec4(
+		static_cast<float>(color & 0xFF),
+		static_cast<float>((color >> 8) & 0xFF),
+		static_cast<float>((color >> 16) & 0xFF),
+		static_cast<float>(color >> 24)
+	) / 255.0f;
 }
 
 size_t rgle::gfx::OctreeIndex::to_index(X x, Y y, Z z)
@@ -674,8 +2025,8 @@ size_t rgle::gfx::OctreeIndex::to_index(X x, Y y, Z z)
 void rgle::gfx::OctreeIndex::from_index(const size_t & index, X & x, Y & y, Z & z)
 {
 	x = index % 2 == 0 ? X::LEFT : X::RIGHT;
-	y = index % 4 < 2 ? Y::BOTTOM : Y::TOP;
-	z = index < 4 ? Z::BACK : Z::FRONT;
+	y = index % 4 < 2 ? Y::TOP : Y::BOTTOM;
+	z = index < 4 ? Z::FRONT : Z::BACK;
 }
 
 rgle::gfx::NoClipSparseVoxelCamera::NoClipSparseVoxelCamera(float near, float far, float fieldOfView, std::shared_ptr<Window> window) :
@@ -2,6 +2,10 @@
 
 #include "rgle/gfx/Graphics.h"
 
+namespace rgle::sync {
+	class ThreadPool;
+}
+
 namespace rgle::gfx {
 
 	namespace OctreeIndex {
@@ -22,72 +26,239 @@ namespace rgle::gfx {
 		void from_index(const size_t& index, X& x, Y& y, Z& z);
 	}
 
+	class SparseVoxelPool;
 	class SparseVoxelOctree;
+	class SparseVoxelFile;
+	class SparseVoxelPageCache;
+	struct SparseVoxelPageOptions;
 
+	// GPU node format, position and size are reconstructed during traversal
 	struct SparseVoxelNodePayload {
-		glm::vec4 color;
-		glm::vec3 position;
-		GLuint depth;
-		GLint next;
+		// RGBA8 color, red in the lowest byte to match unpackUnorm4x8
+		GLuint color;
+		// Block index of the children in the upper 24 bits, a mask of the children that are not fully transparent in
+		// the lower 8 bits, zero for leaves
+		GLuint children;
 
 		void mapToBuffer(unsigned char* buffer) const;
 
+		static GLuint packColor(const glm::vec4& color);
+		static glm::vec4 unpackColor(const GLuint& color);
+
 		static const size_t SIZE;
 	};
 
+	// Handle to a node stored in a SparseVoxelPool
+	// @note handles stay valid while the pool grows, references returned by color() do not
 	class SparseVoxelNode {
-		friend class SparseVoxelOctree;
+		friend class SparseVoxelPool;
 	public:
-		SparseVoxelNode(const SparseVoxelNode&) = delete;
-		SparseVoxelNode(SparseVoxelNode&& rvalue);
-		~SparseVoxelNode();
-
-		void operator=(const SparseVoxelNode&) = delete;
-		void operator=(SparseVoxelNode&& rvalue);
+		// Creates an invalid handle
+		SparseVoxelNode();
 
-		SparseVoxelNode* child(OctreeIndex::X x, OctreeIndex::Y y, OctreeIndex::Z z) const;
-		SparseVoxelNode* parent() const;
+		// @returns the child handle, or an invalid handle if the node is a leaf
+		SparseVoxelNode child(OctreeIndex::X x, OctreeIndex::Y y, OctreeIndex::Z z) const;
+		// @returns the parent handle, or an invalid handle for the root
+		SparseVoxelNode parent() const;
 
 		void insertChildren(std::array<glm::vec4, 8> colors);
 
+		bool valid() const;
 		bool leaf() const;
 		bool root() const;
 
 		size_t index() const;
 		size_t depth() const;
 
-		float& size();
-		const float& size() const;
+		// Edge length of the node, derived from the size of the root
+		float size() const;
+		// Center of the node, derived from the path to the root
+		glm::vec3 position() const;
 
 		glm::vec4& color();
 		const glm::vec4& color() const;
 
+		// Marks the node's block and its parent's block, whose child mask depends on the node, as modified so the
+		// next flush writes them to the GPU
+		// @note inside an edit transaction the blocks are collected and marked at commit
 		void update();
 
 		SparseVoxelNodePayload toPayload() const;
 
+		auto operator<=>(const SparseVoxelNode&) const = default;
+
 	private:
-		SparseVoxelNode();
-		SparseVoxelNode(SparseVoxelOctree* octree);
+		SparseVoxelNode(SparseVoxelPool* pool, uint32_t index);
 
-		glm::vec3 _childPosition(OctreeIndex::X x, OctreeIndex::Y y, OctreeIndex::Z z) const;
 		void _propagateChanges();
 
-		glm::vec4 _color;
-		glm::vec3 _position;
-		float _size;
-		size_t _index;
-		size_t _depth;
-		SparseVoxelNode* _parent;
-		SparseVoxelNode* _children;
-		SparseVoxelOctree* _octree;
+		SparseVoxelPool* _pool;
+		uint32_t _index;
 	};
 
-	class SparseVoxelOctree : public Node {
+	struct SparseVoxelCompressStatistics {
+		// Blocks in use before and after merging
+		size_t blocks = 0;
+		size_t compressedBlocks = 0;
+		double seconds = 0.0;
+	};
+
+	// Index addressed structure of arrays storage for the nodes of an octree, allocated in blocks of 8 siblings
+	// @remarks
+	// Node i of the pool is node i of the GPU octree buffer, block 0 holds the root in its first slot. Per node only
+	// the color and the first child are stored, depth and parent are stored once per block and positions and sizes
+	// are derived from the root
+	class SparseVoxelPool {
 		friend class SparseVoxelNode;
+		friend class SparseVoxelFile;
+	public:
+		static const uint32_t NO_CHILDREN;
+		// The GPU payload addresses children by a 24 bit block index
+		static const size_t MAX_BLOCKS;
+
+		SparseVoxelPool();
+
+		SparseVoxelNode root();
+
+		// Edge length of the root node
+		// @note set it before inserting children, the positions written to the GPU are only refreshed on update
+		float& rootSize();
+		const float& rootSize() const;
+
+		// Allocates a block of 8 sibling nodes, reusing free blocks first
+		// @returns the block index, the nodes of block b are 8 * b to 8 * b + 7
+		// @note the block counts as free until a parent is assigned to it by SparseVoxelNode::insertChildren
+		uint32_t acquireBlock();
+
+		// Number of blocks in use, including block 0 holding the root
+		size_t blockCount() const;
+
+		// Bytes of CPU storage held by the pool
+		size_t memoryUsage() const;
+
+		// Blocks modified since the last flush
+		util::IntervalSet<size_t>& modifiedBlocks();
+
+		// GPU payload of node index, as flush() writes it
+		SparseVoxelNodePayload payload(uint32_t index) const;
+
+		// Opens an edit transaction, until commit() edits only record the nodes they touch and ancestor colors are
+		// left stale
+		void begin();
+		// Blends every ancestor of the nodes edited since begin() once, level by level from the deepest, and marks
+		// the blocks they live in modified
+		void commit();
+		// Same as commit(), blending the nodes of each level in parallel on the thread pool
+		void commit(sync::ThreadPool& threads);
+		bool editing() const;
+
+		// Makes the node and all of its descendants transparent, the child mask of its parent then stops the traversal
+		void remove(SparseVoxelNode node);
+		// Turns the node into a leaf keeping its color, the blocks below it are detached and freed by reclaim()
+		// @note detaching is constant time however large the subtree is, detached blocks are saved as they are until
+		// they are reclaimed
+		// @throws InvalidStateException while an edit transaction is open
+		void removeChildren(SparseVoxelNode node);
+		// Frees the blocks of detached subtrees until the budget is spent
+		// @returns true if every detached block was freed
+		bool reclaim(std::chrono::microseconds budget);
+		// Continues a defragmentation pass until the budget is spent
+		// @remarks
+		// A pass places the blocks in depth first order from the front of the pool, swapping each block it reaches with
+		// the block at the cursor and rewriting the child and parent indices of both, then releases the free blocks at
+		// the end of the pool one by one and rebuilds the queue of free blocks, each step within the budget. Detached
+		// blocks are reclaimed before the pass continues, edits between the calls are fine
+		// @returns true if the pass finished, the next call starts a new one
+		bool defragment(std::chrono::microseconds budget);
+
+		// Replaces every node with the nodes of a mapped octree file and marks all blocks modified
+		// @note colors are restored from the 8 bit payloads, so payload() returns the bytes stored in the file
+		void load(const SparseVoxelFile& file);
+		// Same as load(), decoding the blocks in parallel on the thread pool
+		void load(const SparseVoxelFile& file, sync::ThreadPool& threads);
+
+		// Merges identical subtrees into shared blocks, turning the octree into a directed acyclic graph
+		// @remarks
+		// Blocks are compared level by level from the deepest by their payloads with the children replaced by the block
+		// they were merged into, so blocks are only merged when the traversal can not tell them apart. The blocks left
+		// are renumbered breadth first and all marked modified
+		// @note a shared block keeps the parent of its first occurrence, edits are refused once blocks are shared
+		SparseVoxelCompressStatistics compress();
+		// Same as compress(), hashing the blocks of each level in parallel on the thread pool
+		SparseVoxelCompressStatistics compress(sync::ThreadPool& threads);
+		// Whether blocks have several parents, after compress() or after loading a compressed file
+		bool shared() const;
+
+	private:
+		glm::vec3 _position(uint32_t index) const;
+
+		void _blend(uint32_t index);
+		void _markModified(size_t block);
+		void _commit(sync::ThreadPool* threads);
+		void _load(const SparseVoxelFile& file, sync::ThreadPool* threads);
+		SparseVoxelCompressStatistics _compress(sync::ThreadPool* threads);
+
+		bool _free(uint32_t block) const;
+		void _freeBlock(uint32_t block);
+		bool _reclaim(std::chrono::steady_clock::time_point deadline);
+		void _swapBlocks(uint32_t a, uint32_t b);
+		// Rebuilds the free blocks from the parents and forgets detached blocks and the defragmentation pass
+		void _resetFreeBlocks();
+
+		// Per node storage
+		std::vector<glm::vec4> _colors;
+		std::vector<uint32_t> _children;
+
+		// Per block storage, the parent of the root and of free blocks is NO_CHILDREN
+		std::vector<uint32_t> _parents;
+		std::vector<uint8_t> _depths;
+
+		// Queue of free blocks of 8, defragmentation moves and releases free blocks without removing their entries, so
+		// entries are checked when they are taken
+		std::deque<uint32_t> _freeBlocks;
+
+		// First blocks of the subtrees detached by removeChildren, waiting for reclaim
+		std::vector<uint32_t> _detached;
+
+		// Defragmentation pass state, the position of the next block placed, zero between passes, and the nodes whose
+		// children are still to be placed
+		uint32_t _defragmentCursor;
+		std::vector<uint32_t> _defragmentStack;
+		// Block below which the free blocks are still to be queued, zero until the end of the pool was released
+		size_t _defragmentReset;
+
+		// Ranges of modified blocks, written and flushed range by range
+		util::IntervalSet<size_t> _modifiedBlocks;
+
+		float _rootSize;
+
+		bool _shared;
+
+		// Edit transaction state, nodes whose ancestors need blending and blocks to mark modified at commit
+		bool _editing;
+		std::vector<uint32_t> _editedNodes;
+		std::vector<size_t> _editedBlocks;
+	};
+
+	// GPU side of a SparseVoxelPool, the payloads of its blocks are written through persistently mapped memory
+	// @remarks
+	// With ARB_sparse_buffer the traversal reads a sparse buffer spanning every addressable block, committed chunk by
+	// chunk, and flush() writes the modified blocks into a small staging ring from which they are copied into it. Growing
+	// only commits the pages of new chunks and never moves the blocks written before, a defragmented pool gives back the
+	// pages past its end. Without it the traversal can only address a single buffer, so the octree has one mapped buffer
+	// which is reallocated ALLOCATION_FACTOR times larger when it is full, the blocks written before are copied into the
+	// new buffer on the GPU
+	class SparseVoxelOctree : public Node {
 	public:
 		static const size_t BLOCK_SIZE;
 
+		// Locations of the paging uniforms of a traversal shader, -1 for uniforms the shader does not use
+		struct PagingLocation {
+			GLint paged;
+			GLint pageFrame;
+			GLint brickNodes;
+		};
+
 		SparseVoxelOctree();
 		SparseVoxelOctree(const SparseVoxelOctree&) = delete;
 		SparseVoxelOctree(SparseVoxelOctree&&) = delete;
@@ -97,46 +268,147 @@ namespace rgle::gfx {
 		void operator=(SparseVoxelOctree&&) = delete;
 
 		void bind() const;
-
-		SparseVoxelNode* root() const;
-
+		// Binds the page feedback region of the current frame and sets the paging uniforms of a traversal shader, paged
+		// or not
+		void bindPaging(const PagingLocation& location) const;
+		// Locates the paging uniforms of a traversal shader, once per shader
+		static PagingLocation pagingLocation(const ShaderProgram& program);
+
+		SparseVoxelNode root();
+		// Size of the root node, known without decoding the pool of a loaded file
+		float rootSize() const;
+
+		// Decodes the pool of a loaded file on first access, see load()
+		SparseVoxelPool& pool();
+		const SparseVoxelPool& pool() const;
+
+		// Writes the payloads of the modified blocks into their chunks and flushes them, or for a paged octree
+		// reads the feedback of the last finished frame and moves streamed bricks into the buffer
 		void flush();
 
+		// Edit transaction, see SparseVoxelPool::begin
+		void begin();
+		void insert(SparseVoxelNode node, std::array<glm::vec4, 8> colors);
+		void remove(SparseVoxelNode node);
+		void removeChildren(SparseVoxelNode node);
+		void commit();
+		void commit(sync::ThreadPool& threads);
+
+		// Reclaims detached blocks and continues the defragmentation of the pool within the budget, the blocks moved are
+		// written by the next flush
+		// @returns true if the pool is compact, see SparseVoxelPool::defragment
+		bool defragment(std::chrono::microseconds budget);
+
+		// Merges identical subtrees of a static octree, see SparseVoxelPool::compress
+		SparseVoxelCompressStatistics compress();
+		SparseVoxelCompressStatistics compress(sync::ThreadPool& threads);
+
+		// Writes the nodes to a file in the SparseVoxelFile format
+		void save(const std::string& filename) const;
+		// Replaces the octree with the nodes of a file, the blocks are copied from the mapped file straight into the
+		// buffer without rebuilding their payloads
+		// @remarks
+		// The pool is only decoded from the mapping once it is first used, by pool(), root() or an edit, so an octree
+		// that is only drawn never holds the decoded nodes in memory. A corrupted file is reported by that first use
+		void load(const std::string& filename);
+		// Same as load(), decoding the pool right away in parallel on the thread pool
+		void load(const std::string& filename, sync::ThreadPool& threads);
+
+		// Streams the octree of a SparseVoxelBrickFile into a fixed brick cache in the buffer instead of keeping every
+		// node resident, the traversal reports the bricks it is missing and the loader reads them in the background
+		// @note the pool only keeps the root size while paged, edits are not written to the buffer
+		void page(const std::string& filename);
+		void page(const std::string& filename, const SparseVoxelPageOptions& options, std::shared_ptr<sync::ThreadPool> loader);
+		bool paged() const;
+		// @returns the brick cache, nullptr unless paged
+		const SparseVoxelPageCache* pageCache() const;
+		// Marks the end of the traversal dispatches of a frame, the feedback they write is read once the GPU is past it
+		// @remarks
+		// Frames write the feedback region of their frame number modulo the number of regions, so the CPU may run a few
+		// frames ahead of the GPU without the feedback of a frame being overwritten before it was read
+		void endFrame();
+
 		virtual const char* typeName() const;
 
 	private:
 		const size_t MIN_ALLOCATED = 10;
-		const float ALLOCATION_FACTOR = 10.0f;
-
-		size_t _aquireBlock();
-		void _realloc(float factor);
-		unsigned char* _buffer(const size_t& at);
-
-		// Root of octree
-		SparseVoxelNode* _root;
-
-		// Queue of free blocks of 8
-		std::deque<size_t> _freeBlocks;
-
-		// Queue storing the modified blocks (used for buffer flush)
-		util::CollectingQueue<size_t> _modifiedBlocks;
-
-		// The top index of buffer
-		size_t _top;
+		const float ALLOCATION_FACTOR = 2.0f;
+		// Blocks per committed chunk of a sparse octree buffer and per segment of its staging ring, rounded up to whole pages
+		const size_t CHUNK_BLOCKS = size_t(1) << 14;
+		// Nanoseconds waited per poll of the fence of a staging segment or of a reallocation copy
+		const GLuint64 STAGING_TIMEOUT = 1000000;
+
+		// Persistently mapped buffer, flushed explicitly
+		struct Chunk {
+			GLuint buffer;
+			unsigned char* data;
+		};
 
-		// Allocated size of buffer in # of nodes
+		// Sets up the empty storage, sparse if supported
+		void _createStorage();
+		void _releaseStorage();
+		Chunk _createChunk(size_t blocks);
+		// Replaces the storage with a single mapped buffer of blocks
+		void _allocate(size_t blocks);
+		// Replaces the mapped buffer with a larger one holding the same blocks
+		void _realloc(size_t minimum);
+		// Makes room for blocks, committing chunks of a sparse buffer or reallocating the mapped buffer
+		void _grow(size_t blocks);
+		// Decommits the chunks of a sparse buffer past blocks, but one
+		void _shrink(size_t blocks);
+		// Calls write with the first block, the block count and the memory to write them to, for the blocks from lower to
+		// upper, then flushes them into the buffer
+		void _writeBlocks(size_t lower, size_t upper, const std::function<void(size_t, size_t, unsigned char*)>& write);
+		// Flushes the blocks from lower to upper written into the mapped buffer
+		void _flushBlocks(size_t lower, size_t upper);
+		void _writeBlock(size_t block, unsigned char* buffer);
+		void _load(const std::string& filename, sync::ThreadPool* threads);
+		void _flushPages();
+		// Decodes the pool from the loaded file if it was not yet
+		void _decode() const;
+
+		// CPU storage of the octree, the buffer mirrors it block by block
+		mutable SparseVoxelPool _pool;
+		// File the buffer was loaded from while the pool is not decoded, the pool is empty meanwhile
+		mutable std::unique_ptr<SparseVoxelFile> _file;
+
+		// Allocated size of buffer in # of blocks
 		size_t _size;
 
-		// Persistent buffer storage
+		// Buffer the traversal reads, the sparse buffer or the mapped buffer
 		GLuint _octreeBuffer;
-
-		// Mapped pointer to octree buffer
-		unsigned char* _octreeData;
+		bool _sparse;
+
+		// Mapping of the octree buffer, only without sparse buffers
+		Chunk _mapped;
+		// Staging ring of a sparse buffer, segment s is written again once the copy out of it behind _stagingFences[s] is done
+		Chunk _staging;
+		std::array<GLsync, 4> _stagingFences;
+		size_t _stagingSegment;
+		size_t _chunkBlocks;
+
+		// Paged mode, the brick cache and the coherently mapped feedback the traversal writes
+		std::unique_ptr<SparseVoxelPageCache> _pages;
+		size_t _uploadsPerFrame;
+		size_t _feedbackCapacity;
+		GLuint _feedbackBuffer;
+		GLuint* _feedbackData;
+		// Words per feedback region, rounded up to the storage buffer offset alignment
+		size_t _feedbackWords;
+		// Per region fence of the last frame that wrote it, null once its feedback was read, and that frame
+		std::array<GLsync, 3> _feedbackFences;
+		std::array<uint64_t, 3> _feedbackFrames;
+		// Newest frame whose feedback was read
+		uint64_t _finishedFrame;
+		uint64_t _frame;
 	};
 
 	struct SparseVoxelRayPayload {
 		GLuint pixel;
 		GLint offset;
+		// Depth and center of the node at offset, nodes do not store them
+		GLuint depth;
+		glm::vec3 position;
 
 		void mapToBuffer(unsigned char* buffer) const;
 
@@ -162,6 +434,13 @@ namespace rgle::gfx {
 		const glm::vec3& direction() const;
 		const glm::vec3& up() const;
 		const glm::vec3& right() const;
+		const glm::quat& rotation() const;
+
+		float nearClip() const;
+		float farClip() const;
+
+		// Direction through pixel (x, y) before the camera rotation is applied, as uploaded to the ray buffer
+		glm::vec3 pixelRay(int x, int y, int width, int height) const;
 
 	private:
 		glm::vec3 _position;
@@ -196,15 +475,43 @@ namespace rgle::gfx {
 		std::weak_ptr<Window> _window;
 	};
 
-	// A renderer utilizing a pass based traversal through a GPU octree
-	// @todo use the smallest possible octree root to avoid unessesary passes
+	struct SparseVoxelQualityOptions {
+		// GPU milliseconds a frame may take, zero leaves the level of detail bias and the resolution scale as they are set
+		double frameBudget = 0.0;
+		// Coarsest level of detail bias the budget may force, in octree levels
+		float maxLodBias = 2.0f;
+		// Smallest fraction of the output resolution traced on each axis
+		float minResolutionScale = 0.5f;
+		// Quality is raised again once a frame takes less than (1 - headroom) * frameBudget
+		double headroom = 0.2;
+	};
+
+	// A renderer utilizing a pass based or a single dispatch traversal through a GPU octree
+	// @remarks
+	// An optional beam prepass (sparse-voxel-beam.comp) follows a cone around the rays of every 8x8 tile down the
+	// octree while a single child meets it, the rays of the tile then start from that node instead of the root, which
+	// saves the pass traversal the passes above it, without a beam shader every ray starts at the root
 	class SparseVoxelRenderer : public RenderLayer {
 	public:
+		enum class Traversal {
+			// Breadth first passes through a pass buffer, scheduled on the GPU from the previous pass (sparse-voxel.comp)
+			PASS,
+			// One dispatch per frame, each invocation walks the octree front to back (sparse-voxel-stackless.comp)
+			STACKLESS
+		};
+
 		static const int RAY_BUFFER;
 		static const int OCTREE_BUFFER;
-		static const int PASS_READ_BUFFER;
-		static const int PASS_WRITE_BUFFER;
-		static const int PASS_WRTIE_COUNTER;
+		// Bound after the pass buffer, for paged octrees only
+		static const int PAGE_FEEDBACK_BUFFER;
+		// Sub pass stack of the pass traversal, followed by the start node of each beam prepass tile
+		static const int PASS_SCHEDULE_BUFFER;
+		// Ray states of every level of the pass traversal, level i starts at 4 * capacity * i * (i - 1)
+		static const int PASS_BUFFER;
+		// Number of levels the pass schedule in sparse-voxel.comp tracks
+		static const size_t MAX_PASS_LEVELS;
+		// Width and height of a beam prepass tile in pixels
+		static const int BEAM_TILE_SIZE;
 
 		SparseVoxelRenderer(
 			std::string id,
@@ -213,7 +520,9 @@ namespace rgle::gfx {
 			std::string realizeShaderId,
 			unsigned int width,
 			unsigned int height,
-			std::shared_ptr<SparseVoxelCamera> camera
+			std::shared_ptr<SparseVoxelCamera> camera,
+			Traversal traversal = Traversal::PASS,
+			std::string beamShaderId = std::string()
 		);
 		SparseVoxelRenderer(const SparseVoxelRenderer&) = delete;
 		virtual ~SparseVoxelRenderer();
@@ -228,36 +537,91 @@ namespace rgle::gfx {
 
 		virtual const char* typeName() const;
 
-	private:
+		Traversal traversal() const;
+
+		// Image of node offsets the realize pass colors, -1 where no node was hit
+		std::shared_ptr<PersistentTexture2D> outTexture() const;
+
+		// Number of passes issued per frame by the pass traversal, passes past the end of the sub pass stack dispatch
+		// no work groups
+		// @remarks
+		// The budget starts at the levels times the sub passes of a level and follows a fenced copy of the schedule
+		// read a few frames behind the GPU: it doubles after a frame that ended with passes left and decays toward the
+		// passes a finished frame needed
+		// @note a frame cut short is presented as it is, pixels whose rays were still in the sub pass stack keep the
+		// node of the previous frame, so a view that suddenly needs more passes shows stale pixels for the few frames
+		// until the larger budget reaches the GPU
+		size_t& passBudget();
+		const size_t& passBudget() const;
+
+		// Frame budget the renderer holds by coarsening the level of detail first and lowering the resolution second,
+		// measured with timer queries a few frames behind the GPU
+		SparseVoxelQualityOptions& quality();
+		const SparseVoxelQualityOptions& quality() const;
+		// Octree levels rays stop above the pixel footprint, overwritten every frame while a frame budget is set
+		float& lodBias();
+		const float& lodBias() const;
+		// Fraction of the output resolution traced on each axis, the result is stretched over the output, overwritten
+		// every frame while a frame budget is set
+		float& resolutionScale();
+		const float& resolutionScale() const;
+		// GPU milliseconds of the last frame whose timer query returned, zero before the first one
+		double gpuTime() const;
+
+		// Runs the beam prepass before each frame, on by default when the renderer has a beam shader
+		// @throws InvalidStateException when enabled without a beam shader
+		void beamPrepass(bool enabled);
+		bool beamPrepass() const;
 
-		struct SubPass {
-			unsigned int offset;
-			unsigned int count;
-		};
-		void _bootstrap(const size_t& index);
+	private:
 
-		void _clearCounter(const GLuint& buffer);
-		void _setCounter(const GLuint& buffer, const GLuint& value);
-		size_t _unwindStack(const size_t& top);
+		void _bootstrap();
+		void _schedule(bool reset);
+		void _renderPasses();
+		void _readSchedules();
+		void _renderStackless();
+		void _beam();
+		void _beginFrame();
+		void _adjustQuality(double milliseconds);
+		void _applyResolution();
 
-		GLuint _numWorkGroups(const GLuint& subPassSize) const;
-		constexpr bool _lastSubPass(const size_t& top) const;
-		constexpr unsigned int _subPassSize(const size_t& top) const;
-		
 		GLuint _rayBuffer;
-		std::unique_ptr<GLuint[]> _passBuffers;
-		std::unique_ptr<unsigned int[]> _bufferSizes;
-		std::unique_ptr<GLuint[]> _counterBuffers;
-		std::unique_ptr<SubPass[]> _subPassStack;
+		// Holds the sub pass stack and the indirect dispatch arguments of the next pass, then the beam prepass starts
+		GLuint _scheduleBuffer;
+		GLuint _passBuffer;
+		// Ray states a sub pass of level i may consume, times i + 1, bounded by the largest storage block
+		size_t _passCapacity;
+		// Persistently mapped ring of the subpass_size left in the schedule after the last pass of a frame and of the
+		// passes the frame needed, each slot is read once its fence has signaled along with the budget the frame ran with
+		GLuint _scheduleReadback;
+		GLuint* _scheduleReadbackData;
+		std::array<GLsync, 4> _scheduleFences;
+		std::array<size_t, 4> _scheduleBudgets;
 		glm::ivec2 _resolution;
+		// Traced sub rectangle of the output, the buffers and textures keep the size of the output
+		glm::ivec2 _renderResolution;
+		Traversal _traversal;
 		size_t _maxBufferDepth;
+		size_t _passBudget;
 		std::chrono::system_clock::time_point _lastTime;
 
+		SparseVoxelQualityOptions _quality;
+		float _lodBias;
+		float _resolutionScale;
+		double _gpuTime;
+		// Ring of GL_TIME_ELAPSED queries, each one is read back when its slot comes around again
+		std::array<GLuint, 4> _timerQueries;
+		size_t _frame;
+		// Frames left until the timings reflect the last quality change
+		size_t _settleFrames;
+		bool _beamPrepass;
+
 		std::shared_ptr<PersistentTexture2D> _depthTexture;
 		std::shared_ptr<PersistentTexture2D> _outTexture;
 		ImageRect _imageRect;
 
 		std::shared_ptr<ShaderProgram> _realizeShader;
+		std::shared_ptr<ShaderProgram> _beamShader;
 		std::shared_ptr<SparseVoxelCamera> _camera;
 		std::shared_ptr<SparseVoxelOctree> _octree;
 
@@ -265,13 +629,25 @@ namespace rgle::gfx {
 			GLint rootNodeOffset;
 			GLint rootNodeSize;
 			GLint renderResolution;
-			GLint bootstrap;
-			GLint finalize;
-			GLint subPassOffset;
-			GLint subPassSize;
-			GLint readPassSize;
+			GLint schedule;
+			GLint reset;
+			GLint maxBufferDepth;
+			GLint passCapacity;
 			GLint depthImage;
 			GLint outImage;
+			GLint lodBias;
+			GLint realizeResolution;
+			GLint beam;
+			SparseVoxelOctree::PagingLocation paging;
 		} _location;
+
+		struct {
+			GLint rootNodeOffset;
+			GLint rootNodeSize;
+			GLint renderResolution;
+			GLint lodBias;
+			GLint maxDepth;
+			SparseVoxelOctree::PagingLocation paging;
+		} _beamLocation;
 	};
 }
\ No newline at end of file
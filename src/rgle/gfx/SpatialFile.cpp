@@ -0,0 +1,140 @@
+#include "rgle/gfx/SpatialFile.h"
+
+const char rgle::gfx::SparseVoxelFileHeader::MAGIC[8] = { 'R', 'G', 'L', 'E', 'S', 'V', 'O', '\0' };
+const uint32_t rgle::gfx::SparseVoxelFileHeader::VERSION = 1;
+
+rgle::gfx::SparseVoxelFile::SparseVoxelFile(const std::string& filename) : _file(filename, true)
+{
+	if (this->_file.size() < sizeof(SparseVoxelFileHeader) || std::memcmp(this->header().magic, SparseVoxelFileHeader::MAGIC, sizeof(SparseVoxelFileHeader::MAGIC)) != 0) {
+		throw IOException("not a sparse voxel octree file: " + filename, LOGGER_DETAIL_DEFAULT);
+	}
+	if (this->header().version != SparseVoxelFileHeader::VERSION) {
+		throw IOException("unsupported sparse voxel octree file version " + std::to_string(this->header().version) + ": " + filename, LOGGER_DETAIL_DEFAULT);
+	}
+	if (this->header().blockSize != SparseVoxelOctree::BLOCK_SIZE
+		|| this->header().blockCount == 0
+		|| this->header().blockCount > SparseVoxelPool::MAX_BLOCKS
+		|| this->_file.size() < fileSize(static_cast<size_t>(this->header().blockCount))) {
+		throw IOException("corrupted sparse voxel octree file: " + filename, LOGGER_DETAIL_DEFAULT);
+	}
+}
+
+const rgle::gfx::SparseVoxelFileHeader& rgle::gfx::SparseVoxelFile::header() const
+{
+	return *reinterpret_cast<const SparseVoxelFileHeader*>(this->_file.data());
+}
+
+const unsigned char* rgle::gfx::SparseVoxelFile::blocks() const
+{
+	return this->_file.data() + sizeof(SparseVoxelFileHeader);
+}
+
+const uint32_t* rgle::gfx::SparseVoxelFile::parents() const
+{
+	return reinterpret_cast<const uint32_t*>(this->blocks() + this->header().blockCount * SparseVoxelOctree::BLOCK_SIZE);
+}
+
+const uint8_t* rgle::gfx::SparseVoxelFile::depths() const
+{
+	return reinterpret_cast<const uint8_t*>(this->parents() + this->header().blockCount);
+}
+
+size_t rgle::gfx::SparseVoxelFile::fileSize(size_t blockCount)
+{
+	return sizeof(SparseVoxelFileHeader) + blockCount * (SparseVoxelOctree::BLOCK_SIZE + sizeof(uint32_t) + sizeof(uint8_t));
+}
+
+void rgle::gfx::SparseVoxelFile::write(const std::string& filename, const SparseVoxelPool& pool)
+{
+	if (pool.editing()) {
+		throw InvalidStateException("failed to write octree file, an edit transaction is open", LOGGER_DETAIL_DEFAULT);
+	}
+	SparseVoxelFileHeader header;
+	std::memset(&header, 0, sizeof(header));
+	std::memcpy(header.magic, SparseVoxelFileHeader::MAGIC, sizeof(header.magic));
+	header.version = SparseVoxelFileHeader::VERSION;
+	header.blockSize = static_cast<uint32_t>(SparseVoxelOctree::BLOCK_SIZE);
+	header.blockCount = pool.blockCount();
+	header.rootSize = pool.rootSize();
+
+	// Blocks reachable from the root, each once even when a compressed pool shares it between several parents
+	const uint32_t blocks = static_cast<uint32_t>(pool.blockCount());
+	std::vector<bool> reachable(blocks, false);
+	std::vector<std::vector<uint32_t>> levels;
+	std::vector<uint32_t> stack = { 0 };
+	reachable[0] = true;
+	while (!stack.empty()) {
+		uint32_t block = stack.back();
+		stack.pop_back();
+		size_t depth = pool._depths[block];
+		if (levels.size() <= depth) {
+			levels.resize(depth + 1);
+		}
+		levels[depth].push_back(block);
+		// Only the root node of block 0 is part of the tree
+		for (uint32_t i = 0; i < (block == 0 ? 1u : 8u); i++) {
+			uint32_t child = pool.payload(8 * block + i).children >> 8;
+			if (child != 0 && !reachable[child]) {
+				reachable[child] = true;
+				stack.push_back(child);
+			}
+		}
+	}
+	header.depth = static_cast<uint32_t>(levels.size() - 1);
+
+	// Bounds of the visible leaves below each block relative to the center of its parent node, from the deepest level
+	// up, so a shared block is bounded once whatever the number of paths to it
+	glm::vec3 lower = glm::vec3(std::numeric_limits<float>::max());
+	glm::vec3 upper = glm::vec3(std::numeric_limits<float>::lowest());
+	std::vector<glm::vec3> lowers(blocks, lower);
+	std::vector<glm::vec3> uppers(blocks, upper);
+	for (size_t depth = levels.size(); depth-- > 0;) {
+		float size = std::ldexp(pool.rootSize(), -static_cast<int>(depth));
+		for (uint32_t block : levels[depth]) {
+			for (uint32_t i = 0; i < (block == 0 ? 1u : 8u); i++) {
+				// Bit 0 selects the right half, bits 1 and 2 the bottom and back halves, the root is centered at the origin
+				glm::vec3 offset = block == 0 ? glm::vec3(0.0f) : (size / 2) * glm::vec3((i & 1) != 0 ? 1.0f : -1.0f, (i & 2) != 0 ? -1.0f : 1.0f, (i & 4) != 0 ? -1.0f : 1.0f);
+				SparseVoxelNodePayload payload = pool.payload(8 * block + i);
+				uint32_t child = payload.children >> 8;
+				if (child != 0) {
+					if (lowers[child].x <= uppers[child].x) {
+						lowers[block] = glm::min(lowers[block], offset + lowers[child]);
+						uppers[block] = glm::max(uppers[block], offset + uppers[child]);
+					}
+				}
+				else if ((payload.color >> 24) != 0) {
+					lowers[block] = glm::min(lowers[block], offset - size / 2);
+					uppers[block] = glm::max(uppers[block], offset + size / 2);
+				}
+			}
+		}
+	}
+	lower = lowers[0];
+	upper = uppers[0];
+	for (int axis = 0; axis < 3; axis++) {
+		header.lower[axis] = lower[axis];
+		header.upper[axis] = upper[axis];
+	}
+
+	std::ofstream file(filename, std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!file.is_open()) {
+		throw IOException("could not open file: " + filename, LOGGER_DETAIL_DEFAULT);
+	}
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	const size_t chunk = 1 << 14;
+	std::vector<unsigned char> buffer(chunk * SparseVoxelOctree::BLOCK_SIZE);
+	for (size_t first = 0; first < pool.blockCount(); first += chunk) {
+		size_t last = std::min(first + chunk, pool.blockCount());
+		for (size_t block = first; block < last; block++) {
+			for (size_t i = 0; i < 8; i++) {
+				pool.payload(static_cast<uint32_t>(8 * block + i)).mapToBuffer(buffer.data() + (block - first) * SparseVoxelOctree::BLOCK_SIZE + i * SparseVoxelNodePayload::SIZE);
+			}
+		}
+		file.write(reinterpret_cast<const char*>(buffer.data()), (last - first) * SparseVoxelOctree::BLOCK_SIZE);
+	}
+	file.write(reinterpret_cast<const char*>(pool._parents.data()), pool._parents.size() * sizeof(uint32_t));
+	file.write(reinterpret_cast<const char*>(pool._depths.data()), pool._depths.size() * sizeof(uint8_t));
+	if (!file) {
+		throw IOException("could not write file: " + filename, LOGGER_DETAIL_DEFAULT);
+	}
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "rgle/gfx/Spatial.h"
+#include "rgle/util/MappedFile.h"
+
+namespace rgle::gfx {
+
+	// Fixed size header at the start of a sparse voxel octree file, in native (little endian) byte order
+	// @remarks
+	// The header is followed by blockCount blocks in the layout of the GPU octree buffer, then the parent node and
+	// the depth of every block, so a loader copies the blocks into the buffer and the block metadata into the pool
+	// without walking the tree
+	struct SparseVoxelFileHeader {
+		char magic[8];
+		uint32_t version;
+		// Bytes per block, SparseVoxelOctree::BLOCK_SIZE of the writer
+		uint32_t blockSize;
+		uint64_t blockCount;
+		float rootSize;
+		// Depth of the deepest node, zero when the root is a leaf
+		uint32_t depth;
+		// Bounds of the visible leaves, lower above upper when there are none
+		float lower[3];
+		float upper[3];
+		uint8_t reserved[8];
+
+		static const char MAGIC[8];
+		static const uint32_t VERSION;
+	};
+
+	static_assert(sizeof(SparseVoxelFileHeader) == 64, "sparse voxel file header must stay 64 bytes");
+
+	// Read only memory mapping of a sparse voxel octree file
+	// @note the pointers returned stay valid until the file is destroyed
+	class SparseVoxelFile {
+	public:
+		// Maps the file and validates its header and size
+		SparseVoxelFile(const std::string& filename);
+
+		const SparseVoxelFileHeader& header() const;
+
+		// Payload blocks, header().blockCount * header().blockSize bytes ready to copy into the GPU buffer
+		const unsigned char* blocks() const;
+		// Index of the parent node of every block, SparseVoxelPool::NO_CHILDREN for the root block and the first parent
+		// for blocks shared by SparseVoxelPool::compress
+		const uint32_t* parents() const;
+		const uint8_t* depths() const;
+
+		// Total bytes of a file holding blockCount blocks
+		static size_t fileSize(size_t blockCount);
+
+		// Writes the nodes of pool, blocks are written as SparseVoxelOctree::flush writes them
+		static void write(const std::string& filename, const SparseVoxelPool& pool);
+
+	private:
+		util::MappedFile _file;
+	};
+}
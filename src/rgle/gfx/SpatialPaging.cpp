@@ -0,0 +1,405 @@
+#include "rgle/gfx/SpatialPaging.h"
+
+namespace {
+	GLuint read_children(const unsigned char* buffer, size_t node) {
+		GLuint children;
+		std::memcpy(&children, buffer + node * rgle::gfx::SparseVoxelNodePayload::SIZE + sizeof(GLuint), sizeof(GLuint));
+		return children;
+	}
+
+	void write_children(unsigned char* buffer, size_t node, GLuint children) {
+		std::memcpy(buffer + node * rgle::gfx::SparseVoxelNodePayload::SIZE + sizeof(GLuint), &children, sizeof(GLuint));
+	}
+}
+
+const char rgle::gfx::SparseVoxelBrickFileHeader::MAGIC[8] = { 'R', 'G', 'L', 'E', 'S', 'V', 'B', '\0' };
+const uint32_t rgle::gfx::SparseVoxelBrickFileHeader::VERSION = 2;
+
+const uint32_t rgle::gfx::SparseVoxelBrickFile::NO_BRICK = std::numeric_limits<uint32_t>::max();
+const GLuint rgle::gfx::SparseVoxelBrickFile::MISSING = 0x80000000u;
+const size_t rgle::gfx::SparseVoxelBrickFile::MAX_BRICKS = size_t(1) << 23;
+
+const size_t rgle::gfx::SparseVoxelPageCache::NO_SLOT = std::numeric_limits<uint32_t>::max();
+
+rgle::gfx::SparseVoxelBrickFile::SparseVoxelBrickFile(const std::string& filename) : _file(filename)
+{
+	if (this->_file.size() < sizeof(SparseVoxelBrickFileHeader) || std::memcmp(this->header().magic, SparseVoxelBrickFileHeader::MAGIC, sizeof(SparseVoxelBrickFileHeader::MAGIC)) != 0) {
+		throw IOException("not a sparse voxel brick file: " + filename, LOGGER_DETAIL_DEFAULT);
+	}
+	if (this->header().version != SparseVoxelBrickFileHeader::VERSION) {
+		throw IOException("unsupported sparse voxel brick file version " + std::to_string(this->header().version) + ": " + filename, LOGGER_DETAIL_DEFAULT);
+	}
+	if (this->header().blockSize != SparseVoxelOctree::BLOCK_SIZE
+		|| this->header().brickBlocks == 0
+		|| this->header().brickCount == 0
+		|| this->header().brickCount > MAX_BRICKS
+		|| this->_file.size() < sizeof(SparseVoxelBrickFileHeader) + this->header().brickCount * (SparseVoxelOctree::BLOCK_SIZE + sizeof(SparseVoxelBrick))) {
+		throw IOException("corrupted sparse voxel brick file: " + filename, LOGGER_DETAIL_DEFAULT);
+	}
+	// Every brick must lie within the blocks between the header and the brick table
+	const uint64_t blocks = (this->_file.size() - sizeof(SparseVoxelBrickFileHeader) - this->header().brickCount * sizeof(SparseVoxelBrick)) / SparseVoxelOctree::BLOCK_SIZE;
+	for (uint32_t index = 0; index < this->header().brickCount; index++) {
+		const SparseVoxelBrick& brick = this->brick(index);
+		if (brick.blocks == 0 || brick.blocks > this->header().brickBlocks || brick.offset > blocks || blocks - brick.offset < brick.blocks) {
+			throw IOException("corrupted sparse voxel brick file: " + filename, LOGGER_DETAIL_DEFAULT);
+		}
+	}
+}
+
+const rgle::gfx::SparseVoxelBrickFileHeader& rgle::gfx::SparseVoxelBrickFile::header() const
+{
+	return *reinterpret_cast<const SparseVoxelBrickFileHeader*>(this->_file.data());
+}
+
+const rgle::gfx::SparseVoxelBrick& rgle::gfx::SparseVoxelBrickFile::brick(uint32_t index) const
+{
+	const unsigned char* table = this->_file.data() + this->_file.size() - this->header().brickCount * sizeof(SparseVoxelBrick);
+	return reinterpret_cast<const SparseVoxelBrick*>(table)[index];
+}
+
+const unsigned char* rgle::gfx::SparseVoxelBrickFile::blocks(uint32_t index) const
+{
+	return this->_file.data() + sizeof(SparseVoxelBrickFileHeader) + this->brick(index).offset * SparseVoxelOctree::BLOCK_SIZE;
+}
+
+size_t rgle::gfx::SparseVoxelBrickFile::brickSize() const
+{
+	return this->header().brickBlocks * SparseVoxelOctree::BLOCK_SIZE;
+}
+
+void rgle::gfx::SparseVoxelBrickFile::write(const std::string& filename, const SparseVoxelFile& source, size_t brickBlocks)
+{
+	if (brickBlocks == 0 || brickBlocks > SparseVoxelPool::MAX_BLOCKS) {
+		throw IllegalArgumentException("sparse voxel bricks must hold between 1 and 2^24 blocks", LOGGER_DETAIL_DEFAULT);
+	}
+	const SparseVoxelFileHeader& sourceHeader = source.header();
+	SparseVoxelBrickFileHeader header;
+	std::memset(&header, 0, sizeof(header));
+	std::memcpy(header.magic, SparseVoxelBrickFileHeader::MAGIC, sizeof(header.magic));
+	header.version = SparseVoxelBrickFileHeader::VERSION;
+	header.blockSize = static_cast<uint32_t>(SparseVoxelOctree::BLOCK_SIZE);
+	header.rootSize = sourceHeader.rootSize;
+	header.depth = sourceHeader.depth;
+	header.brickBlocks = static_cast<uint32_t>(brickBlocks);
+	std::memcpy(header.lower, sourceHeader.lower, sizeof(header.lower));
+	std::memcpy(header.upper, sourceHeader.upper, sizeof(header.upper));
+
+	std::ofstream file(filename, std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!file.is_open()) {
+		throw IOException("could not open file: " + filename, LOGGER_DETAIL_DEFAULT);
+	}
+	// The brick count is only known at the end, the header is written again then
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+	// Bricks are numbered when they are queued, so the queue order is the file order
+	struct Pending {
+		uint32_t block;
+		SparseVoxelBrick brick;
+	};
+	std::deque<Pending> queue = { Pending{ 0, SparseVoxelBrick{ NO_BRICK, 0, 0, 0, 0 } } };
+	std::vector<SparseVoxelBrick> table;
+	std::vector<uint32_t> blocks;
+	std::vector<unsigned char> data(brickBlocks * SparseVoxelOctree::BLOCK_SIZE);
+	uint32_t count = 1;
+	uint64_t offset = 0;
+	while (!queue.empty()) {
+		Pending pending = queue.front();
+		queue.pop_front();
+		const uint32_t brick = static_cast<uint32_t>(table.size());
+		blocks.assign(1, pending.block);
+		// Blocks are taken breadth first, so a full brick holds the upper levels of its subtree
+		for (size_t local = 0; local < blocks.size(); local++) {
+			const unsigned char* sourceBlock = source.blocks() + blocks[local] * SparseVoxelOctree::BLOCK_SIZE;
+			std::memcpy(data.data() + local * SparseVoxelOctree::BLOCK_SIZE, sourceBlock, SparseVoxelOctree::BLOCK_SIZE);
+			for (uint32_t i = 0; i < 8; i++) {
+				GLuint children = read_children(sourceBlock, i);
+				uint32_t child = children >> 8;
+				if (child == 0) {
+					continue;
+				}
+				if (child >= sourceHeader.blockCount) {
+					throw IOException("corrupted sparse voxel octree file, a child block is out of range", LOGGER_DETAIL_DEFAULT);
+				}
+				if (blocks.size() < brickBlocks) {
+					children = static_cast<GLuint>(blocks.size() << 8) | (children & 0xFFu);
+					blocks.push_back(child);
+				}
+				else {
+					if (count >= MAX_BRICKS) {
+						throw OutOfBoundsException(LOGGER_DETAIL_DEFAULT);
+					}
+					queue.push_back(Pending{ child, SparseVoxelBrick{ brick, static_cast<uint32_t>(8 * local + i), 0, 0, 0 } });
+					children = MISSING | (count++ << 8) | (children & 0xFFu);
+				}
+				write_children(data.data() + local * SparseVoxelOctree::BLOCK_SIZE, i, children);
+			}
+		}
+		pending.brick.blocks = static_cast<uint32_t>(blocks.size());
+		pending.brick.offset = offset;
+		table.push_back(pending.brick);
+		file.write(reinterpret_cast<const char*>(data.data()), blocks.size() * SparseVoxelOctree::BLOCK_SIZE);
+		offset += blocks.size();
+	}
+	file.write(reinterpret_cast<const char*>(table.data()), table.size() * sizeof(SparseVoxelBrick));
+	header.brickCount = table.size();
+	file.seekp(0);
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	if (!file) {
+		throw IOException("could not write file: " + filename, LOGGER_DETAIL_DEFAULT);
+	}
+}
+
+rgle::gfx::SparseVoxelPageCache::SparseVoxelPageCache(std::shared_ptr<SparseVoxelBrickFile> file, size_t slots, std::shared_ptr<sync::ThreadPool> loader) :
+	_file(file),
+	_loader(loader),
+	_oldest(static_cast<uint32_t>(NO_SLOT)),
+	_newest(static_cast<uint32_t>(NO_SLOT)),
+	_reading(0)
+{
+	if (this->_file == nullptr || this->_loader == nullptr) {
+		throw NullPointerException(LOGGER_DETAIL_DEFAULT);
+	}
+	if (slots < 2) {
+		throw IllegalArgumentException("brick cache needs a slot for the root brick and one to stream into", LOGGER_DETAIL_DEFAULT);
+	}
+	if (slots * this->_file->header().brickBlocks > (size_t(1) << 23)) {
+		// Resident children words keep the MISSING bit clear, which leaves 23 bits of block index
+		throw IllegalArgumentException("brick cache must stay below 2^23 blocks", LOGGER_DETAIL_DEFAULT);
+	}
+	size_t bricks = static_cast<size_t>(this->_file->header().brickCount);
+	this->_brickSlots.resize(bricks, static_cast<uint32_t>(NO_SLOT));
+	this->_residentChildren.resize(bricks, 0);
+	this->_loading.resize(bricks, false);
+	this->_slotBricks.resize(slots, SparseVoxelBrickFile::NO_BRICK);
+	this->_lastUsed.resize(slots, 0);
+	this->_older.resize(slots, static_cast<uint32_t>(NO_SLOT));
+	this->_newer.resize(slots, static_cast<uint32_t>(NO_SLOT));
+	this->_listed.resize(slots, false);
+	for (size_t slot = slots; slot-- > 1;) {
+		this->_freeSlots.push_back(static_cast<uint32_t>(slot));
+	}
+	this->_statistics.slots = slots;
+}
+
+rgle::gfx::SparseVoxelPageCache::~SparseVoxelPageCache()
+{
+	while (this->_reading > 0) {
+		std::this_thread::yield();
+	}
+}
+
+rgle::util::Range<size_t> rgle::gfx::SparseVoxelPageCache::initialize(unsigned char* buffer)
+{
+	// The root brick is never relocated, its child blocks already count from block 0
+	size_t blocks = this->_file->brick(0).blocks;
+	std::memcpy(buffer, this->_file->blocks(0), blocks * SparseVoxelOctree::BLOCK_SIZE);
+	this->_brickSlots[0] = 0;
+	this->_slotBricks[0] = 0;
+	this->_statistics.resident = 1;
+	return util::Range<size_t>{ 0, blocks };
+}
+
+void rgle::gfx::SparseVoxelPageCache::touch(size_t slot, uint64_t frame)
+{
+	if (slot < this->_lastUsed.size() && frame > this->_lastUsed[slot]) {
+		this->_lastUsed[slot] = frame;
+		if (this->_listed[slot]) {
+			this->_unlist(slot);
+			this->_list(slot);
+		}
+	}
+}
+
+void rgle::gfx::SparseVoxelPageCache::request(std::span<const uint32_t> bricks)
+{
+	for (uint32_t brick : bricks) {
+		if (brick >= this->_brickSlots.size() || this->_loading[brick] || this->resident(brick)) {
+			continue;
+		}
+		uint32_t parent = this->_file->brick(brick).parent;
+		if (parent == SparseVoxelBrickFile::NO_BRICK || !this->resident(parent)) {
+			continue;
+		}
+		this->_loading[brick] = true;
+		this->_statistics.requested++;
+		this->_reading++;
+		this->_loader->startJob([this, brick]() {
+			// An exception leaving the job would terminate the worker, it is kept and rethrown by the next update
+			try {
+				// Copying out of the mapping is where the brick is read from disk
+				const unsigned char* blocks = this->_file->blocks(brick);
+				Load load{ brick, std::vector<unsigned char>(blocks, blocks + this->_file->brick(brick).blocks * SparseVoxelOctree::BLOCK_SIZE) };
+				std::lock_guard<std::mutex> lock(this->_mutex);
+				this->_loaded.push_back(std::move(load));
+			}
+			catch (...) {
+				std::lock_guard<std::mutex> lock(this->_mutex);
+				if (!this->_error) {
+					this->_error = std::current_exception();
+				}
+			}
+			this->_reading--;
+		});
+	}
+}
+
+std::vector<rgle::util::Range<size_t>> rgle::gfx::SparseVoxelPageCache::update(unsigned char* buffer, size_t maxUploads, uint64_t frame)
+{
+	std::vector<Load> loads;
+	{
+		std::lock_guard<std::mutex> lock(this->_mutex);
+		if (this->_error) {
+			std::exception_ptr error = this->_error;
+			this->_error = nullptr;
+			std::rethrow_exception(error);
+		}
+		while (!this->_loaded.empty() && loads.size() < maxUploads) {
+			loads.push_back(std::move(this->_loaded.front()));
+			this->_loaded.pop_front();
+		}
+	}
+	std::vector<util::Range<size_t>> written;
+	const size_t brickBlocks = this->_file->header().brickBlocks;
+	for (auto& load : loads) {
+		this->_loading[load.brick] = false;
+		const SparseVoxelBrick& brick = this->_file->brick(load.brick);
+		if (!this->resident(brick.parent)) {
+			this->_statistics.dropped++;
+			continue;
+		}
+		size_t slot = this->_evictable(this->slot(brick.parent), frame);
+		if (slot == NO_SLOT) {
+			this->_statistics.dropped++;
+			continue;
+		}
+		if (this->_slotBricks[slot] != SparseVoxelBrickFile::NO_BRICK) {
+			this->_evict(slot, buffer, written);
+		}
+		// Evicting frees the slot, so it is always the last free slot here
+		this->_freeSlots.pop_back();
+		// Relocate the child blocks of the brick to its slot, links to other bricks stay missing
+		const GLuint base = static_cast<GLuint>(slot * brickBlocks);
+		unsigned char* target = buffer + slot * brickBlocks * SparseVoxelOctree::BLOCK_SIZE;
+		std::memcpy(target, load.data.data(), brick.blocks * SparseVoxelOctree::BLOCK_SIZE);
+		for (size_t node = 0; node < 8 * brick.blocks; node++) {
+			GLuint children = read_children(target, node);
+			if ((children & SparseVoxelBrickFile::MISSING) == 0 && (children >> 8) != 0) {
+				write_children(target, node, (((children >> 8) + base) << 8) | (children & 0xFFu));
+			}
+		}
+		written.push_back(util::Range<size_t>{ slot * brickBlocks, slot * brickBlocks + brick.blocks });
+		this->_brickSlots[load.brick] = static_cast<uint32_t>(slot);
+		this->_slotBricks[slot] = load.brick;
+		this->_lastUsed[slot] = frame;
+		this->_list(slot);
+		size_t parentSlot = this->slot(brick.parent);
+		if (this->_residentChildren[brick.parent]++ == 0 && this->_listed[parentSlot]) {
+			this->_unlist(parentSlot);
+		}
+		this->_link(load.brick, base << 8, buffer, written);
+		this->_statistics.loaded++;
+		this->_statistics.resident++;
+	}
+	return written;
+}
+
+bool rgle::gfx::SparseVoxelPageCache::resident(uint32_t brick) const
+{
+	return this->_brickSlots[brick] != static_cast<uint32_t>(NO_SLOT);
+}
+
+size_t rgle::gfx::SparseVoxelPageCache::slot(uint32_t brick) const
+{
+	return this->resident(brick) ? this->_brickSlots[brick] : NO_SLOT;
+}
+
+size_t rgle::gfx::SparseVoxelPageCache::pending() const
+{
+	return this->_statistics.requested - this->_statistics.loaded - this->_statistics.dropped;
+}
+
+const rgle::gfx::SparseVoxelBrickFile& rgle::gfx::SparseVoxelPageCache::file() const
+{
+	return *this->_file;
+}
+
+const rgle::gfx::SparseVoxelPageStatistics& rgle::gfx::SparseVoxelPageCache::statistics() const
+{
+	return this->_statistics;
+}
+
+size_t rgle::gfx::SparseVoxelPageCache::_evictable(size_t keep, uint64_t frame) const
+{
+	// Free slots first, then the least recently used brick with no resident children that was not visited during frame,
+	// the newest frame the feedback was read for
+	if (!this->_freeSlots.empty()) {
+		return this->_freeSlots.back();
+	}
+	for (uint32_t slot = this->_oldest; slot != static_cast<uint32_t>(NO_SLOT); slot = this->_newer[slot]) {
+		if (this->_lastUsed[slot] >= frame) {
+			// The slots after it were used as recently or later
+			return NO_SLOT;
+		}
+		if (slot != keep) {
+			return slot;
+		}
+	}
+	return NO_SLOT;
+}
+
+void rgle::gfx::SparseVoxelPageCache::_evict(size_t slot, unsigned char* buffer, std::vector<util::Range<size_t>>& written)
+{
+	uint32_t brick = this->_slotBricks[slot];
+	uint32_t parent = this->_file->brick(brick).parent;
+	this->_link(brick, SparseVoxelBrickFile::MISSING | (brick << 8), buffer, written);
+	this->_unlist(slot);
+	// The root brick is never evicted, so its slot is never listed
+	size_t parentSlot = this->slot(parent);
+	if (--this->_residentChildren[parent] == 0 && parentSlot != 0) {
+		this->_list(parentSlot);
+	}
+	this->_brickSlots[brick] = static_cast<uint32_t>(NO_SLOT);
+	this->_slotBricks[slot] = SparseVoxelBrickFile::NO_BRICK;
+	this->_freeSlots.push_back(static_cast<uint32_t>(slot));
+	this->_statistics.evicted++;
+	this->_statistics.resident--;
+}
+
+void rgle::gfx::SparseVoxelPageCache::_list(size_t slot)
+{
+	const uint32_t none = static_cast<uint32_t>(NO_SLOT);
+	uint32_t older = this->_newest;
+	while (older != none && this->_lastUsed[older] > this->_lastUsed[slot]) {
+		older = this->_older[older];
+	}
+	uint32_t newer = older != none ? this->_newer[older] : this->_oldest;
+	this->_older[slot] = older;
+	this->_newer[slot] = newer;
+	(older != none ? this->_newer[older] : this->_oldest) = static_cast<uint32_t>(slot);
+	(newer != none ? this->_older[newer] : this->_newest) = static_cast<uint32_t>(slot);
+	this->_listed[slot] = true;
+}
+
+void rgle::gfx::SparseVoxelPageCache::_unlist(size_t slot)
+{
+	if (!this->_listed[slot]) {
+		return;
+	}
+	const uint32_t none = static_cast<uint32_t>(NO_SLOT);
+	uint32_t older = this->_older[slot];
+	uint32_t newer = this->_newer[slot];
+	(older != none ? this->_newer[older] : this->_oldest) = newer;
+	(newer != none ? this->_older[newer] : this->_newest) = older;
+	this->_older[slot] = none;
+	this->_newer[slot] = none;
+	this->_listed[slot] = false;
+}
+
+void rgle::gfx::SparseVoxelPageCache::_link(uint32_t brick, GLuint children, unsigned char* buffer, std::vector<util::Range<size_t>>& written)
+{
+	// Rewrite the parent node's children word, keeping its child mask
+	const SparseVoxelBrick& entry = this->_file->brick(brick);
+	size_t node = this->slot(entry.parent) * this->_file->header().brickBlocks * 8 + entry.node;
+	write_children(buffer, node, children | (read_children(buffer, node) & 0xFFu));
+	written.push_back(util::Range<size_t>{ node / 8, node / 8 + 1 });
+}
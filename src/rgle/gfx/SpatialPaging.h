@@ -0,0 +1,185 @@
+#pragma once
+
+#include "rgle/gfx/SpatialFile.h"
+#include "rgle/sync/Thread.h"
+
+namespace rgle::gfx {
+
+	// Fixed size header at the start of a sparse voxel brick file, in native (little endian) byte order
+	// @remarks
+	// The header is followed by the blocks of the brickCount bricks back to back, each brick taking only the blocks it
+	// uses, then a SparseVoxelBrick entry per brick which ends the file. Bricks are numbered in breadth first order,
+	// brick 0 holds the root block
+	struct SparseVoxelBrickFileHeader {
+		char magic[8];
+		uint32_t version;
+		// Bytes per block, SparseVoxelOctree::BLOCK_SIZE of the writer
+		uint32_t blockSize;
+		uint64_t brickCount;
+		float rootSize;
+		// Depth of the deepest node, zero when the root is a leaf
+		uint32_t depth;
+		uint32_t brickBlocks;
+		// Bounds of the visible leaves, lower above upper when there are none
+		float lower[3];
+		float upper[3];
+		uint8_t reserved[4];
+
+		static const char MAGIC[8];
+		static const uint32_t VERSION;
+	};
+
+	static_assert(sizeof(SparseVoxelBrickFileHeader) == 64, "sparse voxel brick file header must stay 64 bytes");
+
+	// Position of a brick in the tree
+	struct SparseVoxelBrick {
+		// Brick holding the parent node, SparseVoxelBrickFile::NO_BRICK for the root brick
+		uint32_t parent;
+		// Node of the parent brick, counted from its first node, whose children are the first block of the brick
+		uint32_t node;
+		// Blocks of the brick in use, at most brickBlocks
+		uint32_t blocks;
+		uint32_t reserved;
+		// First block of the brick, counted from the end of the header
+		uint64_t offset;
+	};
+
+	static_assert(sizeof(SparseVoxelBrick) == 24, "sparse voxel brick entries must stay 24 bytes");
+
+	// Read only memory mapping of an octree cut into fixed size bricks, the unit a paged SparseVoxelOctree streams
+	// @remarks
+	// Blocks of a brick address their children by block index within the brick. Nodes whose children start another
+	// brick have the MISSING bit set in their payload and the brick in bits 8 to 30, next to their child mask
+	class SparseVoxelBrickFile {
+	public:
+		static const uint32_t NO_BRICK;
+		// Flag of a children word pointing to a brick instead of a block
+		static const GLuint MISSING;
+		// Bricks are named by the 23 bits between the child mask and the MISSING flag
+		static const size_t MAX_BRICKS;
+
+		// Maps the file and validates its header, size and brick table
+		SparseVoxelBrickFile(const std::string& filename);
+
+		const SparseVoxelBrickFileHeader& header() const;
+		const SparseVoxelBrick& brick(uint32_t index) const;
+		// Payload blocks of a brick, brick(index).blocks of them
+		const unsigned char* blocks(uint32_t index) const;
+
+		// Bytes of a full brick, the size of one slot of a brick cache
+		size_t brickSize() const;
+
+		// Cuts the octree of source into bricks of at most brickBlocks blocks, filling each brick breadth first
+		// @note bricks cut below a full brick are stored with the blocks they use only
+		// @note the source is read through its mapping, so octrees larger than memory can be converted
+		static void write(const std::string& filename, const SparseVoxelFile& source, size_t brickBlocks);
+
+	private:
+		util::MappedFile _file;
+	};
+
+	struct SparseVoxelPageOptions {
+		// Bytes of GPU memory the resident bricks may use, rounded down to whole bricks
+		size_t budget = size_t(256) << 20;
+		// Loaded bricks moved into the GPU buffer per flush, bounds the upload time of a frame
+		size_t uploadsPerFrame = 64;
+		// Missing bricks the traversal can report per frame
+		size_t feedbackCapacity = 4096;
+	};
+
+	struct SparseVoxelPageStatistics {
+		size_t slots = 0;
+		size_t resident = 0;
+		size_t requested = 0;
+		size_t loaded = 0;
+		size_t evicted = 0;
+		// Loaded bricks thrown away, because their parent was evicted meanwhile or every slot was in use
+		size_t dropped = 0;
+	};
+
+	// CPU side of the brick cache of a paged octree, places bricks into the slots of a buffer in the layout of the
+	// GPU octree buffer
+	// @remarks
+	// Slot s holds its brick at block s * brickBlocks, with the child blocks of the brick relocated to it. A resident
+	// brick is linked into the node of its parent brick, which is always resident too: bricks are only loaded below a
+	// resident brick, and only bricks without resident children are evicted, least recently used first. These bricks
+	// are kept in a list ordered by their last use, so choosing a slot takes constant time. Slot 0 holds the root brick
+	// for the lifetime of the cache
+	class SparseVoxelPageCache {
+	public:
+		static const size_t NO_SLOT;
+
+		SparseVoxelPageCache(std::shared_ptr<SparseVoxelBrickFile> file, size_t slots, std::shared_ptr<sync::ThreadPool> loader);
+		SparseVoxelPageCache(const SparseVoxelPageCache&) = delete;
+		// Waits for the bricks being read by the loader
+		~SparseVoxelPageCache();
+
+		void operator=(const SparseVoxelPageCache&) = delete;
+
+		// Writes the root brick into slot 0
+		// @returns the blocks written
+		util::Range<size_t> initialize(unsigned char* buffer);
+
+		// Records that the traversal visited slot during frame
+		void touch(size_t slot, uint64_t frame);
+		// Starts reading missing bricks on the loader, bricks loading, resident or below a brick that is not resident
+		// are skipped
+		void request(std::span<const uint32_t> bricks);
+		// Moves up to maxUploads bricks read by the loader into buffer and links them into their parents
+		// @param frame the newest frame whose visits were recorded, slots visited during it are not evicted
+		// @returns the blocks written
+		// @throws the first exception thrown while the loader read a brick since the last update
+		std::vector<util::Range<size_t>> update(unsigned char* buffer, size_t maxUploads, uint64_t frame);
+
+		bool resident(uint32_t brick) const;
+		// @returns the slot of brick, or NO_SLOT if it is not resident
+		size_t slot(uint32_t brick) const;
+		// Bricks requested and not yet moved into the buffer
+		size_t pending() const;
+
+		const SparseVoxelBrickFile& file() const;
+		const SparseVoxelPageStatistics& statistics() const;
+
+	private:
+		struct Load {
+			uint32_t brick;
+			std::vector<unsigned char> data;
+		};
+
+		size_t _evictable(size_t keep, uint64_t frame) const;
+		void _evict(size_t slot, unsigned char* buffer, std::vector<util::Range<size_t>>& written);
+		// Inserts slot into the eviction list by its last use, searching from the most recently used end
+		void _list(size_t slot);
+		void _unlist(size_t slot);
+		void _link(uint32_t brick, GLuint children, unsigned char* buffer, std::vector<util::Range<size_t>>& written);
+
+		std::shared_ptr<SparseVoxelBrickFile> _file;
+		std::shared_ptr<sync::ThreadPool> _loader;
+
+		// Per brick state
+		std::vector<uint32_t> _brickSlots;
+		std::vector<uint32_t> _residentChildren;
+		std::vector<bool> _loading;
+
+		// Per slot state
+		std::vector<uint32_t> _slotBricks;
+		std::vector<uint64_t> _lastUsed;
+
+		// Slots of bricks without resident children, the eviction candidates, linked from the least recently used
+		std::vector<uint32_t> _older;
+		std::vector<uint32_t> _newer;
+		std::vector<bool> _listed;
+		uint32_t _oldest;
+		uint32_t _newest;
+		// Slots without a brick, the lowest last
+		std::vector<uint32_t> _freeSlots;
+
+		// Bricks read by the loader and the first exception it threw, guarded by _mutex
+		std::mutex _mutex;
+		std::deque<Load> _loaded;
+		std::exception_ptr _error;
+		std::atomic_size_t _reading;
+
+		SparseVoxelPageStatistics _statistics;
+	};
+}
@@ -0,0 +1,225 @@
+#include "rgle/gfx/SpatialRaycast.h"
+#include "rgle/math/Morton.h"
+
+namespace {
+	// Constants and helpers mirroring sparse-voxel.comp, keep them in sync with the shader
+	const float EPSILON = 0.01f;
+	const uint32_t UINT_MAX_LOG = 9;
+
+	// Returns true if the cube centered at position is hit by the line p + vt, like raycast_cube of the shader
+	bool raycast_cube(const glm::vec3& position, float size, const glm::vec3& p, const glm::vec3& v) {
+		glm::vec3 lower = position - size / 2;
+		glm::vec3 upper = position + size / 2;
+		glm::vec2 tx((lower.x - p.x) / v.x, (upper.x - p.x) / v.x);
+		tx = glm::vec2(std::min(tx.x, tx.y), std::max(tx.x, tx.y));
+		glm::vec2 ty((lower.y - p.y) / v.y, (upper.y - p.y) / v.y);
+		ty = glm::vec2(std::min(ty.x, ty.y), std::max(ty.x, ty.y));
+		glm::vec2 tz((lower.z - p.z) / v.z, (upper.z - p.z) / v.z);
+		tz = glm::vec2(std::min(tz.x, tz.y), std::max(tz.x, tz.y));
+		float tlower = std::max(tx.x, std::max(ty.x, tz.x));
+		float tupper = std::min(tx.y, std::min(ty.y, tz.y));
+		return tx.x <= tupper &&
+			ty.x <= tupper &&
+			tz.x <= tupper &&
+			tx.y >= tlower &&
+			ty.y >= tlower &&
+			tz.y >= tlower;
+	}
+
+	// Center of child i of a node, matching OctreeIndex::from_index
+	glm::vec3 child_position(const glm::vec3& position, float size, uint32_t i) {
+		float quarter = size / 4;
+		return position + quarter * glm::vec3(
+			(i & 1) != 0 ? 1.0f : -1.0f,
+			(i & 2) != 0 ? -1.0f : 1.0f,
+			(i & 4) != 0 ? -1.0f : 1.0f
+		);
+	}
+
+	// Scale applied to distances before they are truncated, as serialize_depth of the shader
+	float depth_scale(float far) {
+		uint32_t digits = static_cast<uint32_t>(std::log2(far) / std::log2(10.0f)) + 1;
+		return std::pow(10.0f, static_cast<float>(UINT_MAX_LOG - digits));
+	}
+}
+
+struct rgle::gfx::SparseVoxelRaycaster::Frame {
+	uint32_t offset;
+	uint32_t depth;
+	glm::vec3 position;
+};
+
+double rgle::gfx::SparseVoxelRaycastStatistics::raysPerSecond() const
+{
+	if (this->seconds <= 0.0) {
+		return 0.0;
+	}
+	return static_cast<double>(this->rays) / this->seconds;
+}
+
+rgle::gfx::SparseVoxelRaycaster::SparseVoxelRaycaster(SparseVoxelRaycastOptions options) :
+	SparseVoxelRaycaster(std::make_shared<sync::ThreadPool>(), options)
+{
+}
+
+rgle::gfx::SparseVoxelRaycaster::SparseVoxelRaycaster(std::shared_ptr<sync::ThreadPool> pool, SparseVoxelRaycastOptions options) :
+	_pool(pool),
+	_options(options)
+{
+	if (this->_pool == nullptr) {
+		throw NullPointerException(LOGGER_DETAIL_DEFAULT);
+	}
+}
+
+rgle::gfx::SparseVoxelRaycastStatistics rgle::gfx::SparseVoxelRaycaster::render(const SparseVoxelPool& pool, const SparseVoxelCamera& camera, Image& offsets) const
+{
+	if (offsets.image == nullptr || offsets.channels != 1 || offsets.channelSize != sizeof(GLint)) {
+		throw IllegalArgumentException("voxel raycaster requires a single channel GLint image", LOGGER_DETAIL_DEFAULT);
+	}
+	if (this->_options.tileSize == 0) {
+		throw IllegalArgumentException("voxel raycaster tile size must be positive", LOGGER_DETAIL_DEFAULT);
+	}
+	auto start = std::chrono::steady_clock::now();
+
+	size_t finalDepth = this->_options.finalDepth;
+	if (finalDepth == 0) {
+		// The pass renderer allocates ceil(log2(width)) pass buffers and finalizes the rays of the second to last one
+		finalDepth = static_cast<size_t>(std::max(std::ceil(std::log2(static_cast<double>(offsets.width))) - 2.0, 0.0));
+	}
+
+	// Snapshot the payloads so rays read the node format the shaders read
+	std::vector<SparseVoxelNodePayload> nodes(8 * pool.blockCount());
+	const size_t chunk = 1 << 14;
+	this->_pool->runJobs((nodes.size() + chunk - 1) / chunk, [&pool, &nodes, chunk](size_t job) {
+		size_t last = std::min((job + 1) * chunk, nodes.size());
+		for (size_t i = job * chunk; i < last; i++) {
+			nodes[i] = pool.payload(static_cast<uint32_t>(i));
+		}
+	});
+
+	size_t tilesX = (offsets.width + this->_options.tileSize - 1) / this->_options.tileSize;
+	size_t tilesY = (offsets.height + this->_options.tileSize - 1) / this->_options.tileSize;
+	std::vector<std::pair<uint32_t, uint32_t>> tiles;
+	tiles.reserve(tilesX * tilesY);
+	for (size_t y = 0; y < tilesY; y++) {
+		for (size_t x = 0; x < tilesX; x++) {
+			tiles.push_back({ math::morton::encode_2d(static_cast<uint32_t>(x), static_cast<uint32_t>(y)), static_cast<uint32_t>(y * tilesX + x) });
+		}
+	}
+	std::sort(tiles.begin(), tiles.end());
+
+	std::atomic_size_t visited = 0;
+	this->_pool->runJobs(tiles.size(), [this, &tiles, &nodes, &pool, &camera, &offsets, &visited, tilesX, finalDepth](size_t i) {
+		size_t x0 = (tiles[i].second % tilesX) * this->_options.tileSize;
+		size_t y0 = (tiles[i].second / tilesX) * this->_options.tileSize;
+		visited += this->_renderTile(nodes, pool, camera, offsets, finalDepth, x0, y0);
+	});
+
+	return SparseVoxelRaycastStatistics {
+		.rays = offsets.width * offsets.height,
+		.nodes = visited,
+		.tiles = tiles.size(),
+		.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count()
+	};
+}
+
+void rgle::gfx::SparseVoxelRaycaster::realize(const SparseVoxelPool& pool, const Image& offsets, Image8& image)
+{
+	if (offsets.image == nullptr || offsets.channels != 1 || offsets.channelSize != sizeof(GLint)) {
+		throw IllegalArgumentException("voxel realize requires a single channel GLint offset image", LOGGER_DETAIL_DEFAULT);
+	}
+	if (image.image == nullptr || image.channels != 4 || image.width != offsets.width || image.height != offsets.height) {
+		throw IllegalArgumentException("voxel realize requires an RGBA image the size of the offset image", LOGGER_DETAIL_DEFAULT);
+	}
+	size_t nodeCount = 8 * pool.blockCount();
+	for (size_t y = 0; y < offsets.height; y++) {
+		for (size_t x = 0; x < offsets.width; x++) {
+			GLint offset;
+			std::memcpy(&offset, offsets.image + (y * offsets.width + x) * sizeof(GLint), sizeof(GLint));
+			auto color = glm::vec4(0.0f, 0.0f, 0.0f, 0.0f);
+			if (offset >= 0 && static_cast<size_t>(offset) < nodeCount) {
+				color = SparseVoxelNodePayload::unpackColor(pool.payload(static_cast<uint32_t>(offset)).color);
+			}
+			image.set(x, y, color);
+		}
+	}
+}
+
+rgle::gfx::SparseVoxelRaycastOptions& rgle::gfx::SparseVoxelRaycaster::options()
+{
+	return this->_options;
+}
+
+const rgle::gfx::SparseVoxelRaycastOptions& rgle::gfx::SparseVoxelRaycaster::options() const
+{
+	return this->_options;
+}
+
+size_t rgle::gfx::SparseVoxelRaycaster::_renderTile(
+	const std::vector<SparseVoxelNodePayload>& nodes,
+	const SparseVoxelPool& pool,
+	const SparseVoxelCamera& camera,
+	Image& offsets,
+	size_t finalDepth,
+	size_t x0,
+	size_t y0) const
+{
+	const int width = static_cast<int>(offsets.width);
+	const int height = static_cast<int>(offsets.height);
+	const glm::vec3 eye = camera.position();
+	const float spread = std::sin(camera.fieldOfView() / static_cast<float>(width));
+	const float scale = depth_scale(camera.farClip());
+	size_t x1 = std::min(x0 + this->_options.tileSize, offsets.width);
+	size_t y1 = std::min(y0 + this->_options.tileSize, offsets.height);
+	size_t visited = 0;
+
+	std::vector<Frame> stack;
+	stack.reserve(7 * finalDepth + 8);
+	for (size_t y = y0; y < y1; y++) {
+		for (size_t x = x0; x < x1; x++) {
+			glm::vec3 ray = camera.rotation() * camera.pixelRay(static_cast<int>(x), static_cast<int>(y), width, height);
+			uint32_t best = std::numeric_limits<uint32_t>::max();
+			GLint result = -1;
+			// Block 0 holds the root in its first slot, centered at the origin
+			stack.push_back(Frame{ 0, 0, glm::vec3(0.0f, 0.0f, 0.0f) });
+			while (!stack.empty()) {
+				Frame frame = stack.back();
+				stack.pop_back();
+				visited++;
+				const auto& node = nodes[frame.offset];
+				float alpha = static_cast<float>(node.color >> 24) / 255.0f;
+				uint32_t mask = node.children & 0xFFu;
+				float size = std::ldexp(pool.rootSize(), -static_cast<int>(frame.depth));
+				glm::vec3 relative = frame.position - eye;
+				float distance = glm::length(relative);
+				bool done =
+					size < spread * distance ||
+					alpha < EPSILON ||
+					glm::dot(camera.direction(), relative) < camera.nearClip() - size ||
+					distance > camera.farClip() + size ||
+					mask == 0 ||
+					frame.depth >= finalDepth;
+				if (!raycast_cube(frame.position, size, eye, ray)) {
+					continue;
+				}
+				if (!done) {
+					uint32_t next = (node.children >> 8) * 8;
+					for (uint32_t i = 8; i-- > 0;) {
+						if ((mask & (1u << i)) != 0) {
+							stack.push_back(Frame{ next + i, frame.depth + 1, child_position(frame.position, size, i) });
+						}
+					}
+				}
+				else if (alpha >= EPSILON) {
+					uint32_t depth = static_cast<uint32_t>(scale * distance);
+					if (depth < best) {
+						best = depth;
+						result = static_cast<GLint>(frame.offset);
+					}
+				}
+			}
+			offsets.set(x, y, reinterpret_cast<unsigned char*>(&result), sizeof(GLint));
+		}
+	}
+	return visited;
+}
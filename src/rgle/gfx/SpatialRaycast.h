@@ -0,0 +1,60 @@
+#pragma once
+
+#include "rgle/gfx/Spatial.h"
+#include "rgle/sync/Thread.h"
+
+namespace rgle::gfx {
+
+	struct SparseVoxelRaycastOptions {
+		// Width and height in pixels of the square tiles scheduled on the thread pool
+		size_t tileSize = 16;
+		// Depth at which rays stop descending, zero matches the last pass of a SparseVoxelRenderer of the image width
+		size_t finalDepth = 0;
+	};
+
+	struct SparseVoxelRaycastStatistics {
+		double raysPerSecond() const;
+
+		size_t rays = 0;
+		size_t nodes = 0;
+		size_t tiles = 0;
+		double seconds = 0.0;
+	};
+
+	// CPU reference of the sparse-voxel.comp pass traversal, producing the same image of node offsets
+	// @remarks
+	// Every pixel keeps the node with the smallest serialized depth among the nodes its ray stops at, like the
+	// imageAtomicMin of the shader. Where the shader breaks ties by whichever invocation wrote last the raycaster keeps
+	// the node found first, so pixels with equally distant candidates may differ from a GPU readback
+	class SparseVoxelRaycaster {
+	public:
+		SparseVoxelRaycaster(SparseVoxelRaycastOptions options = SparseVoxelRaycastOptions{});
+		SparseVoxelRaycaster(std::shared_ptr<sync::ThreadPool> pool, SparseVoxelRaycastOptions options = SparseVoxelRaycastOptions{});
+
+		// Traces the octree into a single channel GLint image, the image size sets the resolution
+		// @returns the number of rays traced, nodes visited and the time spent tracing them
+		SparseVoxelRaycastStatistics render(const SparseVoxelPool& pool, const SparseVoxelCamera& camera, Image& offsets) const;
+
+		// Colors an image of node offsets the way sparse-voxel-realize.frag does, into an 8 bit RGBA image
+		static void realize(const SparseVoxelPool& pool, const Image& offsets, Image8& image);
+
+		SparseVoxelRaycastOptions& options();
+		const SparseVoxelRaycastOptions& options() const;
+
+	private:
+		struct Frame;
+
+		size_t _renderTile(
+			const std::vector<SparseVoxelNodePayload>& nodes,
+			const SparseVoxelPool& pool,
+			const SparseVoxelCamera& camera,
+			Image& offsets,
+			size_t finalDepth,
+			size_t x0,
+			size_t y0
+		) const;
+
+		std::shared_ptr<sync::ThreadPool> _pool;
+		SparseVoxelRaycastOptions _options;
+	};
+}
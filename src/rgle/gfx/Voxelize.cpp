@@ -0,0 +1,704 @@
+#include "rgle/gfx/Voxelize.h"
+#include "rgle/math/Morton.h"
+
+namespace {
+	const uint32_t NO_BLOCK = std::numeric_limits<uint32_t>::max();
+
+	typedef std::array<glm::vec3, 3> Triangle;
+
+	// Children of one node built by a job, indices in children refer to the job's own blocks
+	struct VoxelBlock {
+		std::array<glm::vec4, 8> colors;
+		std::array<uint32_t, 8> children;
+	};
+
+	struct VoxelContext {
+		const rgle::gfx::VoxelMesh& mesh;
+		const std::vector<Triangle>& triangles;
+		bool colored;
+		bool textured;
+	};
+
+	// Center of child i of a node, matching OctreeIndex::from_index
+	glm::vec3 child_position(const glm::vec3& position, float size, uint32_t i) {
+		float quarter = size / 4;
+		return position + quarter * glm::vec3(
+			(i & 1) != 0 ? 1.0f : -1.0f,
+			(i & 2) != 0 ? -1.0f : 1.0f,
+			(i & 4) != 0 ? -1.0f : 1.0f
+		);
+	}
+
+	rgle::gfx::SparseVoxelNode child(const rgle::gfx::SparseVoxelNode& node, uint32_t i) {
+		rgle::gfx::OctreeIndex::X x;
+		rgle::gfx::OctreeIndex::Y y;
+		rgle::gfx::OctreeIndex::Z z;
+		rgle::gfx::OctreeIndex::from_index(i, x, y, z);
+		return node.child(x, y, z);
+	}
+
+	// Separating axis test of a triangle against the cube centered at center with half edge length half
+	bool triangle_box_overlap(const glm::vec3& center, float half, const Triangle& triangle) {
+		glm::vec3 a = triangle[0] - center;
+		glm::vec3 b = triangle[1] - center;
+		glm::vec3 c = triangle[2] - center;
+		auto separated = [&a, &b, &c, half](const glm::vec3& axis) {
+			float pa = glm::dot(a, axis);
+			float pb = glm::dot(b, axis);
+			float pc = glm::dot(c, axis);
+			float r = half * (std::abs(axis.x) + std::abs(axis.y) + std::abs(axis.z));
+			return std::min(pa, std::min(pb, pc)) > r || std::max(pa, std::max(pb, pc)) < -r;
+		};
+		// Box face normals
+		for (int axis = 0; axis < 3; axis++) {
+			if (std::min(a[axis], std::min(b[axis], c[axis])) > half || std::max(a[axis], std::max(b[axis], c[axis])) < -half) {
+				return false;
+			}
+		}
+		// Triangle normal
+		glm::vec3 edges[3] = { b - a, c - b, a - c };
+		if (separated(glm::cross(edges[0], edges[1]))) {
+			return false;
+		}
+		// Cross products of the box axes with the triangle edges
+		for (const auto& edge : edges) {
+			if (separated(glm::vec3(0.0f, -edge.z, edge.y)) ||
+				separated(glm::vec3(edge.z, 0.0f, -edge.x)) ||
+				separated(glm::vec3(-edge.y, edge.x, 0.0f))) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// Barycentric weights of the point of the triangle closest to p
+	glm::vec3 closest_barycentric(const glm::vec3& p, const Triangle& triangle) {
+		const glm::vec3& a = triangle[0];
+		const glm::vec3& b = triangle[1];
+		const glm::vec3& c = triangle[2];
+		glm::vec3 ab = b - a;
+		glm::vec3 ac = c - a;
+		glm::vec3 ap = p - a;
+		float d1 = glm::dot(ab, ap);
+		float d2 = glm::dot(ac, ap);
+		if (d1 <= 0.0f && d2 <= 0.0f) {
+			return glm::vec3(1.0f, 0.0f, 0.0f);
+		}
+		glm::vec3 bp = p - b;
+		float d3 = glm::dot(ab, bp);
+		float d4 = glm::dot(ac, bp);
+		if (d3 >= 0.0f && d4 <= d3) {
+			return glm::vec3(0.0f, 1.0f, 0.0f);
+		}
+		float vc = d1 * d4 - d3 * d2;
+		if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) {
+			float v = d1 / (d1 - d3);
+			return glm::vec3(1.0f - v, v, 0.0f);
+		}
+		glm::vec3 cp = p - c;
+		float d5 = glm::dot(ab, cp);
+		float d6 = glm::dot(ac, cp);
+		if (d6 >= 0.0f && d5 <= d6) {
+			return glm::vec3(0.0f, 0.0f, 1.0f);
+		}
+		float vb = d5 * d2 - d1 * d6;
+		if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) {
+			float w = d2 / (d2 - d6);
+			return glm::vec3(1.0f - w, 0.0f, w);
+		}
+		float va = d3 * d6 - d5 * d4;
+		if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f) {
+			float w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+			return glm::vec3(0.0f, 1.0f - w, w);
+		}
+		float denominator = va + vb + vc;
+		if (!(denominator != 0.0f)) {
+			// Degenerate triangle, weigh the vertices equally
+			return glm::vec3(1.0f / 3.0f);
+		}
+		float v = vb / denominator;
+		float w = vc / denominator;
+		return glm::vec3(1.0f - v - w, v, w);
+	}
+
+	glm::vec4 sample(const rgle::gfx::Image& texture, const glm::vec2& uv) {
+		float u = uv.x - std::floor(uv.x);
+		float v = uv.y - std::floor(uv.y);
+		size_t x = std::min(static_cast<size_t>(u * texture.width), texture.width - 1);
+		size_t y = std::min(static_cast<size_t>(v * texture.height), texture.height - 1);
+		const unsigned char* texel = texture.image + (y * texture.width + x) * texture.channels;
+		switch (texture.channels) {
+		case 1:
+			return glm::vec4(glm::vec3(texel[0] / 255.0f), 1.0f);
+		case 2:
+			return glm::vec4(glm::vec3(texel[0] / 255.0f), texel[1] / 255.0f);
+		case 3:
+			return glm::vec4(texel[0] / 255.0f, texel[1] / 255.0f, texel[2] / 255.0f, 1.0f);
+		default:
+			return glm::vec4(texel[0] / 255.0f, texel[1] / 255.0f, texel[2] / 255.0f, texel[3] / 255.0f);
+		}
+	}
+
+	glm::vec4 leaf_color(const VoxelContext& context, const glm::vec3& center, const std::vector<uint32_t>& triangles) {
+		if (!context.colored && !context.textured) {
+			return glm::vec4(1.0f, 1.0f, 1.0f, 1.0f);
+		}
+		glm::vec4 sum = glm::vec4(0.0f);
+		for (uint32_t t : triangles) {
+			glm::vec3 weights = closest_barycentric(center, context.triangles[t]);
+			const uint32_t* indices = &context.mesh.indices[3 * t];
+			glm::vec4 color = glm::vec4(1.0f, 1.0f, 1.0f, 1.0f);
+			if (context.colored) {
+				color = weights.x * context.mesh.colors[indices[0]] +
+					weights.y * context.mesh.colors[indices[1]] +
+					weights.z * context.mesh.colors[indices[2]];
+			}
+			if (context.textured) {
+				glm::vec2 uv = weights.x * context.mesh.uvs[indices[0]] +
+					weights.y * context.mesh.uvs[indices[1]] +
+					weights.z * context.mesh.uvs[indices[2]];
+				color *= sample(*context.mesh.texture, uv);
+			}
+			sum += color;
+		}
+		return sum / static_cast<float>(triangles.size());
+	}
+
+	// Builds the block holding the children of the node centered at center, then the blocks below it in preorder
+	// @returns the index of the block in blocks
+	uint32_t build(
+		const VoxelContext& context,
+		const glm::vec3& center,
+		float size,
+		size_t levels,
+		const std::vector<uint32_t>& triangles,
+		std::vector<VoxelBlock>& blocks,
+		size_t& leaves)
+	{
+		uint32_t block = static_cast<uint32_t>(blocks.size());
+		blocks.push_back(VoxelBlock{});
+		blocks[block].colors.fill(glm::vec4(0.0f, 0.0f, 0.0f, 0.0f));
+		blocks[block].children.fill(NO_BLOCK);
+		std::vector<uint32_t> overlapping;
+		for (uint32_t i = 0; i < 8; i++) {
+			glm::vec3 position = child_position(center, size, i);
+			overlapping.clear();
+			for (uint32_t t : triangles) {
+				if (triangle_box_overlap(position, size / 4, context.triangles[t])) {
+					overlapping.push_back(t);
+				}
+			}
+			if (overlapping.empty()) {
+				continue;
+			}
+			if (levels == 1) {
+				blocks[block].colors[i] = leaf_color(context, position, overlapping);
+				leaves++;
+			}
+			else {
+				// Inner colors are blended when the edit transaction commits
+				blocks[block].colors[i] = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+				uint32_t next = build(context, position, size / 2, levels - 1, overlapping, blocks, leaves);
+				blocks[block].children[i] = next;
+			}
+		}
+		return block;
+	}
+
+	void insert(rgle::gfx::SparseVoxelNode node, const std::vector<VoxelBlock>& blocks, uint32_t block) {
+		node.insertChildren(blocks[block].colors);
+		for (uint32_t i = 0; i < 8; i++) {
+			if (blocks[block].children[i] != NO_BLOCK) {
+				insert(child(node, i), blocks, blocks[block].children[i]);
+			}
+		}
+	}
+
+	struct MortonPoint {
+		uint64_t code;
+		uint32_t index;
+	};
+
+	// Cell of value along one axis of a root of the given size split into 2^bits cells, or NO_BLOCK outside the root
+	uint32_t point_cell(float value, float rootSize, size_t bits) {
+		float cells = static_cast<float>(uint32_t(1) << bits);
+		float scaled = std::floor((value / rootSize + 0.5f) * cells);
+		if (!(scaled >= 0.0f && scaled <= cells)) {
+			return NO_BLOCK;
+		}
+		// Points on the upper faces belong to the last cell
+		return std::min(static_cast<uint32_t>(scaled), (uint32_t(1) << bits) - 1);
+	}
+
+	// Stable parallel LSD radix sort by the lowest bits of the codes, one byte per pass
+	void radix_sort(std::vector<MortonPoint>& points, std::vector<MortonPoint>& scratch, size_t bits, rgle::sync::ThreadPool& threads) {
+		const size_t RADIX = 256;
+		const size_t MIN_JOB = 1 << 16;
+		// One job per worker of the pool the jobs run on
+		size_t jobs = std::max<size_t>(1, std::min<size_t>(std::max<size_t>(threads.size(), 1), points.size() / MIN_JOB));
+		size_t stride = (points.size() + jobs - 1) / jobs;
+		std::vector<std::array<size_t, RADIX>> histograms(jobs);
+		scratch.resize(points.size());
+		for (size_t shift = 0; shift < bits; shift += 8) {
+			threads.runJobs(jobs, [&points, &histograms, stride, shift](size_t job) {
+				auto& histogram = histograms[job];
+				histogram.fill(0);
+				size_t last = std::min(points.size(), (job + 1) * stride);
+				for (size_t i = job * stride; i < last; i++) {
+					histogram[(points[i].code >> shift) & (RADIX - 1)]++;
+				}
+			});
+			// Digits in order, jobs in order within a digit, so equal digits keep their order
+			size_t offset = 0;
+			for (size_t digit = 0; digit < RADIX; digit++) {
+				for (auto& histogram : histograms) {
+					size_t count = histogram[digit];
+					histogram[digit] = offset;
+					offset += count;
+				}
+			}
+			threads.runJobs(jobs, [&points, &scratch, &histograms, stride, shift](size_t job) {
+				auto& histogram = histograms[job];
+				size_t last = std::min(points.size(), (job + 1) * stride);
+				for (size_t i = job * stride; i < last; i++) {
+					scratch[histogram[(points[i].code >> shift) & (RADIX - 1)]++] = points[i];
+				}
+			});
+			std::swap(points, scratch);
+		}
+	}
+
+	// Merges two sorted leaf runs into merged, summing the leaves both runs hold
+	void merge_leaves(
+		const std::vector<rgle::gfx::PointCloudLeaf>& a,
+		const std::vector<rgle::gfx::PointCloudLeaf>& b,
+		std::vector<rgle::gfx::PointCloudLeaf>& merged)
+	{
+		merged.clear();
+		merged.reserve(a.size() + b.size());
+		size_t i = 0;
+		size_t j = 0;
+		while (i < a.size() || j < b.size()) {
+			if (j == b.size() || (i < a.size() && a[i].code < b[j].code)) {
+				merged.push_back(a[i++]);
+			}
+			else if (i == a.size() || b[j].code < a[i].code) {
+				merged.push_back(b[j++]);
+			}
+			else {
+				merged.push_back(rgle::gfx::PointCloudLeaf{ a[i].code, a[i].sum + b[j].sum, a[i].count + b[j].count });
+				i++;
+				j++;
+			}
+		}
+	}
+
+	// Inserts the children of the node of code at level, then the blocks below them in preorder
+	void insert_points(
+		rgle::gfx::SparseVoxelNode node,
+		uint64_t code,
+		size_t level,
+		const std::vector<std::vector<uint64_t>>& levels,
+		const std::vector<rgle::gfx::PointCloudLeaf>& leaves,
+		std::vector<size_t>& cursors)
+	{
+		const size_t depth = levels.size() - 1;
+		const std::vector<uint64_t>& below = levels[level + 1];
+		size_t& cursor = cursors[level + 1];
+		size_t first = cursor;
+		std::array<glm::vec4, 8> colors;
+		colors.fill(glm::vec4(0.0f, 0.0f, 0.0f, 0.0f));
+		while (cursor < below.size() && (below[cursor] >> 3) == code) {
+			uint32_t i = static_cast<uint32_t>(below[cursor] & 7);
+			if (level + 1 == depth) {
+				colors[i] = leaves[cursor].sum / static_cast<float>(leaves[cursor].count);
+			}
+			else {
+				// Inner colors are blended when the edit transaction commits
+				colors[i] = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+			}
+			cursor++;
+		}
+		node.insertChildren(colors);
+		if (level + 1 == depth) {
+			return;
+		}
+		for (size_t j = first; j < cursor; j++) {
+			insert_points(child(node, static_cast<uint32_t>(below[j] & 7)), below[j], level + 1, levels, leaves, cursors);
+		}
+	}
+}
+
+rgle::gfx::Voxelizer::Voxelizer(VoxelizeOptions options) : Voxelizer(std::make_shared<sync::ThreadPool>(), options)
+{
+}
+
+rgle::gfx::Voxelizer::Voxelizer(std::shared_ptr<sync::ThreadPool> pool, VoxelizeOptions options) : _pool(pool), _options(options)
+{
+	if (this->_pool == nullptr) {
+		throw NullPointerException(LOGGER_DETAIL_DEFAULT);
+	}
+}
+
+rgle::gfx::VoxelizeStatistics rgle::gfx::Voxelizer::voxelize(const Geometry3D& geometry, SparseVoxelPool& pool) const
+{
+	VoxelMesh mesh;
+	mesh.vertices = geometry.vertex.list;
+	mesh.indices = std::vector<uint32_t>(geometry.index.list.begin(), geometry.index.list.end());
+	mesh.colors = geometry.color.list;
+	mesh.uvs = geometry.uv.list;
+	for (const auto& sampler : geometry.samplers) {
+		if (sampler.enabled && sampler.texture != nullptr && sampler.texture->image() != nullptr) {
+			mesh.texture = sampler.texture->image();
+			break;
+		}
+	}
+	return this->voxelize(mesh, pool);
+}
+
+rgle::gfx::VoxelizeStatistics rgle::gfx::Voxelizer::voxelize(const VoxelMesh& mesh, SparseVoxelPool& pool) const
+{
+	if (this->_options.depth == 0) {
+		throw IllegalArgumentException("voxelizer depth must be positive", LOGGER_DETAIL_DEFAULT);
+	}
+	if (mesh.indices.size() % 3 != 0) {
+		throw IllegalArgumentException("voxelizer index count must be a multiple of three", LOGGER_DETAIL_DEFAULT);
+	}
+	if (mesh.texture != nullptr && (mesh.texture->image == nullptr || mesh.texture->channelSize != 1)) {
+		throw IllegalArgumentException("voxelizer textures must be 8 bit images", LOGGER_DETAIL_DEFAULT);
+	}
+	if (!pool.root().leaf()) {
+		throw IllegalArgumentException("voxelizer root must be a leaf", LOGGER_DETAIL_DEFAULT);
+	}
+	auto start = std::chrono::steady_clock::now();
+
+	std::vector<Triangle> triangles;
+	triangles.reserve(mesh.indices.size() / 3);
+	float extent = 0.0f;
+	for (size_t i = 0; i < mesh.indices.size(); i += 3) {
+		Triangle triangle;
+		for (size_t j = 0; j < 3; j++) {
+			if (mesh.indices[i + j] >= mesh.vertices.size()) {
+				throw OutOfBoundsException(LOGGER_DETAIL_DEFAULT);
+			}
+			triangle[j] = mesh.vertices[mesh.indices[i + j]];
+			glm::vec3 magnitude = glm::abs(triangle[j]);
+			extent = std::max(extent, std::max(magnitude.x, std::max(magnitude.y, magnitude.z)));
+		}
+		triangles.push_back(triangle);
+	}
+	if (this->_options.fit && extent > 0.0f) {
+		// Pad the root so triangles on the boundary are not lost to rounding
+		pool.rootSize() = 2.0f * extent * 1.001f;
+	}
+	VoxelContext context {
+		.mesh = mesh,
+		.triangles = triangles,
+		.colored = mesh.colors.size() == mesh.vertices.size(),
+		.textured = mesh.texture != nullptr && mesh.uvs.size() == mesh.vertices.size()
+	};
+
+	// Bin the triangles by their bounds into the cells at the split depth, the jobs run the exact tests
+	const size_t split = std::min(this->_options.splitDepth, this->_options.depth - 1);
+	const int cellsPerAxis = 1 << split;
+	const float rootSize = pool.rootSize();
+	const float cellSize = rootSize / cellsPerAxis;
+	std::vector<std::vector<uint32_t>> cells(static_cast<size_t>(cellsPerAxis) * cellsPerAxis * cellsPerAxis);
+	for (uint32_t t = 0; t < triangles.size(); t++) {
+		glm::vec3 lower = glm::min(triangles[t][0], glm::min(triangles[t][1], triangles[t][2]));
+		glm::vec3 upper = glm::max(triangles[t][0], glm::max(triangles[t][1], triangles[t][2]));
+		if (glm::any(glm::lessThan(upper, glm::vec3(-rootSize / 2))) || glm::any(glm::greaterThan(lower, glm::vec3(rootSize / 2)))) {
+			continue;
+		}
+		glm::ivec3 first = glm::clamp(glm::ivec3(glm::floor((lower + rootSize / 2) / cellSize)), 0, cellsPerAxis - 1);
+		glm::ivec3 last = glm::clamp(glm::ivec3(glm::floor((upper + rootSize / 2) / cellSize)), 0, cellsPerAxis - 1);
+		for (int z = first.z; z <= last.z; z++) {
+			for (int y = first.y; y <= last.y; y++) {
+				for (int x = first.x; x <= last.x; x++) {
+					cells[x + cellsPerAxis * (y + cellsPerAxis * z)].push_back(t);
+				}
+			}
+		}
+	}
+
+	std::vector<std::vector<VoxelBlock>> blocks(cells.size());
+	std::vector<size_t> leaves(cells.size(), 0);
+	std::vector<size_t> occupied;
+	for (size_t cell = 0; cell < cells.size(); cell++) {
+		if (!cells[cell].empty()) {
+			occupied.push_back(cell);
+		}
+	}
+	this->_pool->runJobs(occupied.size(), [this, &context, &cells, &blocks, &leaves, &occupied, cellsPerAxis, cellSize, rootSize, split](size_t job) {
+		size_t cell = occupied[job];
+		glm::ivec3 coordinates(cell % cellsPerAxis, (cell / cellsPerAxis) % cellsPerAxis, cell / (cellsPerAxis * cellsPerAxis));
+		glm::vec3 center = (glm::vec3(coordinates) + 0.5f) * cellSize - rootSize / 2;
+		build(context, center, cellSize, this->_options.depth - split, cells[cell], blocks[cell], leaves[cell]);
+		if (leaves[cell] == 0) {
+			// Binned by bounds only, none of the triangles overlaps a leaf
+			blocks[cell].clear();
+		}
+	});
+
+	bool transaction = !pool.editing();
+	if (transaction) {
+		pool.begin();
+	}
+	// Walk the levels above the split depth in child index order, which is Morton order, and insert the subtrees
+	std::function<void(SparseVoxelNode, size_t, glm::ivec3, int)> descend;
+	descend = [&descend, &cells, &blocks, split, cellsPerAxis](SparseVoxelNode node, size_t level, glm::ivec3 origin, int span) {
+		if (level == split) {
+			size_t cell = origin.x + cellsPerAxis * (origin.y + cellsPerAxis * origin.z);
+			if (!blocks[cell].empty()) {
+				insert(node, blocks[cell], 0);
+			}
+			return;
+		}
+		int half = span / 2;
+		std::array<glm::ivec3, 8> origins;
+		std::array<bool, 8> occupied;
+		std::array<glm::vec4, 8> colors;
+		for (uint32_t i = 0; i < 8; i++) {
+			// Bit 0 selects the upper x half, bits 1 and 2 select the lower y and z halves
+			origins[i] = origin + glm::ivec3((i & 1) != 0 ? half : 0, (i & 2) != 0 ? 0 : half, (i & 4) != 0 ? 0 : half);
+			occupied[i] = false;
+			for (int z = 0; z < half && !occupied[i]; z++) {
+				for (int y = 0; y < half && !occupied[i]; y++) {
+					for (int x = 0; x < half && !occupied[i]; x++) {
+						auto cell = origins[i] + glm::ivec3(x, y, z);
+						occupied[i] = !blocks[cell.x + cellsPerAxis * (cell.y + cellsPerAxis * cell.z)].empty();
+					}
+				}
+			}
+			colors[i] = occupied[i] ? glm::vec4(0.0f, 0.0f, 0.0f, 1.0f) : glm::vec4(0.0f, 0.0f, 0.0f, 0.0f);
+		}
+		node.insertChildren(colors);
+		for (uint32_t i = 0; i < 8; i++) {
+			if (occupied[i]) {
+				descend(child(node, i), level + 1, origins[i], half);
+			}
+		}
+	};
+	descend(pool.root(), 0, glm::ivec3(0), cellsPerAxis);
+	if (transaction) {
+		pool.commit(*this->_pool);
+	}
+
+	size_t leafCount = 0;
+	for (size_t count : leaves) {
+		leafCount += count;
+	}
+	return VoxelizeStatistics {
+		.triangles = triangles.size(),
+		.leaves = leafCount,
+		.blocks = pool.blockCount(),
+		.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count()
+	};
+}
+
+rgle::gfx::VoxelizeOptions& rgle::gfx::Voxelizer::options()
+{
+	return this->_options;
+}
+
+const rgle::gfx::VoxelizeOptions& rgle::gfx::Voxelizer::options() const
+{
+	return this->_options;
+}
+
+rgle::gfx::PointCloudImporter::PointCloudImporter(PointCloudOptions options) : PointCloudImporter(std::make_shared<sync::ThreadPool>(), options)
+{
+}
+
+rgle::gfx::PointCloudImporter::PointCloudImporter(std::shared_ptr<sync::ThreadPool> pool, PointCloudOptions options) :
+	_pool(pool),
+	_options(options),
+	_streaming(false),
+	_rootSize(0.0f),
+	_depth(0),
+	_points(0)
+{
+	if (this->_pool == nullptr) {
+		throw NullPointerException(LOGGER_DETAIL_DEFAULT);
+	}
+}
+
+rgle::gfx::PointCloudStatistics rgle::gfx::PointCloudImporter::build(std::span<const glm::vec3> positions, std::span<const glm::vec4> colors, SparseVoxelPool& pool)
+{
+	if (!colors.empty() && colors.size() != positions.size()) {
+		throw IllegalArgumentException("point cloud requires no colors or one color per position", LOGGER_DETAIL_DEFAULT);
+	}
+	float rootSize = pool.rootSize();
+	if (this->_options.fit) {
+		float extent = 0.0f;
+		for (const auto& position : positions) {
+			glm::vec3 magnitude = glm::abs(position);
+			extent = std::max(extent, std::max(magnitude.x, std::max(magnitude.y, magnitude.z)));
+		}
+		if (extent > 0.0f) {
+			// Pad the root so points on the boundary are not lost to rounding
+			rootSize = 2.0f * extent * 1.001f;
+		}
+	}
+	this->begin(rootSize);
+	this->add(positions, colors);
+	return this->finish(pool);
+}
+
+void rgle::gfx::PointCloudImporter::begin(float rootSize)
+{
+	const size_t depth = this->_options.depth;
+	if (depth == 0 || depth > 21) {
+		throw IllegalArgumentException("point cloud depth must be between 1 and 21", LOGGER_DETAIL_DEFAULT);
+	}
+	if (this->_options.chunkSize == 0) {
+		throw IllegalArgumentException("point cloud chunk size must be positive", LOGGER_DETAIL_DEFAULT);
+	}
+	if (!(rootSize > 0.0f)) {
+		throw IllegalArgumentException("point cloud root size must be positive", LOGGER_DETAIL_DEFAULT);
+	}
+	this->_streaming = true;
+	this->_rootSize = rootSize;
+	this->_depth = depth;
+	this->_points = 0;
+	this->_start = std::chrono::steady_clock::now();
+	this->_runs.clear();
+}
+
+void rgle::gfx::PointCloudImporter::add(std::span<const glm::vec3> positions, std::span<const glm::vec4> colors)
+{
+	if (!this->_streaming) {
+		throw InvalidStateException("point cloud stream must begin before adding points", LOGGER_DETAIL_DEFAULT);
+	}
+	if (!colors.empty() && colors.size() != positions.size()) {
+		throw IllegalArgumentException("point cloud requires no colors or one color per position", LOGGER_DETAIL_DEFAULT);
+	}
+	const size_t depth = this->_depth;
+	const float rootSize = this->_rootSize;
+	const uint32_t flip = (uint32_t(1) << depth) - 1;
+	// Points outside the root get the bit above the leaf codes, so they sort last and are dropped
+	const uint64_t OUTSIDE = uint64_t(1) << (3 * depth);
+	const size_t chunkSize = std::min(this->_options.chunkSize, positions.size());
+	const size_t JOB_SIZE = 1 << 16;
+
+	std::vector<MortonPoint> points;
+	std::vector<MortonPoint> scratch;
+	for (size_t offset = 0; offset < positions.size(); offset += chunkSize) {
+		size_t count = std::min(chunkSize, positions.size() - offset);
+		points.resize(count);
+		this->_pool->runJobs((count + JOB_SIZE - 1) / JOB_SIZE, [&points, &positions, offset, count, rootSize, depth, flip, OUTSIDE, JOB_SIZE](size_t job) {
+			size_t last = std::min(count, (job + 1) * JOB_SIZE);
+			for (size_t i = job * JOB_SIZE; i < last; i++) {
+				const glm::vec3& position = positions[offset + i];
+				uint32_t x = point_cell(position.x, rootSize, depth);
+				uint32_t y = point_cell(position.y, rootSize, depth);
+				uint32_t z = point_cell(position.z, rootSize, depth);
+				uint64_t code = OUTSIDE;
+				if (x != NO_BLOCK && y != NO_BLOCK && z != NO_BLOCK) {
+					// Child indices select the lower y and z halves with their set bits, so the cells count down along y and z
+					code = math::morton::encode_3d(x, flip - y, flip - z);
+				}
+				points[i] = MortonPoint{ code, static_cast<uint32_t>(i) };
+			}
+		});
+		radix_sort(points, scratch, 3 * depth + 1, *this->_pool);
+
+		std::vector<PointCloudLeaf> run;
+		for (const auto& point : points) {
+			if (point.code == OUTSIDE) {
+				break;
+			}
+			glm::vec4 color = colors.empty() ? glm::vec4(1.0f, 1.0f, 1.0f, 1.0f) : colors[offset + point.index];
+			if (!run.empty() && run.back().code == point.code) {
+				run.back().sum += color;
+				run.back().count++;
+			}
+			else {
+				run.push_back(PointCloudLeaf{ point.code, color, 1 });
+			}
+		}
+		this->_points += count;
+		if (!run.empty()) {
+			this->_runs.push_back(std::move(run));
+			this->_merge(false);
+		}
+	}
+}
+
+rgle::gfx::PointCloudStatistics rgle::gfx::PointCloudImporter::finish(SparseVoxelPool& pool)
+{
+	if (!this->_streaming) {
+		throw InvalidStateException("point cloud stream must begin before finishing", LOGGER_DETAIL_DEFAULT);
+	}
+	if (!pool.root().leaf()) {
+		throw IllegalArgumentException("point cloud root must be a leaf", LOGGER_DETAIL_DEFAULT);
+	}
+	this->_streaming = false;
+	const size_t depth = this->_depth;
+	this->_merge(true);
+	std::vector<PointCloudLeaf> leaves;
+	if (!this->_runs.empty()) {
+		leaves = std::move(this->_runs.back());
+	}
+	this->_runs = std::vector<std::vector<PointCloudLeaf>>();
+	pool.rootSize() = this->_rootSize;
+
+	// Sorted unique codes of every level, each level is one sweep over the level below
+	std::vector<std::vector<uint64_t>> levels(depth + 1);
+	levels[depth].reserve(leaves.size());
+	for (const auto& leaf : leaves) {
+		levels[depth].push_back(leaf.code);
+	}
+	for (size_t level = depth; level-- > 0;) {
+		for (uint64_t code : levels[level + 1]) {
+			if (levels[level].empty() || levels[level].back() != (code >> 3)) {
+				levels[level].push_back(code >> 3);
+			}
+		}
+	}
+
+	if (!leaves.empty()) {
+		bool transaction = !pool.editing();
+		if (transaction) {
+			pool.begin();
+		}
+		std::vector<size_t> cursors(depth + 1, 0);
+		insert_points(pool.root(), 0, 0, levels, leaves, cursors);
+		if (transaction) {
+			pool.commit(*this->_pool);
+		}
+	}
+
+	return PointCloudStatistics {
+		.points = this->_points,
+		.leaves = leaves.size(),
+		.blocks = pool.blockCount(),
+		.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - this->_start).count()
+	};
+}
+
+rgle::gfx::PointCloudOptions& rgle::gfx::PointCloudImporter::options()
+{
+	return this->_options;
+}
+
+const rgle::gfx::PointCloudOptions& rgle::gfx::PointCloudImporter::options() const
+{
+	return this->_options;
+}
+
+void rgle::gfx::PointCloudImporter::_merge(bool all)
+{
+	// Merging a run only into runs at most twice its length keeps the merged length of every leaf logarithmic
+	std::vector<PointCloudLeaf> merged;
+	while (this->_runs.size() > 1) {
+		auto& last = this->_runs[this->_runs.size() - 1];
+		auto& previous = this->_runs[this->_runs.size() - 2];
+		if (!all && previous.size() > 2 * last.size()) {
+			break;
+		}
+		merge_leaves(previous, last, merged);
+		this->_runs.pop_back();
+		std::swap(this->_runs.back(), merged);
+	}
+}
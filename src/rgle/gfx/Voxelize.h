@@ -0,0 +1,126 @@
+#pragma once
+
+#include "rgle/gfx/Spatial.h"
+#include "rgle/sync/Thread.h"
+
+namespace rgle::gfx {
+
+	// Triangle soup and optional per vertex attributes voxelized by a Voxelizer
+	struct VoxelMesh {
+		std::vector<glm::vec3> vertices;
+		std::vector<uint32_t> indices;
+		// Per vertex colors, ignored unless there is one per vertex
+		std::vector<glm::vec4> colors;
+		// Per vertex texture coordinates, ignored unless there is one per vertex and a texture
+		std::vector<glm::vec2> uvs;
+		// 8 bit texture sampled with nearest filtering and repeat wrapping, modulated by the vertex colors
+		std::shared_ptr<Image> texture;
+	};
+
+	struct VoxelizeOptions {
+		// Depth of the leaves, the root is split into 2^depth voxels along each axis
+		size_t depth = 8;
+		// Depth of the subtrees voxelized as one job on the thread pool
+		size_t splitDepth = 3;
+		// Scales the root to enclose the mesh, otherwise the current root size is kept and the mesh is clipped
+		bool fit = true;
+	};
+
+	struct VoxelizeStatistics {
+		size_t triangles = 0;
+		size_t leaves = 0;
+		size_t blocks = 0;
+		double seconds = 0.0;
+	};
+
+	// Builds the nodes of a SparseVoxelPool overlapped by the triangles of a mesh
+	// @remarks
+	// Triangles are binned by their bounds into the subtrees at splitDepth, every subtree then descends on the thread
+	// pool with exact triangle/box overlap tests. The subtrees are inserted in Morton order within one edit transaction,
+	// so each subtree occupies a contiguous range of blocks. Leaf colors average the attributes of the overlapping
+	// triangles at the point closest to the leaf center
+	class Voxelizer {
+	public:
+		Voxelizer(VoxelizeOptions options = VoxelizeOptions{});
+		Voxelizer(std::shared_ptr<sync::ThreadPool> pool, VoxelizeOptions options = VoxelizeOptions{});
+
+		// Voxelizes into the root of pool, which must be a leaf
+		// @note the model matrix of the geometry is not applied, the first enabled sampler with a CPU image is used
+		VoxelizeStatistics voxelize(const Geometry3D& geometry, SparseVoxelPool& pool) const;
+		VoxelizeStatistics voxelize(const VoxelMesh& mesh, SparseVoxelPool& pool) const;
+
+		VoxelizeOptions& options();
+		const VoxelizeOptions& options() const;
+
+	private:
+		std::shared_ptr<sync::ThreadPool> _pool;
+		VoxelizeOptions _options;
+	};
+
+	struct PointCloudOptions {
+		// Depth of the leaves, at most 21 so the leaf coordinates fit a 3D Morton code
+		size_t depth = 10;
+		// Points quantized and sorted at once, bounds the memory of the sort whatever the size of the cloud
+		size_t chunkSize = size_t(1) << 22;
+		// Scales the root to enclose the points, otherwise the current root size is kept and outside points are dropped
+		bool fit = true;
+	};
+
+	struct PointCloudStatistics {
+		size_t points = 0;
+		size_t leaves = 0;
+		size_t blocks = 0;
+		double seconds = 0.0;
+	};
+
+	// Color sum of the points of one occupied leaf, keyed by the Morton code of the leaf
+	struct PointCloudLeaf {
+		uint64_t code;
+		glm::vec4 sum;
+		uint32_t count;
+	};
+
+	// Builds the nodes of a SparseVoxelPool from colored points
+	// @remarks
+	// Points are streamed in with add(), each chunk of points is quantized to the Morton codes of its leaves, radix
+	// sorted on the thread pool and reduced to a sorted run of color sums per occupied leaf. Runs of similar length are
+	// merged as they arrive, so the importer only holds the occupied leaves however many points are streamed. finish()
+	// merges the remaining runs, derives the levels above bottom-up by one sweep per level over the sorted codes, then
+	// inserts the blocks depth first within one edit transaction whose commit blends the inner colors
+	class PointCloudImporter {
+	public:
+		PointCloudImporter(PointCloudOptions options = PointCloudOptions{});
+		PointCloudImporter(std::shared_ptr<sync::ThreadPool> pool, PointCloudOptions options = PointCloudOptions{});
+
+		// Inserts the points into the root of pool, which must be a leaf, leaf colors average the colors of their points
+		// @note colors may be empty for white points, otherwise there must be one per position
+		PointCloudStatistics build(std::span<const glm::vec3> positions, std::span<const glm::vec4> colors, SparseVoxelPool& pool);
+
+		// Starts streaming points quantized against a root of the given size, discarding the points of a previous stream
+		// @note the fit option does not apply to streams, the extent of the points must be known up front
+		void begin(float rootSize);
+		// Adds a chunk of points to the stream, the spans are not referenced after the call returns
+		// @note colors may be empty for white points, otherwise there must be one per position
+		void add(std::span<const glm::vec3> positions, std::span<const glm::vec4> colors);
+		// Inserts the streamed points into the root of pool, which must be a leaf, and sets its root size
+		PointCloudStatistics finish(SparseVoxelPool& pool);
+
+		PointCloudOptions& options();
+		const PointCloudOptions& options() const;
+
+	private:
+		// Merges the last runs while they are of similar length, or all of them
+		void _merge(bool all);
+
+		std::shared_ptr<sync::ThreadPool> _pool;
+		PointCloudOptions _options;
+
+		bool _streaming;
+		float _rootSize;
+		size_t _depth;
+		size_t _points;
+		std::chrono::steady_clock::time_point _start;
+		// Sorted leaf runs, each at most half the length of the run before it once merged
+		std::vector<std::vector<PointCloudLeaf>> _runs;
+	};
+}
@@ -0,0 +1,58 @@
+#include "rgle/math/Morton.h"
+
+namespace {
+  uint32_t spread_2d(uint32_t v) {
+    v &= 0x0000ffff;
+    v = (v | (v << 8)) & 0x00ff00ff;
+    v = (v | (v << 4)) & 0x0f0f0f0f;
+    v = (v | (v << 2)) & 0x33333333;
+    v = (v | (v << 1)) & 0x55555555;
+    return v;
+  }
+
+  uint64_t spread_3d(uint64_t v) {
+    v &= 0x1fffff;
+    v = (v | (v << 32)) & 0x1f00000000ffffull;
+    v = (v | (v << 16)) & 0x1f0000ff0000ffull;
+    v = (v | (v << 8)) & 0x100f00f00f00f00full;
+    v = (v | (v << 4)) & 0x10c30c30c30c30c3ull;
+    v = (v | (v << 2)) & 0x1249249249249249ull;
+    return v;
+  }
+}
+
+uint32_t rgle::math::morton::encode_2d(uint32_t x, uint32_t y) {
+  return spread_2d(x) | (spread_2d(y) << 1);
+}
+
+uint64_t rgle::math::morton::encode_3d(uint32_t x, uint32_t y, uint32_t z) {
+  return spread_3d(x) | (spread_3d(y) << 1) | (spread_3d(z) << 2);
+}
+
+uint64_t rgle::math::morton::encode(std::span<const uint32_t> coordinates, size_t bits) {
+  if (coordinates.size() * bits > 64) {
+    throw IllegalArgumentException("morton code does not fit in 64 bits", LOGGER_DETAIL_DEFAULT);
+  }
+  uint64_t code = 0;
+  for (size_t bit = 0; bit < bits; bit++) {
+    for (size_t i = 0; i < coordinates.size(); i++) {
+      code |= static_cast<uint64_t>((coordinates[i] >> bit) & 1) << (bit * coordinates.size() + i);
+    }
+  }
+  return code;
+}
+
+uint32_t rgle::math::morton::quantize(float value, float lower, float upper, size_t bits) {
+  if (bits > 24) {
+    throw IllegalArgumentException("morton quantization is limited to 24 bits", LOGGER_DETAIL_DEFAULT);
+  }
+  const float cells = static_cast<float>((1ull << bits) - 1);
+  if (!(upper > lower)) {
+    return 0;
+  }
+  float scaled = (value - lower) / (upper - lower) * cells;
+  if (!(scaled > 0.0f)) {
+    return 0;
+  }
+  return static_cast<uint32_t>(std::clamp(scaled, 0.0f, cells));
+}
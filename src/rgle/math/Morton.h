@@ -0,0 +1,19 @@
+#pragma once
+
+#include "rgle/Exception.h"
+
+namespace rgle::math {
+  namespace morton {
+    // Interleaves the low 16 bits of x and y, sorting by the code walks the plane in Z-order
+    uint32_t encode_2d(uint32_t x, uint32_t y);
+
+    // Interleaves the low 21 bits of x, y and z
+    uint64_t encode_3d(uint32_t x, uint32_t y, uint32_t z);
+
+    // Interleaves the low bits of each coordinate, coordinates.size() * bits must not exceed 64
+    uint64_t encode(std::span<const uint32_t> coordinates, size_t bits);
+
+    // Maps value in [lower, upper] onto an unsigned grid coordinate of at most 24 bits, clamping outside values
+    uint32_t quantize(float value, float lower, float upper, size_t bits);
+  }
+}
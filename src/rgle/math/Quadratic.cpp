@@ -1,4 +1,5 @@
 #include "rgle/math/Quadratic.h"
+#include "rgle/math/Simd.h"
 
 rgle::math::quadratic::Roots rgle::math::quadratic::compute_roots(float a, float b, float c) {
   float discriminant = b * b - 4 * a * c;
@@ -15,3 +16,24 @@ rgle::math::quadratic::Roots rgle::math::quadratic::compute_roots(float a, float
   }
   return Roots(None {});
 }
+
+namespace {
+  template<typename V>
+  void compute_roots_batch(const float* a, const float* b, const float* c, float* x0, float* x1, int32_t* count, size_t n) {
+    V r0, r1;
+    typename V::Mask two, one;
+    for (size_t i = 0; i < n; i += V::WIDTH) {
+      rgle::math::quadratic::compute_roots(V::load(a + i), V::load(b + i), V::load(c + i), r0, r1, two, one);
+      r0.store(x0 + i);
+      r1.store(x1 + i);
+      rgle::math::simd::store_count(count + i, two, one);
+    }
+  }
+}
+
+void rgle::math::quadratic::compute_roots(const float* a, const float* b, const float* c, float* x0, float* x1, int32_t* count, size_t n) {
+  using Lanes = simd::Lanes<8>;
+  size_t vectorized = n - n % Lanes::WIDTH;
+  compute_roots_batch<Lanes>(a, b, c, x0, x1, count, vectorized);
+  compute_roots_batch<simd::Scalar>(a + vectorized, b + vectorized, c + vectorized, x0 + vectorized, x1 + vectorized, count + vectorized, n - vectorized);
+}
@@ -15,6 +15,25 @@ namespace rgle::math {
     using Roots = std::variant<None, One, Two>;
 
     Roots compute_roots(float a, float b, float c);
+
+    // Lane generic form of compute_roots, V is one of the math::simd lane types
+    // @note performs the same operations as compute_roots so every lane agrees with it bit for bit, x0 holds the
+    // root of a lane with one root (x1 is set equal to it) and both are undefined for lanes without roots
+    template<typename V>
+    void compute_roots(const V& a, const V& b, const V& c, V& x0, V& x1, typename V::Mask& two, typename V::Mask& one) {
+      V discriminant = b * b - V::broadcast(4.0f) * a * c;
+      V root = sqrt(discriminant);
+      V denominator = V::broadcast(2.0f) * a;
+      V single = -b / denominator;
+      two = discriminant > V::broadcast(0.0f);
+      one = discriminant == V::broadcast(0.0f);
+      x0 = select(two, (-b + root) / denominator, single);
+      x1 = select(two, (-b - root) / denominator, single);
+    }
+
+    // Computes the roots of n quadratics given as structure of arrays coefficients
+    // @param count receives the number of roots of each quadratic (0, 1 or 2)
+    void compute_roots(const float* a, const float* b, const float* c, float* x0, float* x1, int32_t* count, size_t n);
   }
   
 }
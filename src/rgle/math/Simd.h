@@ -0,0 +1,128 @@
+#pragma once
+
+#include "rgle/Exception.h"
+
+#if defined __AVX2__
+	#define RGLE_SIMD_AVX2
+#endif
+#if defined __SSE2__ || defined _M_X64 || (defined _M_IX86_FP && _M_IX86_FP >= 2)
+	#define RGLE_SIMD_SSE
+#endif
+
+#if defined RGLE_SIMD_SSE || defined RGLE_SIMD_AVX2
+	#include <immintrin.h>
+#endif
+
+// Thin lane wrappers used to write a kernel once and run it scalar, 4 wide (SSE) or 8 wide (AVX2)
+// @note every wrapper performs the same IEEE operations in the same order so results are bit identical between widths,
+// this relies on the compiler not contracting multiplies and adds into fused multiply adds (-ffp-contract=off)
+// @note comparisons are ordered except for != which, like the scalar operator, is true for NaN
+namespace rgle::math::simd {
+
+	struct Scalar {
+		using Mask = bool;
+		static constexpr size_t WIDTH = 1;
+
+		static Scalar load(const float* data) { return Scalar{ *data }; }
+		static Scalar broadcast(float value) { return Scalar{ value }; }
+		void store(float* data) const { *data = this->v; }
+
+		float v;
+	};
+
+	inline Scalar operator+(Scalar a, Scalar b) { return Scalar{ a.v + b.v }; }
+	inline Scalar operator-(Scalar a, Scalar b) { return Scalar{ a.v - b.v }; }
+	inline Scalar operator*(Scalar a, Scalar b) { return Scalar{ a.v * b.v }; }
+	inline Scalar operator/(Scalar a, Scalar b) { return Scalar{ a.v / b.v }; }
+	inline Scalar operator-(Scalar a) { return Scalar{ -a.v }; }
+	inline Scalar sqrt(Scalar a) { return Scalar{ std::sqrt(a.v) }; }
+	inline bool operator>(Scalar a, Scalar b) { return a.v > b.v; }
+	inline bool operator<(Scalar a, Scalar b) { return a.v < b.v; }
+	inline bool operator>=(Scalar a, Scalar b) { return a.v >= b.v; }
+	inline bool operator==(Scalar a, Scalar b) { return a.v == b.v; }
+	inline bool operator!=(Scalar a, Scalar b) { return a.v != b.v; }
+	inline Scalar select(bool mask, Scalar a, Scalar b) { return mask ? a : b; }
+	inline void store_count(int32_t* data, bool two, bool one) { *data = two ? 2 : (one ? 1 : 0); }
+
+#ifdef RGLE_SIMD_SSE
+	struct Sse {
+		using Mask = Sse;
+		static constexpr size_t WIDTH = 4;
+
+		static Sse load(const float* data) { return Sse{ _mm_loadu_ps(data) }; }
+		static Sse broadcast(float value) { return Sse{ _mm_set1_ps(value) }; }
+		void store(float* data) const { _mm_storeu_ps(data, this->v); }
+
+		__m128 v;
+	};
+
+	inline Sse operator+(Sse a, Sse b) { return Sse{ _mm_add_ps(a.v, b.v) }; }
+	inline Sse operator-(Sse a, Sse b) { return Sse{ _mm_sub_ps(a.v, b.v) }; }
+	inline Sse operator*(Sse a, Sse b) { return Sse{ _mm_mul_ps(a.v, b.v) }; }
+	inline Sse operator/(Sse a, Sse b) { return Sse{ _mm_div_ps(a.v, b.v) }; }
+	inline Sse operator-(Sse a) { return Sse{ _mm_xor_ps(a.v, _mm_set1_ps(-0.0f)) }; }
+	inline Sse operator&(Sse a, Sse b) { return Sse{ _mm_and_ps(a.v, b.v) }; }
+	inline Sse operator|(Sse a, Sse b) { return Sse{ _mm_or_ps(a.v, b.v) }; }
+	inline Sse sqrt(Sse a) { return Sse{ _mm_sqrt_ps(a.v) }; }
+	inline Sse operator>(Sse a, Sse b) { return Sse{ _mm_cmpgt_ps(a.v, b.v) }; }
+	inline Sse operator<(Sse a, Sse b) { return Sse{ _mm_cmplt_ps(a.v, b.v) }; }
+	inline Sse operator>=(Sse a, Sse b) { return Sse{ _mm_cmpge_ps(a.v, b.v) }; }
+	inline Sse operator==(Sse a, Sse b) { return Sse{ _mm_cmpeq_ps(a.v, b.v) }; }
+	inline Sse operator!=(Sse a, Sse b) { return Sse{ _mm_cmpneq_ps(a.v, b.v) }; }
+	inline Sse select(Sse mask, Sse a, Sse b) { return Sse{ _mm_or_ps(_mm_and_ps(mask.v, a.v), _mm_andnot_ps(mask.v, b.v)) }; }
+	inline void store_count(int32_t* data, Sse two, Sse one) {
+		__m128i count = _mm_or_si128(
+			_mm_and_si128(_mm_castps_si128(two.v), _mm_set1_epi32(2)),
+			_mm_and_si128(_mm_andnot_si128(_mm_castps_si128(two.v), _mm_castps_si128(one.v)), _mm_set1_epi32(1))
+		);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(data), count);
+	}
+#endif
+
+#ifdef RGLE_SIMD_AVX2
+	struct Avx {
+		using Mask = Avx;
+		static constexpr size_t WIDTH = 8;
+
+		static Avx load(const float* data) { return Avx{ _mm256_loadu_ps(data) }; }
+		static Avx broadcast(float value) { return Avx{ _mm256_set1_ps(value) }; }
+		void store(float* data) const { _mm256_storeu_ps(data, this->v); }
+
+		__m256 v;
+	};
+
+	inline Avx operator+(Avx a, Avx b) { return Avx{ _mm256_add_ps(a.v, b.v) }; }
+	inline Avx operator-(Avx a, Avx b) { return Avx{ _mm256_sub_ps(a.v, b.v) }; }
+	inline Avx operator*(Avx a, Avx b) { return Avx{ _mm256_mul_ps(a.v, b.v) }; }
+	inline Avx operator/(Avx a, Avx b) { return Avx{ _mm256_div_ps(a.v, b.v) }; }
+	inline Avx operator-(Avx a) { return Avx{ _mm256_xor_ps(a.v, _mm256_set1_ps(-0.0f)) }; }
+	inline Avx operator&(Avx a, Avx b) { return Avx{ _mm256_and_ps(a.v, b.v) }; }
+	inline Avx operator|(Avx a, Avx b) { return Avx{ _mm256_or_ps(a.v, b.v) }; }
+	inline Avx sqrt(Avx a) { return Avx{ _mm256_sqrt_ps(a.v) }; }
+	inline Avx operator>(Avx a, Avx b) { return Avx{ _mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ) }; }
+	inline Avx operator<(Avx a, Avx b) { return Avx{ _mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ) }; }
+	inline Avx operator>=(Avx a, Avx b) { return Avx{ _mm256_cmp_ps(a.v, b.v, _CMP_GE_OQ) }; }
+	inline Avx operator==(Avx a, Avx b) { return Avx{ _mm256_cmp_ps(a.v, b.v, _CMP_EQ_OQ) }; }
+	inline Avx operator!=(Avx a, Avx b) { return Avx{ _mm256_cmp_ps(a.v, b.v, _CMP_NEQ_UQ) }; }
+	inline Avx select(Avx mask, Avx a, Avx b) { return Avx{ _mm256_blendv_ps(b.v, a.v, mask.v) }; }
+	inline void store_count(int32_t* data, Avx two, Avx one) {
+		__m256i count = _mm256_or_si256(
+			_mm256_and_si256(_mm256_castps_si256(two.v), _mm256_set1_epi32(2)),
+			_mm256_and_si256(_mm256_andnot_si256(_mm256_castps_si256(two.v), _mm256_castps_si256(one.v)), _mm256_set1_epi32(1))
+		);
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(data), count);
+	}
+#endif
+
+	// Widest lane type available for a batch of the given size
+#if defined RGLE_SIMD_AVX2
+	template<size_t N>
+	using Lanes = std::conditional_t<N % Avx::WIDTH == 0, Avx, std::conditional_t<N % Sse::WIDTH == 0, Sse, Scalar>>;
+#elif defined RGLE_SIMD_SSE
+	template<size_t N>
+	using Lanes = std::conditional_t<N % Sse::WIDTH == 0, Sse, Scalar>;
+#else
+	template<size_t N>
+	using Lanes = Scalar;
+#endif
+}
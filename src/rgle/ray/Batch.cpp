@@ -0,0 +1,226 @@
+#include "rgle/ray/Raycast.h"
+#include "rgle/math/Morton.h"
+#include "rgle/sync/Thread.h"
+
+namespace {
+	// Bits per coordinate of the six dimensional Morton code of a ray
+	const size_t MORTON_BITS = 10;
+	// Rays per job when a batch is intersected on a thread pool
+	const size_t CHUNK_SIZE = 4096;
+
+	// Orders rays by the Morton code of their eye, quantized in the bounds of the batch, interleaved with their direction
+	std::vector<uint32_t> morton_order(std::span<const rgle::ray::Ray> rays) {
+		using namespace rgle::math;
+		auto bounds = rgle::ray::Bounds::empty();
+		for (const auto& ray : rays) {
+			bounds = bounds.merge(ray.eye);
+		}
+		std::vector<std::pair<uint64_t, uint32_t>> keys(rays.size());
+		for (size_t i = 0; i < rays.size(); i++) {
+			auto direction = rays[i].delta();
+			float length = glm::length(direction);
+			if (length > 0.0f) {
+				direction /= length;
+			}
+			std::array<uint32_t, 6> coordinates = {
+				morton::quantize(rays[i].eye.x, bounds.lower.x, bounds.upper.x, MORTON_BITS),
+				morton::quantize(rays[i].eye.y, bounds.lower.y, bounds.upper.y, MORTON_BITS),
+				morton::quantize(rays[i].eye.z, bounds.lower.z, bounds.upper.z, MORTON_BITS),
+				morton::quantize(direction.x, -1.0f, 1.0f, MORTON_BITS),
+				morton::quantize(direction.y, -1.0f, 1.0f, MORTON_BITS),
+				morton::quantize(direction.z, -1.0f, 1.0f, MORTON_BITS)
+			};
+			keys[i] = { morton::encode(coordinates, MORTON_BITS), static_cast<uint32_t>(i) };
+		}
+		std::sort(keys.begin(), keys.end());
+		std::vector<uint32_t> order(rays.size());
+		for (size_t i = 0; i < keys.size(); i++) {
+			order[i] = keys[i].second;
+		}
+		return order;
+	}
+}
+
+void rgle::ray::Model::intersect(std::span<const Ray> rays, std::span<std::optional<Intersection>> results) const
+{
+	if (rays.size() != results.size()) {
+		throw IllegalArgumentException("ray batch and result batch sizes differ", LOGGER_DETAIL_DEFAULT);
+	}
+	auto order = morton_order(rays);
+	std::vector<Ray> sorted(rays.size());
+	for (size_t i = 0; i < order.size(); i++) {
+		sorted[i] = rays[order[i]];
+	}
+	std::vector<std::optional<Intersection>> sortedResults(rays.size());
+	this->_intersectBatch(sorted, sortedResults);
+	for (size_t i = 0; i < order.size(); i++) {
+		results[order[i]] = std::move(sortedResults[i]);
+	}
+}
+
+void rgle::ray::Model::intersect(std::span<const Ray> rays, std::span<std::optional<Intersection>> results, sync::ThreadPool& pool) const
+{
+	if (rays.size() != results.size()) {
+		throw IllegalArgumentException("ray batch and result batch sizes differ", LOGGER_DETAIL_DEFAULT);
+	}
+	auto order = morton_order(rays);
+	std::vector<Ray> sorted(rays.size());
+	for (size_t i = 0; i < order.size(); i++) {
+		sorted[i] = rays[order[i]];
+	}
+	std::vector<std::optional<Intersection>> sortedResults(rays.size());
+	pool.runJobs((rays.size() + CHUNK_SIZE - 1) / CHUNK_SIZE, [this, &sorted, &sortedResults](size_t chunk) {
+		size_t begin = chunk * CHUNK_SIZE;
+		size_t count = std::min(CHUNK_SIZE, sorted.size() - begin);
+		this->_intersectBatch(
+			std::span<const Ray>(sorted).subspan(begin, count),
+			std::span<std::optional<Intersection>>(sortedResults).subspan(begin, count)
+		);
+	});
+	for (size_t i = 0; i < order.size(); i++) {
+		results[order[i]] = std::move(sortedResults[i]);
+	}
+}
+
+void rgle::ray::Model::_intersectBatch(std::span<const Ray> rays, std::span<std::optional<Intersection>> results) const
+{
+	if (!this->cachedBounds) {
+		this->_evaluateBatch(rays, results);
+		return;
+	}
+	std::vector<uint32_t> active;
+	std::vector<Ray> compacted;
+	for (size_t i = 0; i < rays.size(); i++) {
+		if (this->_reachable(rays[i], std::numeric_limits<float>::infinity())) {
+			active.push_back(static_cast<uint32_t>(i));
+			compacted.push_back(rays[i]);
+		}
+	}
+	if (active.size() == rays.size()) {
+		this->_evaluateBatch(rays, results);
+		return;
+	}
+	std::fill(results.begin(), results.end(), std::nullopt);
+	if (active.empty()) {
+		return;
+	}
+	std::vector<std::optional<Intersection>> compactedResults(active.size());
+	this->_evaluateBatch(compacted, compactedResults);
+	for (size_t j = 0; j < active.size(); j++) {
+		results[active[j]] = std::move(compactedResults[j]);
+	}
+}
+
+void rgle::ray::Model::_evaluateBatch(std::span<const Ray> rays, std::span<std::optional<Intersection>> results) const
+{
+	if (auto val = std::get_if<Object>(this)) {
+		for (size_t i = 0; i < rays.size(); i++) {
+			results[i] = val->object->intersect(rays[i]).closest();
+		}
+	}
+	else if (auto val = std::get_if<Scene>(this)) {
+		if (val->hierarchy) {
+			for (size_t i = 0; i < rays.size(); i++) {
+				results[i] = this->_intersect(rays[i], std::numeric_limits<float>::infinity());
+			}
+			return;
+		}
+		std::fill(results.begin(), results.end(), std::nullopt);
+		std::vector<uint32_t> active;
+		std::vector<Ray> compacted;
+		std::vector<std::optional<Intersection>> childResults;
+		active.reserve(rays.size());
+		compacted.reserve(rays.size());
+		for (const auto& model : val->scene) {
+			// Optimized children cull the batch against their cached bounds themselves
+			auto bounds = model.cachedBounds ? Bounds::infinite() : model.bounds();
+			if (bounds.isEmpty()) {
+				continue;
+			}
+			active.clear();
+			compacted.clear();
+			if (bounds.isBounded()) {
+				bounds = bounds.padRelative();
+				for (size_t i = 0; i < rays.size(); i++) {
+					if (bounds.clip(rays[i].eye, rays[i].delta())) {
+						active.push_back(static_cast<uint32_t>(i));
+						compacted.push_back(rays[i]);
+					}
+				}
+			}
+			else {
+				for (size_t i = 0; i < rays.size(); i++) {
+					active.push_back(static_cast<uint32_t>(i));
+				}
+				compacted.assign(rays.begin(), rays.end());
+			}
+			if (active.empty()) {
+				continue;
+			}
+			childResults.resize(active.size());
+			model._intersectBatch(compacted, childResults);
+			for (size_t j = 0; j < active.size(); j++) {
+				auto& closest = results[active[j]];
+				if (childResults[j] && (!closest.has_value() || childResults[j]->distance(rays[active[j]]) < closest->distance(rays[active[j]]))) {
+					closest = std::move(childResults[j]);
+				}
+			}
+		}
+	}
+	else if (auto val = std::get_if<Transform>(this)) {
+		std::vector<Ray> transformed(rays.size());
+		for (size_t i = 0; i < rays.size(); i++) {
+			transformed[i] = val->transform.applyForward(rays[i]);
+		}
+		val->model->_intersectBatch(transformed, results);
+		for (auto& result : results) {
+			if (result) {
+				result = val->transform.applyBackward(*result);
+			}
+		}
+	}
+	else if (auto val = std::get_if<Clip>(this)) {
+		val->model->_intersectBatch(rays, results);
+		for (auto& result : results) {
+			if (result && !std::holds_alternative<Inside>(val->clipPlane.clip(result->position))) {
+				result = std::nullopt;
+			}
+		}
+	}
+	else if (auto val = std::get_if<And>(this)) {
+		val->lhs->_intersectBatch(rays, results);
+		// Only rays which hit the lhs can hit the intersection
+		std::vector<uint32_t> active;
+		std::vector<Ray> compacted;
+		for (size_t i = 0; i < rays.size(); i++) {
+			if (results[i]) {
+				active.push_back(static_cast<uint32_t>(i));
+				compacted.push_back(rays[i]);
+			}
+		}
+		if (active.empty()) {
+			return;
+		}
+		std::vector<std::optional<Intersection>> rhsResults(active.size());
+		val->rhs->_intersectBatch(compacted, rhsResults);
+		for (size_t j = 0; j < active.size(); j++) {
+			auto& result = results[active[j]];
+			if (!rhsResults[j]) {
+				result = std::nullopt;
+			}
+			else if (!(result->distance(rays[active[j]]) < rhsResults[j]->distance(rays[active[j]]))) {
+				result = std::move(rhsResults[j]);
+			}
+		}
+	}
+	else if (auto val = std::get_if<Or>(this)) {
+		val->lhs->_intersectBatch(rays, results);
+		std::vector<std::optional<Intersection>> rhsResults(rays.size());
+		val->rhs->_intersectBatch(rays, rhsResults);
+		for (size_t i = 0; i < rays.size(); i++) {
+			if (rhsResults[i] && (!results[i] || !(results[i]->distance(rays[i]) < rhsResults[i]->distance(rays[i])))) {
+				results[i] = std::move(rhsResults[i]);
+			}
+		}
+	}
+}
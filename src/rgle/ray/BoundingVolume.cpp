@@ -0,0 +1,433 @@
+#include "rgle/ray/BoundingVolume.h"
+
+const size_t rgle::ray::BoundingVolumeHierarchy::MAX_DEPTH = 63;
+
+rgle::ray::Bounds rgle::ray::Bounds::empty()
+{
+	const float inf = std::numeric_limits<float>::infinity();
+	return Bounds {
+		.lower = glm::vec3(inf, inf, inf),
+		.upper = glm::vec3(-inf, -inf, -inf)
+	};
+}
+
+rgle::ray::Bounds rgle::ray::Bounds::infinite()
+{
+	const float inf = std::numeric_limits<float>::infinity();
+	return Bounds {
+		.lower = glm::vec3(-inf, -inf, -inf),
+		.upper = glm::vec3(inf, inf, inf)
+	};
+}
+
+bool rgle::ray::Bounds::isEmpty() const
+{
+	return this->lower.x > this->upper.x || this->lower.y > this->upper.y || this->lower.z > this->upper.z;
+}
+
+bool rgle::ray::Bounds::isBounded() const
+{
+	return std::isfinite(this->lower.x) && std::isfinite(this->lower.y) && std::isfinite(this->lower.z) &&
+		std::isfinite(this->upper.x) && std::isfinite(this->upper.y) && std::isfinite(this->upper.z);
+}
+
+glm::vec3 rgle::ray::Bounds::center() const
+{
+	return 0.5f * (this->lower + this->upper);
+}
+
+glm::vec3 rgle::ray::Bounds::extent() const
+{
+	return this->upper - this->lower;
+}
+
+float rgle::ray::Bounds::surfaceArea() const
+{
+	if (this->isEmpty()) {
+		return 0.0f;
+	}
+	glm::vec3 extent = this->extent();
+	return 2.0f * (extent.x * extent.y + extent.y * extent.z + extent.z * extent.x);
+}
+
+rgle::ray::Bounds rgle::ray::Bounds::merge(const Bounds& other) const
+{
+	return Bounds {
+		.lower = glm::min(this->lower, other.lower),
+		.upper = glm::max(this->upper, other.upper)
+	};
+}
+
+rgle::ray::Bounds rgle::ray::Bounds::merge(const glm::vec3& point) const
+{
+	return Bounds {
+		.lower = glm::min(this->lower, point),
+		.upper = glm::max(this->upper, point)
+	};
+}
+
+rgle::ray::Bounds rgle::ray::Bounds::pad(const float& amount) const
+{
+	if (this->isEmpty()) {
+		return *this;
+	}
+	return Bounds {
+		.lower = this->lower - glm::vec3(amount, amount, amount),
+		.upper = this->upper + glm::vec3(amount, amount, amount)
+	};
+}
+
+rgle::ray::Bounds rgle::ray::Bounds::padRelative(const float& relative) const
+{
+	if (this->isEmpty()) {
+		return *this;
+	}
+	glm::vec3 magnitude = glm::max(glm::abs(this->lower), glm::abs(this->upper));
+	return this->pad(relative * std::max(magnitude.x, std::max(magnitude.y, magnitude.z)) + std::numeric_limits<float>::min());
+}
+
+rgle::ray::Bounds rgle::ray::Bounds::transform(const glm::mat4& matrix) const
+{
+	if (this->isEmpty()) {
+		return *this;
+	}
+	else if (!this->isBounded()) {
+		return Bounds::infinite();
+	}
+	Bounds result = Bounds::empty();
+	for (int i = 0; i < 8; i++) {
+		glm::vec3 corner = glm::vec3(
+			i & 1 ? this->upper.x : this->lower.x,
+			i & 2 ? this->upper.y : this->lower.y,
+			i & 4 ? this->upper.z : this->lower.z
+		);
+		result = result.merge(glm::vec3((matrix * glm::vec4(corner, 1.0f)).xyz));
+	}
+	return result;
+}
+
+std::optional<glm::vec2> rgle::ray::Bounds::clip(const glm::vec3& eye, const glm::vec3& delta) const
+{
+	float tLower = -std::numeric_limits<float>::infinity();
+	float tUpper = std::numeric_limits<float>::infinity();
+	for (int axis = 0; axis < 3; axis++) {
+		if (delta[axis] == 0.0f) {
+			// Line runs parallel to the slab, it is either always or never inside
+			if (eye[axis] < this->lower[axis] || eye[axis] > this->upper[axis]) {
+				return std::nullopt;
+			}
+			continue;
+		}
+		float inverse = 1.0f / delta[axis];
+		float t0 = (this->lower[axis] - eye[axis]) * inverse;
+		float t1 = (this->upper[axis] - eye[axis]) * inverse;
+		if (t0 > t1) {
+			std::swap(t0, t1);
+		}
+		tLower = std::max(tLower, t0);
+		tUpper = std::min(tUpper, t1);
+		if (tLower > tUpper) {
+			return std::nullopt;
+		}
+	}
+	return glm::vec2(tLower, tUpper);
+}
+
+bool rgle::ray::BoundingVolumeHierarchy::Node::leaf() const
+{
+	return this->count > 0;
+}
+
+rgle::ray::BoundingVolumeHierarchy::BoundingVolumeHierarchy()
+{
+}
+
+rgle::ray::BoundingVolumeHierarchy::BoundingVolumeHierarchy(const std::vector<Bounds>& primitives, HierarchyOptions options) :
+	_options(options)
+{
+	if (options.bins < 2 || options.maxLeafSize < 1) {
+		throw IllegalArgumentException("invalid bounding volume hierarchy options", LOGGER_DETAIL_DEFAULT);
+	}
+	if (primitives.size() > std::numeric_limits<uint32_t>::max()) {
+		throw IllegalArgumentException("too many primitives for bounding volume hierarchy", LOGGER_DETAIL_DEFAULT);
+	}
+	std::vector<Reference> references;
+	references.reserve(primitives.size());
+	for (size_t i = 0; i < primitives.size(); i++) {
+		const Bounds& bounds = primitives[i];
+		if (bounds.isEmpty()) {
+			// Primitives without volume can never be hit
+			continue;
+		}
+		else if (!bounds.isBounded()) {
+			this->_unbounded.push_back(static_cast<uint32_t>(i));
+			continue;
+		}
+		Bounds padded = bounds.padRelative();
+		references.push_back(Reference {
+			.bounds = padded,
+			.centroid = padded.center(),
+			.primitive = static_cast<uint32_t>(i)
+		});
+	}
+	if (!references.empty()) {
+		this->_build(references);
+	}
+	this->_buildCost = this->cost();
+}
+
+rgle::ray::Bounds rgle::ray::BoundingVolumeHierarchy::bounds() const
+{
+	Bounds result = this->_nodes.empty() ? Bounds::empty() : this->_nodes[0].bounds;
+	return this->_unbounded.empty() ? result : Bounds::infinite();
+}
+
+bool rgle::ray::BoundingVolumeHierarchy::refit(const std::vector<Bounds>& primitives)
+{
+	size_t nonEmpty = 0;
+	for (const Bounds& bounds : primitives) {
+		if (!bounds.isEmpty()) {
+			nonEmpty++;
+		}
+	}
+	if (nonEmpty != this->_primitives.size() + this->_unbounded.size()) {
+		return false;
+	}
+	for (const uint32_t& primitive : this->_unbounded) {
+		if (primitive >= primitives.size() || primitives[primitive].isEmpty() || primitives[primitive].isBounded()) {
+			return false;
+		}
+	}
+	for (const uint32_t& primitive : this->_primitives) {
+		if (primitive >= primitives.size() || primitives[primitive].isEmpty() || !primitives[primitive].isBounded()) {
+			return false;
+		}
+	}
+	// Children are always stored after their parent, so a reverse sweep visits them first
+	for (size_t i = this->_nodes.size(); i-- > 0;) {
+		Node& node = this->_nodes[i];
+		Bounds bounds = Bounds::empty();
+		if (node.leaf()) {
+			for (uint32_t j = node.offset; j < node.offset + node.count; j++) {
+				bounds = bounds.merge(primitives[this->_primitives[j]].padRelative());
+			}
+		}
+		else {
+			bounds = this->_nodes[node.offset].bounds.merge(this->_nodes[node.offset + 1].bounds);
+		}
+		node.bounds = bounds;
+	}
+	return true;
+}
+
+float rgle::ray::BoundingVolumeHierarchy::cost() const
+{
+	if (this->_nodes.empty()) {
+		return 0.0f;
+	}
+	float rootArea = std::max(this->_nodes[0].bounds.surfaceArea(), std::numeric_limits<float>::min());
+	float result = 0.0f;
+	for (const Node& node : this->_nodes) {
+		float weight = node.bounds.surfaceArea() / rootArea;
+		if (node.leaf()) {
+			result += this->_options.intersectCost * node.count * weight;
+		}
+		else {
+			result += this->_options.traversalCost * weight;
+		}
+	}
+	return result;
+}
+
+float rgle::ray::BoundingVolumeHierarchy::buildCost() const
+{
+	return this->_buildCost;
+}
+
+size_t rgle::ray::BoundingVolumeHierarchy::depth() const
+{
+	if (this->_nodes.empty()) {
+		return 0;
+	}
+	size_t result = 0;
+	std::vector<std::pair<uint32_t, size_t>> stack = { { 0, 1 } };
+	while (!stack.empty()) {
+		auto [index, level] = stack.back();
+		stack.pop_back();
+		result = std::max(result, level);
+		const Node& node = this->_nodes[index];
+		if (!node.leaf()) {
+			stack.push_back({ node.offset, level + 1 });
+			stack.push_back({ node.offset + 1, level + 1 });
+		}
+	}
+	return result;
+}
+
+const std::vector<rgle::ray::BoundingVolumeHierarchy::Node>& rgle::ray::BoundingVolumeHierarchy::nodes() const
+{
+	return this->_nodes;
+}
+
+const std::vector<uint32_t>& rgle::ray::BoundingVolumeHierarchy::primitives() const
+{
+	return this->_primitives;
+}
+
+const std::vector<uint32_t>& rgle::ray::BoundingVolumeHierarchy::unbounded() const
+{
+	return this->_unbounded;
+}
+
+const rgle::ray::HierarchyOptions& rgle::ray::BoundingVolumeHierarchy::options() const
+{
+	return this->_options;
+}
+
+void rgle::ray::BoundingVolumeHierarchy::_build(std::vector<Reference>& references)
+{
+	struct Task {
+		uint32_t node;
+		size_t depth;
+	};
+	Bounds rootBounds = Bounds::empty();
+	for (const Reference& reference : references) {
+		rootBounds = rootBounds.merge(reference.bounds);
+	}
+	this->_nodes.reserve(2 * references.size());
+	this->_nodes.push_back(Node {
+		.bounds = rootBounds,
+		.offset = 0,
+		.count = static_cast<uint32_t>(references.size())
+	});
+	std::vector<Task> tasks = { Task{ 0, 0 } };
+	while (!tasks.empty()) {
+		Task task = tasks.back();
+		tasks.pop_back();
+		const Node node = this->_nodes[task.node];
+		Bounds centroids = Bounds::empty();
+		for (uint32_t i = node.offset; i < node.offset + node.count; i++) {
+			centroids = centroids.merge(references[i].centroid);
+		}
+		uint32_t middle = this->_split(references, node, centroids, task.depth);
+		if (middle == node.offset || middle == node.offset + node.count) {
+			continue;
+		}
+		Bounds left = Bounds::empty();
+		Bounds right = Bounds::empty();
+		for (uint32_t i = node.offset; i < middle; i++) {
+			left = left.merge(references[i].bounds);
+		}
+		for (uint32_t i = middle; i < node.offset + node.count; i++) {
+			right = right.merge(references[i].bounds);
+		}
+		uint32_t child = static_cast<uint32_t>(this->_nodes.size());
+		this->_nodes.push_back(Node{ .bounds = left, .offset = node.offset, .count = middle - node.offset });
+		this->_nodes.push_back(Node{ .bounds = right, .offset = middle, .count = node.offset + node.count - middle });
+		this->_nodes[task.node].offset = child;
+		this->_nodes[task.node].count = 0;
+		tasks.push_back(Task{ child, task.depth + 1 });
+		tasks.push_back(Task{ child + 1, task.depth + 1 });
+	}
+	this->_primitives.resize(references.size());
+	for (size_t i = 0; i < references.size(); i++) {
+		this->_primitives[i] = references[i].primitive;
+	}
+}
+
+uint32_t rgle::ray::BoundingVolumeHierarchy::_split(std::vector<Reference>& references, const Node& node, const Bounds& centroids, size_t depth) const
+{
+	const size_t count = node.count;
+	const uint32_t begin = node.offset;
+	const uint32_t end = node.offset + node.count;
+	if (count <= 1 || depth >= MAX_DEPTH) {
+		return begin;
+	}
+	const size_t bins = this->_options.bins;
+	const glm::vec3 extent = centroids.extent();
+	const float nodeArea = std::max(node.bounds.surfaceArea(), std::numeric_limits<float>::min());
+	auto binOf = [&centroids, &extent, bins](const Reference& reference, int axis) {
+		float relative = (reference.centroid[axis] - centroids.lower[axis]) / extent[axis];
+		return std::min(bins - 1, static_cast<size_t>(relative * bins));
+	};
+
+	float bestCost = std::numeric_limits<float>::infinity();
+	int bestAxis = -1;
+	size_t bestBin = 0;
+	std::vector<Bounds> binBounds(bins);
+	std::vector<size_t> binCounts(bins);
+	std::vector<float> rightArea(bins);
+	std::vector<size_t> rightCount(bins);
+	for (int axis = 0; axis < 3; axis++) {
+		if (!(extent[axis] > 0.0f)) {
+			continue;
+		}
+		std::fill(binBounds.begin(), binBounds.end(), Bounds::empty());
+		std::fill(binCounts.begin(), binCounts.end(), 0);
+		for (uint32_t i = begin; i < end; i++) {
+			size_t bin = binOf(references[i], axis);
+			binBounds[bin] = binBounds[bin].merge(references[i].bounds);
+			binCounts[bin]++;
+		}
+		// Sweep from the right to accumulate the area and count of every right hand partition
+		Bounds accumulated = Bounds::empty();
+		size_t accumulatedCount = 0;
+		for (size_t bin = bins - 1; bin > 0; bin--) {
+			accumulated = accumulated.merge(binBounds[bin]);
+			accumulatedCount += binCounts[bin];
+			rightArea[bin - 1] = accumulated.surfaceArea();
+			rightCount[bin - 1] = accumulatedCount;
+		}
+		accumulated = Bounds::empty();
+		accumulatedCount = 0;
+		for (size_t bin = 0; bin < bins - 1; bin++) {
+			accumulated = accumulated.merge(binBounds[bin]);
+			accumulatedCount += binCounts[bin];
+			if (accumulatedCount == 0 || rightCount[bin] == 0) {
+				continue;
+			}
+			float cost = this->_options.traversalCost + this->_options.intersectCost *
+				(accumulated.surfaceArea() * accumulatedCount + rightArea[bin] * rightCount[bin]) / nodeArea;
+			if (cost < bestCost) {
+				bestCost = cost;
+				bestAxis = axis;
+				bestBin = bin;
+			}
+		}
+	}
+
+	if (bestAxis < 0) {
+		// All centroids coincide, no binned split can separate them
+		return count <= this->_options.maxLeafSize ? begin : begin + static_cast<uint32_t>(count / 2);
+	}
+	if (count <= this->_options.maxLeafSize && bestCost >= this->_options.intersectCost * count) {
+		return begin;
+	}
+	auto middle = std::partition(references.begin() + begin, references.begin() + end, [&binOf, bestAxis, bestBin](const Reference& reference) {
+		return binOf(reference, bestAxis) <= bestBin;
+	});
+	return static_cast<uint32_t>(middle - references.begin());
+}
+
+bool rgle::ray::BoundingVolumeHierarchy::_enter(const Node& node, const glm::vec3& eye, const glm::vec3& delta, float tMin, float tMax, float& near) const
+{
+	auto interval = node.bounds.clip(eye, delta);
+	if (!interval) {
+		return false;
+	}
+	float lower = std::max(interval->x, tMin);
+	float upper = std::min(interval->y, tMax);
+	if (lower > upper) {
+		return false;
+	}
+	if (lower > 0.0f) {
+		near = lower;
+	}
+	else if (upper < 0.0f) {
+		near = -upper;
+	}
+	else {
+		near = 0.0f;
+	}
+	return true;
+}
@@ -0,0 +1,168 @@
+#pragma once
+
+#include "rgle/gfx/Graphics.h"
+
+namespace rgle::ray {
+
+	// Axis aligned bounding box, empty when any lower component exceeds its upper component
+	struct Bounds {
+		static Bounds empty();
+		static Bounds infinite();
+
+		bool isEmpty() const;
+		bool isBounded() const;
+
+		glm::vec3 center() const;
+		glm::vec3 extent() const;
+		float surfaceArea() const;
+
+		Bounds merge(const Bounds& other) const;
+		Bounds merge(const glm::vec3& point) const;
+		Bounds pad(const float& amount) const;
+		// Pads the bounds relative to their magnitude so rounding in derived bounds never culls a grazing hit
+		Bounds padRelative(const float& relative = 1e-5f) const;
+
+		// Computes the bounds of the box after transforming all eight of its corners
+		Bounds transform(const glm::mat4& matrix) const;
+
+		// Clips the line eye + t * delta against the box
+		// @returns the parametric interval inside the box, or std::nullopt if the line misses it
+		std::optional<glm::vec2> clip(const glm::vec3& eye, const glm::vec3& delta) const;
+
+		auto operator<=>(const Bounds&) const = default;
+
+		glm::vec3 lower;
+		glm::vec3 upper;
+	};
+
+	struct HierarchyOptions {
+		// Number of centroid bins evaluated per axis when searching for a split
+		size_t bins = 16;
+		// Largest number of primitives a leaf may hold
+		size_t maxLeafSize = 8;
+		// Relative cost of visiting a node versus intersecting a primitive
+		float traversalCost = 1.0f;
+		float intersectCost = 1.0f;
+		// Largest ratio of the refitted cost to the cost at build time before a refit falls back to a full rebuild
+		float rebuildThreshold = 1.5f;
+	};
+
+	// A bounding volume hierarchy over a list of primitive bounds built using the binned surface area heuristic
+	// @remarks
+	// Primitives with unbounded extents are kept outside of the tree and are visited on every traversal
+	class BoundingVolumeHierarchy {
+	public:
+		struct Node {
+			bool leaf() const;
+
+			Bounds bounds;
+			// First child index for interior nodes (children are stored as a pair), first primitive slot for leaves
+			uint32_t offset;
+			// Number of primitives in a leaf, zero for interior nodes
+			uint32_t count;
+		};
+
+		BoundingVolumeHierarchy();
+		BoundingVolumeHierarchy(const std::vector<Bounds>& primitives, HierarchyOptions options = HierarchyOptions{});
+
+		// Visits primitives whose bounds are crossed by the line eye + t * delta for t in [tMin, tMax], nearest first
+		// @param visit called as visit(primitive, best) where best is the smallest |t| found so far, the visitor lowers
+		// it when it finds a closer hit and nodes that can only contain farther hits are skipped
+		template<typename Visit>
+		void traverse(const glm::vec3& eye, const glm::vec3& delta, float tMin, float tMax, Visit&& visit) const {
+			float best = std::numeric_limits<float>::infinity();
+			for (const uint32_t& primitive : this->_unbounded) {
+				visit(static_cast<size_t>(primitive), best);
+			}
+			if (this->_nodes.empty()) {
+				return;
+			}
+			struct Entry {
+				uint32_t node;
+				float near;
+			};
+			std::array<Entry, 64> stack;
+			size_t top = 0;
+			float near;
+			if (!this->_enter(this->_nodes[0], eye, delta, tMin, tMax, near)) {
+				return;
+			}
+			stack[top++] = Entry{ 0, near };
+			while (top > 0) {
+				const Entry entry = stack[--top];
+				if (entry.near > best) {
+					continue;
+				}
+				const Node& node = this->_nodes[entry.node];
+				if (node.leaf()) {
+					for (uint32_t i = node.offset; i < node.offset + node.count; i++) {
+						visit(static_cast<size_t>(this->_primitives[i]), best);
+					}
+				}
+				else {
+					float nearLeft, nearRight;
+					bool left = this->_enter(this->_nodes[node.offset], eye, delta, tMin, tMax, nearLeft);
+					bool right = this->_enter(this->_nodes[node.offset + 1], eye, delta, tMin, tMax, nearRight);
+					if (left && right) {
+						// Push the farther child first so the nearer one is visited first
+						if (nearLeft <= nearRight) {
+							stack[top++] = Entry{ node.offset + 1, nearRight };
+							stack[top++] = Entry{ node.offset, nearLeft };
+						}
+						else {
+							stack[top++] = Entry{ node.offset, nearLeft };
+							stack[top++] = Entry{ node.offset + 1, nearRight };
+						}
+					}
+					else if (left) {
+						stack[top++] = Entry{ node.offset, nearLeft };
+					}
+					else if (right) {
+						stack[top++] = Entry{ node.offset + 1, nearRight };
+					}
+				}
+			}
+		}
+
+		Bounds bounds() const;
+
+		// Refits the node bounds to moved primitives bottom up, keeping the topology of the tree
+		// @param primitives the new bounds of every primitive the hierarchy was built over
+		// @returns false without changing the tree if a primitive became empty, unbounded or bounded since the build,
+		// the hierarchy has to be rebuilt in that case
+		bool refit(const std::vector<Bounds>& primitives);
+
+		// Computes the surface area heuristic cost of the whole tree
+		float cost() const;
+		// Cost of the tree when it was built, refitting degrades the cost as primitives move apart
+		float buildCost() const;
+
+		size_t depth() const;
+
+		const std::vector<Node>& nodes() const;
+		const std::vector<uint32_t>& primitives() const;
+		const std::vector<uint32_t>& unbounded() const;
+		const HierarchyOptions& options() const;
+
+		static const size_t MAX_DEPTH;
+
+	private:
+		struct Reference {
+			Bounds bounds;
+			glm::vec3 centroid;
+			uint32_t primitive;
+		};
+
+		void _build(std::vector<Reference>& references);
+		uint32_t _split(std::vector<Reference>& references, const Node& node, const Bounds& centroids, size_t depth) const;
+
+		// Clips the line against the node bounds and computes the smallest |t| inside the clipped interval
+		bool _enter(const Node& node, const glm::vec3& eye, const glm::vec3& delta, float tMin, float tMax, float& near) const;
+
+		std::vector<Node> _nodes;
+		std::vector<uint32_t> _primitives;
+		std::vector<uint32_t> _unbounded;
+		HierarchyOptions _options;
+		float _buildCost = 0.0f;
+	};
+}
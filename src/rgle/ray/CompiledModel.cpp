@@ -0,0 +1,216 @@
+#include "rgle/ray/CompiledModel.h"
+
+const size_t rgle::ray::CompiledModel::MAX_STACK_DEPTH = 128;
+
+rgle::ray::CompiledModel::CompiledModel()
+{
+}
+
+rgle::ray::CompiledModel::CompiledModel(const Model& model)
+{
+	this->_compile(model, 0, 0);
+}
+
+std::optional<rgle::ray::Intersection> rgle::ray::CompiledModel::intersect(const Ray& ray) const
+{
+	if (this->_program.empty()) {
+		return std::nullopt;
+	}
+	return this->_execute(ray, 0, static_cast<uint32_t>(this->_program.size()));
+}
+
+const std::vector<rgle::ray::CompiledModel::Instruction>& rgle::ray::CompiledModel::program() const
+{
+	return this->_program;
+}
+
+void rgle::ray::CompiledModel::_compile(const Model& model, size_t valueDepth, size_t rayDepth)
+{
+	if (valueDepth >= MAX_STACK_DEPTH || rayDepth >= MAX_STACK_DEPTH) {
+		throw IllegalArgumentException("model is nested too deeply to compile", LOGGER_DETAIL_DEFAULT);
+	}
+	if (auto val = std::get_if<Object>(&model)) {
+		if (val->object == nullptr) {
+			throw NullPointerException(LOGGER_DETAIL_DEFAULT);
+		}
+		// Only exact balls and planes are copied, subclasses may override intersect and would be sliced by the copy
+		const Intersect& object = *val->object;
+		if (typeid(object) == typeid(Ball)) {
+			this->_emit(Opcode::BALL, static_cast<uint32_t>(this->_balls.size()));
+			this->_balls.push_back(static_cast<const Ball&>(object));
+		}
+		else if (typeid(object) == typeid(Plane)) {
+			this->_emit(Opcode::PLANE, static_cast<uint32_t>(this->_planes.size()));
+			this->_planes.push_back(static_cast<const Plane&>(object));
+		}
+		else {
+			this->_emit(Opcode::OBJECT, static_cast<uint32_t>(this->_objects.size()));
+			this->_objects.push_back(val->object.get());
+		}
+	}
+	else if (auto val = std::get_if<Scene>(&model)) {
+		if (val->hierarchy) {
+			uint32_t start = static_cast<uint32_t>(this->_program.size());
+			uint32_t index = static_cast<uint32_t>(this->_scenes.size());
+			this->_emit(Opcode::SCENE_HIERARCHY, index);
+			this->_scenes.push_back(SceneHierarchy{ .hierarchy = val->hierarchy });
+			for (const auto& child : val->scene) {
+				this->_scenes[index].children.push_back(static_cast<uint32_t>(this->_program.size()));
+				// Children are executed on their own stacks when the hierarchy visits them
+				this->_compile(child, 0, 0);
+			}
+			this->_scenes[index].end = static_cast<uint32_t>(this->_program.size());
+			this->_program[start].count = this->_scenes[index].end - start - 1;
+		}
+		else {
+			// Each child is folded into the closest hit so far as soon as it is evaluated, so wide scenes take two slots
+			// of the value stack instead of one per child
+			for (size_t i = 0; i < val->scene.size(); i++) {
+				this->_compile(val->scene[i], i == 0 ? valueDepth : valueDepth + 1, rayDepth);
+				if (i > 0) {
+					this->_emit(Opcode::SCENE, 0, 2);
+				}
+			}
+			if (val->scene.empty()) {
+				this->_emit(Opcode::SCENE, 0, 0);
+			}
+		}
+	}
+	else if (auto val = std::get_if<Transform>(&model)) {
+		uint32_t index = static_cast<uint32_t>(this->_transforms.size());
+		this->_transforms.push_back(val->transform);
+		this->_emit(Opcode::ENTER_TRANSFORM, index);
+		this->_compile(*val->model, valueDepth, rayDepth + 1);
+		this->_emit(Opcode::EXIT_TRANSFORM, index);
+	}
+	else if (auto val = std::get_if<Clip>(&model)) {
+		this->_compile(*val->model, valueDepth, rayDepth);
+		this->_emit(Opcode::CLIP, static_cast<uint32_t>(this->_planes.size()));
+		this->_planes.push_back(val->clipPlane);
+	}
+	else if (auto val = std::get_if<And>(&model)) {
+		this->_compile(*val->lhs, valueDepth, rayDepth);
+		this->_compile(*val->rhs, valueDepth + 1, rayDepth);
+		this->_emit(Opcode::AND);
+	}
+	else if (auto val = std::get_if<Or>(&model)) {
+		this->_compile(*val->lhs, valueDepth, rayDepth);
+		this->_compile(*val->rhs, valueDepth + 1, rayDepth);
+		this->_emit(Opcode::OR);
+	}
+}
+
+void rgle::ray::CompiledModel::_emit(Opcode opcode, uint32_t operand, uint32_t count)
+{
+	this->_program.push_back(Instruction{ .opcode = opcode, .operand = operand, .count = count });
+}
+
+std::optional<rgle::ray::Intersection> rgle::ray::CompiledModel::_execute(const Ray& ray, uint32_t begin, uint32_t end) const
+{
+	std::array<std::optional<Intersection>, MAX_STACK_DEPTH> values;
+	std::array<Ray, MAX_STACK_DEPTH> rays;
+	size_t valueTop = 0;
+	size_t rayTop = 0;
+	rays[rayTop++] = ray;
+	uint32_t pc = begin;
+	while (pc < end) {
+		const Instruction& instruction = this->_program[pc++];
+		const Ray& current = rays[rayTop - 1];
+		switch (instruction.opcode) {
+		case Opcode::BALL:
+			values[valueTop++] = this->_balls[instruction.operand].Ball::intersect(current).closest();
+			break;
+		case Opcode::PLANE:
+			values[valueTop++] = this->_planes[instruction.operand].Plane::intersect(current).closest();
+			break;
+		case Opcode::OBJECT:
+			values[valueTop++] = this->_objects[instruction.operand]->intersect(current).closest();
+			break;
+		case Opcode::ENTER_TRANSFORM:
+			rays[rayTop] = this->_transforms[instruction.operand].applyForward(current);
+			rayTop++;
+			break;
+		case Opcode::EXIT_TRANSFORM:
+			rayTop--;
+			if (values[valueTop - 1]) {
+				values[valueTop - 1] = this->_transforms[instruction.operand].applyBackward(*values[valueTop - 1]);
+			}
+			break;
+		case Opcode::CLIP: {
+			auto& value = values[valueTop - 1];
+			if (value && !std::holds_alternative<Inside>(this->_planes[instruction.operand].clip(value->position))) {
+				value = std::nullopt;
+			}
+			break;
+		}
+		case Opcode::AND: {
+			auto& lhs = values[valueTop - 2];
+			auto& rhs = values[valueTop - 1];
+			if (lhs && rhs) {
+				if (!(lhs->distance(current) < rhs->distance(current))) {
+					lhs = rhs;
+				}
+			}
+			else {
+				lhs = std::nullopt;
+			}
+			valueTop--;
+			break;
+		}
+		case Opcode::OR: {
+			auto& lhs = values[valueTop - 2];
+			auto& rhs = values[valueTop - 1];
+			if (rhs && (!lhs || !(lhs->distance(current) < rhs->distance(current)))) {
+				lhs = rhs;
+			}
+			valueTop--;
+			break;
+		}
+		case Opcode::SCENE: {
+			size_t first = valueTop - instruction.count;
+			std::optional<Intersection> closest = std::nullopt;
+			for (size_t i = first; i < valueTop; i++) {
+				if (values[i] && (!closest || values[i]->distance(current) < closest->distance(current))) {
+					closest = values[i];
+				}
+			}
+			valueTop = first;
+			values[valueTop++] = closest;
+			break;
+		}
+		case Opcode::SCENE_HIERARCHY: {
+			const SceneHierarchy& scene = this->_scenes[instruction.operand];
+			std::optional<Intersection> closest = std::nullopt;
+			size_t closestIndex = 0;
+			float closestDistance = 0.0f;
+			auto delta = current.delta();
+			float deltaLength = glm::length(delta);
+			scene.hierarchy->traverse(
+				current.eye,
+				delta,
+				-std::numeric_limits<float>::infinity(),
+				std::numeric_limits<float>::infinity(),
+				[&](size_t index, float& best) {
+					uint32_t childEnd = index + 1 < scene.children.size() ? scene.children[index + 1] : scene.end;
+					if (auto intersect = this->_execute(current, scene.children[index], childEnd)) {
+						float distance = intersect->distance(current);
+						// NOTE: ties resolve to the lowest index to match Model::intersect
+						if (!closest.has_value() || distance < closestDistance || (distance == closestDistance && index < closestIndex)) {
+							closest = std::move(intersect);
+							closestIndex = index;
+							closestDistance = distance;
+							if (deltaLength > 0.0f) {
+								best = (1.0f + 1e-5f) * distance / deltaLength;
+							}
+						}
+					}
+				}
+			);
+			values[valueTop++] = closest;
+			pc += instruction.count;
+			break;
+		}
+		}
+	}
+	return values[0];
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "rgle/ray/Raycast.h"
+
+namespace rgle::ray {
+
+	// A ray::Model tree flattened into a postfix program evaluated with explicit stacks
+	// @remarks
+	// Balls, planes, transforms and clip planes are copied into contiguous arrays so intersecting does not chase
+	// pointers or dispatch virtually, objects of other Intersect types are called through a pointer into the source
+	// model which must then outlive the compiled model
+	// @note intersect gives the same results as Model::intersect on the model it was compiled from
+	class CompiledModel {
+	public:
+		enum class Opcode : uint8_t {
+			BALL,
+			PLANE,
+			OBJECT,
+			// Prefix of a transformed subprogram, pushes the transformed ray
+			ENTER_TRANSFORM,
+			// Suffix of a transformed subprogram, pops the ray and transforms the result back
+			EXIT_TRANSFORM,
+			CLIP,
+			AND,
+			OR,
+			// Reduces the last count results to the closest one, scenes fold each child after the first with a count of 2
+			SCENE,
+			// Prefix of a scene with a hierarchy, its children are evaluated on demand and count instructions are skipped
+			SCENE_HIERARCHY
+		};
+
+		struct Instruction {
+			Opcode opcode;
+			// Index into the array matching the opcode
+			uint32_t operand;
+			uint32_t count;
+		};
+
+		CompiledModel();
+		CompiledModel(const Model& model);
+
+		std::optional<Intersection> intersect(const Ray& ray) const;
+
+		const std::vector<Instruction>& program() const;
+
+		static const size_t MAX_STACK_DEPTH;
+
+	private:
+		struct SceneHierarchy {
+			std::shared_ptr<BoundingVolumeHierarchy> hierarchy;
+			// First instruction of each child, the child ends where the next one starts
+			std::vector<uint32_t> children;
+			uint32_t end;
+		};
+
+		void _compile(const Model& model, size_t valueDepth, size_t rayDepth);
+		void _emit(Opcode opcode, uint32_t operand = 0, uint32_t count = 0);
+
+		std::optional<Intersection> _execute(const Ray& ray, uint32_t begin, uint32_t end) const;
+
+		std::vector<Instruction> _program;
+		std::vector<Ball> _balls;
+		std::vector<Plane> _planes;
+		std::vector<const Intersect*> _objects;
+		std::vector<RayTransform> _transforms;
+		std::vector<SceneHierarchy> _scenes;
+	};
+}
@@ -0,0 +1,131 @@
+#include "rgle/ray/Mesh.h"
+
+namespace {
+	std::optional<glm::vec3> moller_trumbore(const glm::vec3& eye, const glm::vec3& delta, const glm::vec3& vertex, const glm::vec3& edge1, const glm::vec3& edge2) {
+		glm::vec3 p = glm::cross(delta, edge2);
+		float determinant = glm::dot(edge1, p);
+		if (determinant == 0.0f) {
+			return std::nullopt;
+		}
+		float inverse = 1.0f / determinant;
+		glm::vec3 s = eye - vertex;
+		float u = glm::dot(s, p) * inverse;
+		if (u < 0.0f || u > 1.0f) {
+			return std::nullopt;
+		}
+		glm::vec3 q = glm::cross(s, edge1);
+		float v = glm::dot(delta, q) * inverse;
+		if (v < 0.0f || u + v > 1.0f) {
+			return std::nullopt;
+		}
+		float t = glm::dot(edge2, q) * inverse;
+		if (!(t >= 0.0f)) {
+			return std::nullopt;
+		}
+		return glm::vec3(t, u, v);
+	}
+
+	std::vector<uint32_t> widen(const std::vector<unsigned short>& indices) {
+		return std::vector<uint32_t>(indices.begin(), indices.end());
+	}
+}
+
+std::optional<glm::vec3> rgle::ray::intersect_triangle(const Ray& ray, const glm::vec3& p1, const glm::vec3& p2, const glm::vec3& p3)
+{
+	return moller_trumbore(ray.eye, ray.delta(), p1, p2 - p1, p3 - p1);
+}
+
+rgle::ray::Mesh::Mesh(const gfx::Geometry3D& geometry, HierarchyOptions options) : Mesh(geometry.vertex.list, widen(geometry.index.list), options)
+{
+}
+
+rgle::ray::Mesh::Mesh(const std::vector<glm::vec3>& vertices, const std::vector<uint32_t>& indices, HierarchyOptions options) :
+	_bounds(Bounds::empty())
+{
+	if (indices.size() % 3 != 0) {
+		throw IllegalArgumentException("mesh index count must be a multiple of three", LOGGER_DETAIL_DEFAULT);
+	}
+	std::vector<Bounds> bounds;
+	this->_triangles.reserve(indices.size() / 3);
+	bounds.reserve(indices.size() / 3);
+	for (size_t i = 0; i < indices.size(); i += 3) {
+		if (indices[i] >= vertices.size() || indices[i + 1] >= vertices.size() || indices[i + 2] >= vertices.size()) {
+			throw OutOfBoundsException(LOGGER_DETAIL_DEFAULT);
+		}
+		const glm::vec3& p1 = vertices[indices[i]];
+		const glm::vec3& p2 = vertices[indices[i + 1]];
+		const glm::vec3& p3 = vertices[indices[i + 2]];
+		this->_triangles.push_back(Triangle {
+			.vertex = p1,
+			.edge1 = p2 - p1,
+			.edge2 = p3 - p1
+		});
+		bounds.push_back(Bounds::empty().merge(p1).merge(p2).merge(p3));
+		this->_bounds = this->_bounds.merge(bounds.back());
+	}
+	this->_hierarchy = BoundingVolumeHierarchy(bounds, options);
+}
+
+rgle::ray::Mesh::~Mesh()
+{
+}
+
+rgle::ray::IntersectResult rgle::ray::Mesh::intersect(const Ray& ray) const
+{
+	if (auto hit = this->closestHit(ray)) {
+		return IntersectResult(HitOnce {
+			.hit = hit->intersection
+		});
+	}
+	return IntersectResult(Miss {});
+}
+
+std::optional<rgle::ray::MeshHit> rgle::ray::Mesh::closestHit(const Ray& ray) const
+{
+	auto delta = ray.delta();
+	std::optional<glm::vec3> closest = std::nullopt;
+	size_t closestIndex = 0;
+	this->_hierarchy.traverse(
+		ray.eye,
+		delta,
+		0.0f,
+		std::numeric_limits<float>::infinity(),
+		[&](size_t index, float& best) {
+			const Triangle& triangle = this->_triangles[index];
+			if (auto hit = moller_trumbore(ray.eye, delta, triangle.vertex, triangle.edge1, triangle.edge2)) {
+				if (!closest.has_value() || hit->x < closest->x || (hit->x == closest->x && index < closestIndex)) {
+					closest = hit;
+					closestIndex = index;
+					best = hit->x;
+				}
+			}
+		}
+	);
+	if (!closest.has_value()) {
+		return std::nullopt;
+	}
+	const Triangle& triangle = this->_triangles[closestIndex];
+	auto normal = glm::normalize(glm::cross(triangle.edge1, triangle.edge2));
+	return MeshHit {
+		.intersection = Intersection {
+			.position = ray.eye + closest->x * delta,
+			.normal = glm::dot(delta, normal) < 0.0f ? normal : -normal
+		},
+		.triangle = closestIndex
+	};
+}
+
+rgle::ray::Bounds rgle::ray::Mesh::bounds() const
+{
+	return this->_bounds;
+}
+
+size_t rgle::ray::Mesh::triangleCount() const
+{
+	return this->_triangles.size();
+}
+
+const rgle::ray::BoundingVolumeHierarchy& rgle::ray::Mesh::hierarchy() const
+{
+	return this->_hierarchy;
+}
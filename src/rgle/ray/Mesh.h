@@ -0,0 +1,50 @@
+#pragma once
+
+#include "rgle/ray/Raycast.h"
+
+namespace rgle::ray {
+
+	// Intersects a ray with a triangle using the Moller-Trumbore algorithm, hits behind the eye are ignored
+	// @returns (t, u, v) such that eye + t * delta = (1 - u - v) * p1 + u * p2 + v * p3, or std::nullopt on a miss
+	std::optional<glm::vec3> intersect_triangle(const Ray& ray, const glm::vec3& p1, const glm::vec3& p2, const glm::vec3& p3);
+
+	struct MeshHit {
+		auto operator<=>(const MeshHit&) const = default;
+
+		Intersection intersection;
+		size_t triangle;
+	};
+
+	// An indexed triangle mesh intersected through a bounding volume hierarchy built over its triangles
+	// @remarks
+	// Normals are the geometric face normals oriented towards the eye, like those of a Plane
+	class Mesh : public Intersect {
+	public:
+		Mesh(const gfx::Geometry3D& geometry, HierarchyOptions options = HierarchyOptions{});
+		Mesh(const std::vector<glm::vec3>& vertices, const std::vector<uint32_t>& indices, HierarchyOptions options = HierarchyOptions{});
+		virtual ~Mesh();
+
+		virtual IntersectResult intersect(const Ray& ray) const override;
+
+		// Finds the closest triangle hit by the ray, ties resolve to the lowest triangle index
+		std::optional<MeshHit> closestHit(const Ray& ray) const;
+
+		virtual Bounds bounds() const override;
+
+		size_t triangleCount() const;
+
+		const BoundingVolumeHierarchy& hierarchy() const;
+
+	private:
+		// Triangles are stored as a vertex and the two edges leaving it, as consumed by Moller-Trumbore
+		struct Triangle {
+			glm::vec3 vertex;
+			glm::vec3 edge1;
+			glm::vec3 edge2;
+		};
+
+		std::vector<Triangle> _triangles;
+		Bounds _bounds;
+		BoundingVolumeHierarchy _hierarchy;
+	};
+}
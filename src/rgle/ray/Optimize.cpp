@@ -0,0 +1,157 @@
+#include "rgle/ray/Raycast.h"
+
+namespace {
+	using namespace rgle::ray;
+
+	// Placeholder for subtrees which can never be hit
+	Model never() {
+		return Model(Scene {});
+	}
+
+	bool never_hits(const Model& model) {
+		return model.bounds().isEmpty();
+	}
+
+	Model optimize_node(Model&& model);
+
+	std::unique_ptr<Model> optimize_child(std::unique_ptr<Model>&& model) {
+		return std::make_unique<Model>(optimize_node(std::move(*model)));
+	}
+
+	Model optimize_node(Model&& model) {
+		// Bounds cached by an earlier pass may be stale
+		model.cachedBounds = std::nullopt;
+		if (auto val = std::get_if<Scene>(&model)) {
+			Scene scene;
+			scene.scene.reserve(val->scene.size());
+			for (auto& child : val->scene) {
+				auto optimized = optimize_node(std::move(child));
+				if (!never_hits(optimized)) {
+					scene.scene.push_back(std::move(optimized));
+				}
+			}
+			if (scene.scene.size() == 1) {
+				return std::move(scene.scene.front());
+			}
+			if (val->hierarchy && !scene.scene.empty()) {
+				if (scene.scene.size() == val->scene.size()) {
+					scene.hierarchy = val->hierarchy;
+				}
+				else {
+					scene.build(val->hierarchy->options());
+				}
+			}
+			return Model(std::move(scene));
+		}
+		else if (auto val = std::get_if<Transform>(&model)) {
+			auto child = optimize_node(std::move(*val->model));
+			if (never_hits(child)) {
+				return never();
+			}
+			if (auto inner = std::get_if<Transform>(&child)) {
+				return Model(Transform {
+					.transform = RayTransform(val->transform.affine * inner->transform.affine),
+					.model = std::move(inner->model)
+				});
+			}
+			return Model(Transform {
+				.transform = val->transform,
+				.model = std::make_unique<Model>(std::move(child))
+			});
+		}
+		else if (auto val = std::get_if<Clip>(&model)) {
+			auto child = optimize_node(std::move(*val->model));
+			if (never_hits(child)) {
+				return never();
+			}
+			// Corners are classified on padded bounds so grazing hits never change sides
+			auto bounds = child.bounds().padRelative();
+			if (bounds.isBounded()) {
+				size_t inside = 0;
+				for (size_t i = 0; i < 8; i++) {
+					glm::vec3 corner(
+						(i & 1) ? bounds.upper.x : bounds.lower.x,
+						(i & 2) ? bounds.upper.y : bounds.lower.y,
+						(i & 4) ? bounds.upper.z : bounds.lower.z
+					);
+					if (std::holds_alternative<Inside>(val->clipPlane.clip(corner))) {
+						inside++;
+					}
+				}
+				if (inside == 0) {
+					return never();
+				}
+				if (inside == 8) {
+					return child;
+				}
+			}
+			return Model(Clip {
+				.clipPlane = val->clipPlane,
+				.model = std::make_unique<Model>(std::move(child))
+			});
+		}
+		else if (auto val = std::get_if<And>(&model)) {
+			auto lhs = optimize_child(std::move(val->lhs));
+			auto rhs = optimize_child(std::move(val->rhs));
+			if (never_hits(*lhs) || never_hits(*rhs)) {
+				return never();
+			}
+			return Model(And {
+				.lhs = std::move(lhs),
+				.rhs = std::move(rhs)
+			});
+		}
+		else if (auto val = std::get_if<Or>(&model)) {
+			auto lhs = optimize_child(std::move(val->lhs));
+			auto rhs = optimize_child(std::move(val->rhs));
+			if (never_hits(*lhs)) {
+				return std::move(*rhs);
+			}
+			if (never_hits(*rhs)) {
+				return std::move(*lhs);
+			}
+			return Model(Or {
+				.lhs = std::move(lhs),
+				.rhs = std::move(rhs)
+			});
+		}
+		return std::move(model);
+	}
+}
+
+rgle::ray::Model rgle::ray::optimize(Model&& model)
+{
+	auto result = optimize_node(std::move(model));
+	// Children were optimized bottom up, so the cached bounds of the whole tree are set in a second pass
+	std::vector<Model*> stack = { &result };
+	std::vector<Model*> order;
+	while (!stack.empty()) {
+		Model* node = stack.back();
+		stack.pop_back();
+		order.push_back(node);
+		if (auto val = std::get_if<Scene>(node)) {
+			for (auto& child : val->scene) {
+				stack.push_back(&child);
+			}
+		}
+		else if (auto val = std::get_if<Transform>(node)) {
+			stack.push_back(val->model.get());
+		}
+		else if (auto val = std::get_if<Clip>(node)) {
+			stack.push_back(val->model.get());
+		}
+		else if (auto val = std::get_if<And>(node)) {
+			stack.push_back(val->lhs.get());
+			stack.push_back(val->rhs.get());
+		}
+		else if (auto val = std::get_if<Or>(node)) {
+			stack.push_back(val->lhs.get());
+			stack.push_back(val->rhs.get());
+		}
+	}
+	// Parents are visited before their children, so caching in reverse reuses the children's bounds
+	for (auto it = order.rbegin(); it != order.rend(); it++) {
+		(*it)->cachedBounds = (*it)->bounds().padRelative();
+	}
+	return result;
+}
@@ -0,0 +1,96 @@
+#include "rgle/ray/Raycast.h"
+#include "rgle/math/Simd.h"
+
+namespace {
+	using namespace rgle::math;
+
+	template<typename V>
+	V dot(const V& ax, const V& ay, const V& az, const V& bx, const V& by, const V& bz) {
+		// Same association as glm::dot so lanes agree with the scalar intersection
+		return (ax * bx + ay * by) + az * bz;
+	}
+
+	template<typename V, size_t N>
+	void intersect_plane(const rgle::ray::Plane& plane, const rgle::ray::RayPacket<N>& packet, rgle::ray::PacketResult<N>& result) {
+		const V nx = V::broadcast(plane.normal.x), ny = V::broadcast(plane.normal.y), nz = V::broadcast(plane.normal.z);
+		const V offset = V::broadcast(glm::dot(plane.position, plane.normal));
+		const V zero = V::broadcast(0.0f);
+		for (size_t i = 0; i < N; i += V::WIDTH) {
+			V ex = V::load(&packet.eye.x[i]), ey = V::load(&packet.eye.y[i]), ez = V::load(&packet.eye.z[i]);
+			V dx = V::load(&packet.target.x[i]) - ex, dy = V::load(&packet.target.y[i]) - ey, dz = V::load(&packet.target.z[i]) - ez;
+			V denom = dot(dx, dy, dz, nx, ny, nz);
+			V t = (offset - dot(ex, ey, ez, nx, ny, nz)) / denom;
+			auto hit = (denom != zero) & (t >= zero);
+			(ex + t * dx).store(&result.closerPosition.x[i]);
+			(ey + t * dy).store(&result.closerPosition.y[i]);
+			(ez + t * dz).store(&result.closerPosition.z[i]);
+			auto front = denom < zero;
+			select(front, nx, -nx).store(&result.closerNormal.x[i]);
+			select(front, ny, -ny).store(&result.closerNormal.y[i]);
+			select(front, nz, -nz).store(&result.closerNormal.z[i]);
+			simd::store_count(&result.hits[i], typename V::Mask{}, hit);
+		}
+	}
+
+	template<typename V, size_t N>
+	void intersect_ball(const rgle::ray::Ball& ball, const rgle::ray::RayPacket<N>& packet, rgle::ray::PacketResult<N>& result) {
+		const V c0 = V::broadcast(ball.radius * ball.radius);
+		const V two = V::broadcast(2.0f);
+		const V one = V::broadcast(1.0f);
+		for (size_t i = 0; i < N; i += V::WIDTH) {
+			V ex = V::load(&packet.eye.x[i]), ey = V::load(&packet.eye.y[i]), ez = V::load(&packet.eye.z[i]);
+			V dx = V::load(&packet.target.x[i]) - ex, dy = V::load(&packet.target.y[i]) - ey, dz = V::load(&packet.target.z[i]) - ez;
+			V a = dot(dx, dy, dz, dx, dy, dz);
+			V b = two * dot(ex, ey, ez, dx, dy, dz);
+			V c = dot(ex, ey, ez, ex, ey, ez) - c0;
+			V x0, x1;
+			typename V::Mask twice, once;
+			quadratic::compute_roots(a, b, c, x0, x1, twice, once);
+
+			V p1x = ex + x0 * dx, p1y = ey + x0 * dy, p1z = ez + x0 * dz;
+			V p2x = ex + x1 * dx, p2y = ey + x1 * dy, p2z = ez + x1 * dz;
+			V q1x = p1x - ex, q1y = p1y - ey, q1z = p1z - ez;
+			V q2x = p2x - ex, q2y = p2y - ey, q2z = p2z - ez;
+			auto swap = sqrt(dot(q1x, q1y, q1z, q1x, q1y, q1z)) > sqrt(dot(q2x, q2y, q2z, q2x, q2y, q2z));
+			V closerX = select(swap, p2x, p1x), closerY = select(swap, p2y, p1y), closerZ = select(swap, p2z, p1z);
+			V fartherX = select(swap, p1x, p2x), fartherY = select(swap, p1y, p2y), fartherZ = select(swap, p1z, p2z);
+			V closerScale = one / sqrt(dot(closerX, closerY, closerZ, closerX, closerY, closerZ));
+			V fartherScale = one / sqrt(dot(fartherX, fartherY, fartherZ, fartherX, fartherY, fartherZ));
+
+			closerX.store(&result.closerPosition.x[i]);
+			closerY.store(&result.closerPosition.y[i]);
+			closerZ.store(&result.closerPosition.z[i]);
+			(closerX * closerScale).store(&result.closerNormal.x[i]);
+			(closerY * closerScale).store(&result.closerNormal.y[i]);
+			(closerZ * closerScale).store(&result.closerNormal.z[i]);
+			fartherX.store(&result.fartherPosition.x[i]);
+			fartherY.store(&result.fartherPosition.y[i]);
+			fartherZ.store(&result.fartherPosition.z[i]);
+			(fartherX * fartherScale).store(&result.fartherNormal.x[i]);
+			(fartherY * fartherScale).store(&result.fartherNormal.y[i]);
+			(fartherZ * fartherScale).store(&result.fartherNormal.z[i]);
+			simd::store_count(&result.hits[i], twice, once);
+		}
+	}
+}
+
+template<size_t N>
+rgle::ray::PacketResult<N> rgle::ray::Plane::intersect(const RayPacket<N>& packet) const {
+	PacketResult<N> result;
+	intersect_plane<math::simd::Lanes<N>>(*this, packet, result);
+	return result;
+}
+
+template<size_t N>
+rgle::ray::PacketResult<N> rgle::ray::Ball::intersect(const RayPacket<N>& packet) const {
+	PacketResult<N> result;
+	intersect_ball<math::simd::Lanes<N>>(*this, packet, result);
+	return result;
+}
+
+template rgle::ray::PacketResult<4> rgle::ray::Plane::intersect<4>(const RayPacket<4>& packet) const;
+template rgle::ray::PacketResult<8> rgle::ray::Plane::intersect<8>(const RayPacket<8>& packet) const;
+template rgle::ray::PacketResult<16> rgle::ray::Plane::intersect<16>(const RayPacket<16>& packet) const;
+template rgle::ray::PacketResult<4> rgle::ray::Ball::intersect<4>(const RayPacket<4>& packet) const;
+template rgle::ray::PacketResult<8> rgle::ray::Ball::intersect<8>(const RayPacket<8>& packet) const;
+template rgle::ray::PacketResult<16> rgle::ray::Ball::intersect<16>(const RayPacket<16>& packet) const;
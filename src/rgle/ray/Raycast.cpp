@@ -1,4 +1,5 @@
 #include "rgle/ray/Raycast.h"
+#include "rgle/ray/Mesh.h"
 
 
 rgle::Ray::Ray()
@@ -17,18 +18,12 @@ rgle::Ray::~Ray()
 
 bool rgle::Ray::intersect(const glm::vec3& p1, const glm::vec3& p2, const glm::vec3& p3) const
 {
-	glm::vec3 n = glm::cross(p2 - p1, p3 - p2);
-	float denom = glm::dot(n, this->_p);
-	float r;
-	if (denom != 0.0f) {
-		r = glm::dot(n, p1 - this->_p) / denom;
-	}
-	else {
-		r = 0.0f;
-	}
-	glm::vec3 point = this->_p + r * this->_u;
-	glm::vec3 alpha = barycentric(p1, p2, p3, point);
-	return alpha.x <= 1.0 && alpha.x >= 0.0 && alpha.y <= 1.0 && alpha.y >= 0.0 && alpha.z <= 1.0 && alpha.z >= 0.0;
+	return ray::intersect_triangle(this->cast(), p1, p2, p3).has_value();
+}
+
+bool rgle::Ray::intersect(const ray::Mesh& mesh) const
+{
+	return mesh.closestHit(this->cast()).has_value();
 }
 
 bool rgle::Ray::intersect(const gfx::Geometry3D * geometry) const
@@ -36,16 +31,15 @@ bool rgle::Ray::intersect(const gfx::Geometry3D * geometry) const
 	if (geometry == nullptr) {
 		throw NullPointerException(LOGGER_DETAIL_DEFAULT);
 	}
-	for (int i = 0; i < geometry->triangleCount(); i++) {
-		if (this->intersect(
-			geometry->triangleVertex(i, gfx::Geometry3D::TrianglePoint::A),
-			geometry->triangleVertex(i, gfx::Geometry3D::TrianglePoint::B),
-			geometry->triangleVertex(i, gfx::Geometry3D::TrianglePoint::C)))
-		{
-			return true;
-		}
-	}
-	return false;
+	return this->intersect(ray::Mesh(*geometry));
+}
+
+rgle::ray::Ray rgle::Ray::cast() const
+{
+	return ray::Ray {
+		.eye = this->_p,
+		.target = this->_p + this->_u
+	};
 }
 
 glm::vec3 rgle::barycentric(const glm::vec3& p1, const glm::vec3& p2, const glm::vec3& p3, const glm::vec3& point)
@@ -54,7 +48,7 @@ glm::vec3 rgle::barycentric(const glm::vec3& p1, const glm::vec3& p2, const glm:
 	glm::vec3 v1 = p1 - p3;
 	glm::vec3 v2 = p2 - p3;
 	glm::vec3 alpha;
-	float denom = v1.x * v2.y - v2.x * v0.y;
+	float denom = v1.x * v2.y - v2.x * v1.y;
 	alpha.x = (v0.x * v2.y - v2.x * v0.y) / denom;
 	alpha.y = (v1.x * v0.y - v0.x * v1.y) / denom;
 	alpha.z = 1 - alpha.x - alpha.y;
@@ -123,6 +117,11 @@ rgle::ray::Intersect::~Intersect()
 {
 }
 
+rgle::ray::Bounds rgle::ray::Intersect::bounds() const
+{
+	return Bounds::infinite();
+}
+
 rgle::ray::Plane::Plane(glm::vec3 position, glm::vec3 normal) : position(position), normal(normal)
 {	
 }
@@ -222,6 +221,15 @@ rgle::ray::IntersectResult rgle::ray::Ball::intersect(const Ray& ray) const
 	return IntersectResult(Miss {});
 }
 
+rgle::ray::Bounds rgle::ray::Ball::bounds() const
+{
+	float r = std::abs(this->radius);
+	return Bounds {
+		.lower = glm::vec3(-r, -r, -r),
+		.upper = glm::vec3(r, r, r)
+	};
+}
+
 rgle::ray::RayTransform::RayTransform() : RayTransform(glm::mat4(1.0f))
 {}
 
@@ -247,13 +255,70 @@ rgle::ray::Intersection rgle::ray::RayTransform::applyBackward(const Intersectio
 
 std::optional<rgle::ray::Intersection> rgle::ray::Model::intersect(const Ray& ray) const
 {
+	return this->_intersect(ray, std::numeric_limits<float>::infinity());
+}
+
+std::optional<rgle::ray::Intersection> rgle::ray::Model::intersect(const Ray& ray, float maxDistance) const
+{
+	float deltaLength = glm::length(ray.delta());
+	float bound = deltaLength > 0.0f ? maxDistance / deltaLength : std::numeric_limits<float>::infinity();
+	auto intersect = this->_intersect(ray, bound);
+	if (intersect && intersect->distance(ray) <= maxDistance) {
+		return intersect;
+	}
+	return std::nullopt;
+}
+
+bool rgle::ray::Model::occluded(const Ray& ray, float maxDistance) const
+{
+	float deltaLength = glm::length(ray.delta());
+	return this->_occluded(ray, deltaLength > 0.0f ? maxDistance / deltaLength : std::numeric_limits<float>::infinity());
+}
+
+std::optional<rgle::ray::Intersection> rgle::ray::Model::_intersect(const Ray& ray, float bound) const
+{
+	if (!this->_reachable(ray, bound)) {
+		return std::nullopt;
+	}
 	if (auto val = std::get_if<Object>(this)) {
 		return val->object->intersect(ray).closest();
 	}
 	else if (auto val = std::get_if<Scene>(this)) {
 		std::optional<Intersection> closest = std::nullopt;
+		auto delta = ray.delta();
+		float deltaLength = glm::length(delta);
+		// Children are only evaluated up to the closest hit found so far
+		auto childBound = [&]() {
+			return closest.has_value() && deltaLength > 0.0f ? std::min(bound, closest->distance(ray) / deltaLength) : bound;
+		};
+		if (val->hierarchy) {
+			size_t closestIndex = 0;
+			float closestDistance = 0.0f;
+			float limit = _slack(bound);
+			val->hierarchy->traverse(
+				ray.eye,
+				delta,
+				-limit,
+				limit,
+				[&](size_t index, float& best) {
+					if (auto intersect = val->scene[index]._intersect(ray, childBound())) {
+						float distance = intersect->distance(ray);
+						// NOTE: ties resolve to the lowest index to match the order of a linear scan
+						if (!closest.has_value() || distance < closestDistance || (distance == closestDistance && index < closestIndex)) {
+							closest = std::move(intersect);
+							closestIndex = index;
+							closestDistance = distance;
+							if (deltaLength > 0.0f) {
+								best = _slack(distance / deltaLength);
+							}
+						}
+					}
+				}
+			);
+			return closest;
+		}
 		for (const auto& model : val->scene) {
-			if (auto intersect = model.intersect(ray)) {
+			if (auto intersect = model._intersect(ray, childBound())) {
 				if (closest.has_value()) {
 					if (intersect->distance(ray) < closest->distance(ray)) {
 						closest = std::move(intersect);
@@ -267,14 +332,15 @@ std::optional<rgle::ray::Intersection> rgle::ray::Model::intersect(const Ray& ra
 		return closest;
 	}
 	else if (auto val = std::get_if<Transform>(this)) {
+		// The parametric bound is unchanged by the affine transform
 		auto transformed = val->transform.applyForward(ray);
-		if (auto intersect = val->model->intersect(transformed)) {
+		if (auto intersect = val->model->_intersect(transformed, bound)) {
 			return val->transform.applyBackward(*intersect);
 		}
 		return std::nullopt;
 	}
 	else if (auto val = std::get_if<Clip>(this)) {
-		if (auto intersect = val->model->intersect(ray)) {
+		if (auto intersect = val->model->_intersect(ray, bound)) {
 			auto clipped = val->clipPlane.clip(intersect->position);
 			if (std::holds_alternative<Inside>(clipped)) {
 				return intersect;
@@ -283,8 +349,9 @@ std::optional<rgle::ray::Intersection> rgle::ray::Model::intersect(const Ray& ra
 		return std::nullopt;
 	}
 	else if (auto val = std::get_if<And>(this)) {
-		if (auto intersect1 = val->lhs->intersect(ray)) {
-			if (auto intersect2 = val->rhs->intersect(ray)) {
+		// NOTE: a farther hit on either side still decides whether the closer one is kept, so both sides are unbounded
+		if (auto intersect1 = val->lhs->_intersect(ray, std::numeric_limits<float>::infinity())) {
+			if (auto intersect2 = val->rhs->_intersect(ray, std::numeric_limits<float>::infinity())) {
 				if (intersect1->distance(ray) < intersect2->distance(ray)) {
 					return intersect1;
 				}
@@ -296,8 +363,13 @@ std::optional<rgle::ray::Intersection> rgle::ray::Model::intersect(const Ray& ra
 		return std::nullopt;
 	}
 	else if (auto val = std::get_if<Or>(this)) {
-		auto intersect1 = val->lhs->intersect(ray);
-		auto intersect2 = val->rhs->intersect(ray);
+		auto intersect1 = val->lhs->_intersect(ray, bound);
+		float bound2 = bound;
+		float deltaLength = glm::length(ray.delta());
+		if (intersect1 && deltaLength > 0.0f) {
+			bound2 = std::min(bound, intersect1->distance(ray) / deltaLength);
+		}
+		auto intersect2 = val->rhs->_intersect(ray, bound2);
 		if (intersect1 && intersect2) {
 			if (intersect1->distance(ray) < intersect2->distance(ray)) {
 				return intersect1;
@@ -316,3 +388,177 @@ std::optional<rgle::ray::Intersection> rgle::ray::Model::intersect(const Ray& ra
 	}
 	return std::nullopt;
 }
+
+bool rgle::ray::Model::_occluded(const Ray& ray, float bound) const
+{
+	const float inf = std::numeric_limits<float>::infinity();
+	if (!this->_reachable(ray, bound)) {
+		return false;
+	}
+	if (auto val = std::get_if<Object>(this)) {
+		auto intersect = val->object->intersect(ray).closest();
+		if (!intersect) {
+			return false;
+		}
+		return bound == inf || intersect->distance(ray) <= bound * glm::length(ray.delta());
+	}
+	else if (auto val = std::get_if<Scene>(this)) {
+		if (val->hierarchy) {
+			bool hit = false;
+			float limit = _slack(bound);
+			val->hierarchy->traverse(
+				ray.eye,
+				ray.delta(),
+				-limit,
+				limit,
+				[&](size_t index, float& best) {
+					if (!hit && val->scene[index]._occluded(ray, bound)) {
+						// Any hit ends the query, culling every remaining node
+						hit = true;
+						best = -inf;
+					}
+				}
+			);
+			return hit;
+		}
+		for (const auto& model : val->scene) {
+			if (model._occluded(ray, bound)) {
+				return true;
+			}
+		}
+		return false;
+	}
+	else if (auto val = std::get_if<Transform>(this)) {
+		return val->model->_occluded(val->transform.applyForward(ray), bound);
+	}
+	else if (auto val = std::get_if<Clip>(this)) {
+		// Only the closest hit of the clipped model is tested against the plane, so it has to be found
+		if (auto intersect = val->model->_intersect(ray, bound)) {
+			if (std::holds_alternative<Inside>(val->clipPlane.clip(intersect->position))) {
+				return bound == inf || intersect->distance(ray) <= bound * glm::length(ray.delta());
+			}
+		}
+		return false;
+	}
+	else if (auto val = std::get_if<And>(this)) {
+		if (val->lhs->_occluded(ray, bound)) {
+			return val->rhs->_occluded(ray, inf);
+		}
+		return val->lhs->_occluded(ray, inf) && val->rhs->_occluded(ray, bound);
+	}
+	else if (auto val = std::get_if<Or>(this)) {
+		return val->lhs->_occluded(ray, bound) || val->rhs->_occluded(ray, bound);
+	}
+	return false;
+}
+
+bool rgle::ray::Model::_reachable(const Ray& ray, float bound) const
+{
+	if (!this->cachedBounds) {
+		return true;
+	}
+	if (this->cachedBounds->isEmpty()) {
+		return false;
+	}
+	if (!this->cachedBounds->isBounded()) {
+		return true;
+	}
+	auto interval = this->cachedBounds->clip(ray.eye, ray.delta());
+	if (!interval) {
+		return false;
+	}
+	// Smallest |t| inside the box, hits are ordered by their distance to the eye on either side of it
+	float near = 0.0f;
+	if (interval->x > 0.0f) {
+		near = interval->x;
+	}
+	else if (interval->y < 0.0f) {
+		near = -interval->y;
+	}
+	return near <= _slack(bound);
+}
+
+float rgle::ray::Model::_slack(float bound)
+{
+	// Keep a little slack so rounding in derived bounds never culls a hit at the bound
+	return (1.0f + 1e-5f) * bound;
+}
+
+rgle::ray::Bounds rgle::ray::Model::bounds() const
+{
+	if (this->cachedBounds) {
+		return *this->cachedBounds;
+	}
+	if (auto val = std::get_if<Object>(this)) {
+		return val->object->bounds();
+	}
+	else if (auto val = std::get_if<Scene>(this)) {
+		Bounds result = Bounds::empty();
+		for (const auto& model : val->scene) {
+			result = result.merge(model.bounds());
+		}
+		return result;
+	}
+	else if (auto val = std::get_if<Transform>(this)) {
+		return val->model->bounds().transform(val->transform.affine);
+	}
+	else if (auto val = std::get_if<Clip>(this)) {
+		return val->model->bounds();
+	}
+	else if (auto val = std::get_if<And>(this)) {
+		return val->lhs->bounds().merge(val->rhs->bounds());
+	}
+	else if (auto val = std::get_if<Or>(this)) {
+		return val->lhs->bounds().merge(val->rhs->bounds());
+	}
+	return Bounds::infinite();
+}
+
+void rgle::ray::Scene::build(HierarchyOptions options)
+{
+	std::vector<Bounds> bounds;
+	bounds.reserve(this->scene.size());
+	for (const auto& model : this->scene) {
+		bounds.push_back(model.bounds());
+	}
+	this->hierarchy = std::make_shared<BoundingVolumeHierarchy>(bounds, options);
+}
+
+void rgle::ray::Scene::update(size_t handle, const RayTransform& transform)
+{
+	if (handle >= this->scene.size()) {
+		throw IllegalArgumentException("scene handle out of range", LOGGER_DETAIL_DEFAULT);
+	}
+	auto& model = this->scene[handle];
+	auto val = std::get_if<Transform>(&model);
+	if (val == nullptr) {
+		throw IllegalArgumentException("only transformed scene children can be updated", LOGGER_DETAIL_DEFAULT);
+	}
+	val->transform = transform;
+	if (model.cachedBounds) {
+		// The cached bounds of an optimized child are in scene space, those of its subtree are unaffected
+		model.cachedBounds.reset();
+		model.cachedBounds = model.bounds().padRelative();
+	}
+}
+
+bool rgle::ray::Scene::refit()
+{
+	if (!this->hierarchy) {
+		return false;
+	}
+	std::vector<Bounds> bounds;
+	bounds.reserve(this->scene.size());
+	for (const auto& model : this->scene) {
+		bounds.push_back(model.bounds());
+	}
+	auto options = this->hierarchy->options();
+	// Compiled models share the hierarchy, refit a copy so they keep traversing the bounds they were compiled with
+	auto refitted = this->hierarchy.use_count() > 1 ? std::make_shared<BoundingVolumeHierarchy>(*this->hierarchy) : this->hierarchy;
+	if (refitted->refit(bounds) && !(refitted->cost() > options.rebuildThreshold * refitted->buildCost())) {
+		this->hierarchy = refitted;
+		return false;
+	}
+	this->hierarchy = std::make_shared<BoundingVolumeHierarchy>(bounds, options);
+	return true;
+}
\ No newline at end of file
@@ -2,12 +2,24 @@
 
 #include "rgle/gfx/Graphics.h"
 #include "rgle/math/Quadratic.h"
+#include "rgle/ray/BoundingVolume.h"
 
 namespace rgle {
 
+	namespace ray {
+		class Ray;
+		class Mesh;
+	}
+
+	namespace sync {
+		class ThreadPool;
+	}
+
 	// Calculate barycentric coordinates using Cramer's rule to solve the system: p = a1p1 + a2p2 + a3p3, a1 + a2 + a3 = 1
+	// @note only the x and y components are used, the triangle and point are projected onto the xy plane
 	glm::vec3 barycentric(const glm::vec3& p1, const glm::vec3& p2, const glm::vec3& p3, const glm::vec3& point);
 
+	// Picking ray starting at p and travelling along u
 	class Ray {
 	public:
 		Ray();
@@ -15,8 +27,12 @@ namespace rgle {
 		virtual ~Ray();
 
 		bool intersect(const glm::vec3& p1, const glm::vec3& p2, const glm::vec3& p3) const;
+		bool intersect(const ray::Mesh& mesh) const;
+		// Builds a ray::Mesh over the geometry for a single query, keep a ray::Mesh for repeated picking
 		bool intersect(const gfx::Geometry3D* geometry) const;
 
+		ray::Ray cast() const;
+
 	private:
 		glm::vec3 _u;
 		glm::vec3 _p;
@@ -74,11 +90,88 @@ namespace rgle {
 			std::optional<Intersection> farthest() const;
 		};
 
+		// Structure of arrays storage for N vectors, one lane per vector
+		template<size_t N>
+		struct Vec3Lanes {
+			glm::vec3 get(size_t lane) const {
+				return glm::vec3(this->x[lane], this->y[lane], this->z[lane]);
+			}
+
+			void set(size_t lane, const glm::vec3& value) {
+				this->x[lane] = value.x;
+				this->y[lane] = value.y;
+				this->z[lane] = value.z;
+			}
+
+			alignas(64) std::array<float, N> x;
+			alignas(64) std::array<float, N> y;
+			alignas(64) std::array<float, N> z;
+		};
+
+		// A packet of N rays stored in structure of arrays layout for vectorized intersection
+		template<size_t N>
+		struct RayPacket {
+			static_assert(N == 4 || N == 8 || N == 16, "ray packets hold 4, 8 or 16 rays");
+
+			Ray get(size_t lane) const {
+				return Ray {
+					.eye = this->eye.get(lane),
+					.target = this->target.get(lane)
+				};
+			}
+
+			void set(size_t lane, const Ray& ray) {
+				this->eye.set(lane, ray.eye);
+				this->target.set(lane, ray.target);
+			}
+
+			Vec3Lanes<N> eye;
+			Vec3Lanes<N> target;
+		};
+
+		// Result of intersecting a ray packet, lane i matches the IntersectResult of intersecting ray i alone
+		template<size_t N>
+		struct PacketResult {
+			IntersectResult get(size_t lane) const {
+				if (this->hits[lane] == 2) {
+					return IntersectResult(HitTwice {
+						.closer = Intersection {
+							.position = this->closerPosition.get(lane),
+							.normal = this->closerNormal.get(lane)
+						},
+						.farther = Intersection {
+							.position = this->fartherPosition.get(lane),
+							.normal = this->fartherNormal.get(lane)
+						}
+					});
+				}
+				else if (this->hits[lane] == 1) {
+					return IntersectResult(HitOnce {
+						.hit = Intersection {
+							.position = this->closerPosition.get(lane),
+							.normal = this->closerNormal.get(lane)
+						}
+					});
+				}
+				return IntersectResult(Miss {});
+			}
+
+			// Number of hits per lane, the farther intersection is only valid for lanes hit twice
+			alignas(64) std::array<int32_t, N> hits;
+			Vec3Lanes<N> closerPosition;
+			Vec3Lanes<N> closerNormal;
+			Vec3Lanes<N> fartherPosition;
+			Vec3Lanes<N> fartherNormal;
+		};
+
 		class Intersect {
 		public:
 			virtual ~Intersect() = 0;
 
 			virtual IntersectResult intersect(const Ray& ray) const = 0;
+
+			// Computes the local space bounds of the object, objects are unbounded unless overridden
+			virtual Bounds bounds() const;
 		};
 
 		struct Inside {
@@ -100,6 +193,10 @@ namespace rgle {
 
 			virtual IntersectResult intersect(const Ray& ray) const override;
 
+			// Intersects a packet of 4, 8 or 16 rays using the widest available vector instructions
+			template<size_t N>
+			PacketResult<N> intersect(const RayPacket<N>& packet) const;
+
 			ClipResult clip(const glm::vec3& point) const;
 
 			glm::vec3 position;
@@ -113,6 +210,12 @@ namespace rgle {
 
 			virtual IntersectResult intersect(const Ray& ray) const override;
 
+			// Intersects a packet of 4, 8 or 16 rays using the widest available vector instructions
+			template<size_t N>
+			PacketResult<N> intersect(const RayPacket<N>& packet) const;
+
+			virtual Bounds bounds() const override;
+
 			float radius;
 		};
 
@@ -136,7 +239,22 @@ namespace rgle {
 		};
 
 		struct Scene {
+			// Builds a bounding volume hierarchy over the world space bounds of the scene's children
+			// @note the hierarchy must be rebuilt after the children are modified
+			void build(HierarchyOptions options = HierarchyOptions{});
+
+			// Replaces the transform of a child, the handle is the child's index in the scene
+			// @note the child must be a Transform, call refit() once all children of the frame are updated, the cached
+			// bounds of an optimized model holding the scene are not updated
+			void update(size_t handle, const RayTransform& transform);
+
+			// Refits the hierarchy to the current bounds of the children, rebuilding it when the refitted cost exceeds
+			// the rebuild threshold of its options or a child changed between bounded and unbounded
+			// @returns true if the hierarchy was rebuilt
+			bool refit();
+
 			std::vector<Model> scene;
+			std::shared_ptr<BoundingVolumeHierarchy> hierarchy;
 		};
 
 		struct Transform {
@@ -165,8 +283,51 @@ namespace rgle {
 			using base_type::variant;
 
 			std::optional<Intersection> intersect(const Ray& ray) const;
+			// Finds the same intersection as intersect(ray) if it lies within maxDistance of the eye
+			// @remarks subtrees that can only hold hits beyond maxDistance, or beyond the closest hit found so far, are skipped
+			std::optional<Intersection> intersect(const Ray& ray, float maxDistance) const;
+
+			// Any hit query, returns as soon as it finds a hit proving intersect(ray) lies within maxDistance of the eye
+			bool occluded(const Ray& ray, float maxDistance) const;
+
+			// Intersects a batch of rays, results[i] receives intersect(rays[i])
+			// @remarks
+			// Rays are sorted by the Morton code of their eye and direction and every node is applied to the whole batch,
+			// transforms included, rays are compacted out of the batch once they miss the lhs of an And or the bounds of
+			// a scene's child
+			void intersect(std::span<const Ray> rays, std::span<std::optional<Intersection>> results) const;
+			// Intersects a batch of rays, the sorted batch is split in chunks which are intersected in parallel on the pool
+			// @throws the first exception thrown while intersecting a chunk, once every chunk has returned or been skipped
+			void intersect(std::span<const Ray> rays, std::span<std::optional<Intersection>> results, sync::ThreadPool& pool) const;
+
+			Bounds bounds() const;
+
+			// Conservative bounds in the space the node is intersected in, attached by optimize() to skip rays missing them
+			// @note stale once the model is modified, optimize the model again after changing it
+			std::optional<Bounds> cachedBounds;
+
+		private:
+			// Tests the ray against the cached bounds, hits beyond the parametric bound are treated as unreachable
+			bool _reachable(const Ray& ray, float bound) const;
+
+			// Bounds are parametric so they are unchanged by transforms, a bound b admits hits with |t| <= b
+			// @returns the same result as intersect(ray) whenever its parameter lies within the bound
+			std::optional<Intersection> _intersect(const Ray& ray, float bound) const;
+			bool _occluded(const Ray& ray, float bound) const;
+			// Intersects a batch of rays in the given order, rays missing the cached bounds are compacted out first
+			void _intersectBatch(std::span<const Ray> rays, std::span<std::optional<Intersection>> results) const;
+			void _evaluateBatch(std::span<const Ray> rays, std::span<std::optional<Intersection>> results) const;
+
+			static float _slack(float bound);
 		};
 
+		// Optimizes a model for intersection
+		// @remarks
+		// Nested transforms are concatenated, subtrees which can never be hit, such as those a clip plane cuts away
+		// entirely, are dropped and every node gets cached bounds, results match the source model up to the rounding of
+		// the concatenated transforms
+		Model optimize(Model&& model);
+
 		template<typename T>
 		concept Intersectable = std::is_base_of<Intersect, T>::value;
 
@@ -0,0 +1,112 @@
+#include "rgle/ray/Renderer.h"
+#include "rgle/math/Morton.h"
+
+rgle::ray::Ray rgle::ray::PinholeCamera::generate(size_t x, size_t y, size_t width, size_t height) const
+{
+	float aspect = static_cast<float>(width) / static_cast<float>(height);
+	float scale = std::tan(0.5f * this->fov);
+	float u = (2.0f * (static_cast<float>(x) + 0.5f) / static_cast<float>(width) - 1.0f) * aspect * scale;
+	float v = (1.0f - 2.0f * (static_cast<float>(y) + 0.5f) / static_cast<float>(height)) * scale;
+	auto forward = glm::normalize(this->direction);
+	auto right = glm::normalize(glm::cross(forward, this->up));
+	auto up = glm::cross(right, forward);
+	return Ray {
+		.eye = this->position,
+		.target = this->position + forward + u * right + v * up
+	};
+}
+
+double rgle::ray::RenderStatistics::raysPerSecond() const
+{
+	if (this->seconds <= 0.0) {
+		return 0.0;
+	}
+	return static_cast<double>(this->rays) / this->seconds;
+}
+
+rgle::ray::Renderer::Renderer(RenderOptions options) : Renderer(std::make_shared<sync::ThreadPool>(), options)
+{
+}
+
+rgle::ray::Renderer::Renderer(std::shared_ptr<sync::ThreadPool> pool, RenderOptions options) : _pool(pool), _options(options)
+{
+	if (this->_pool == nullptr) {
+		throw NullPointerException(LOGGER_DETAIL_DEFAULT);
+	}
+}
+
+rgle::ray::RenderStatistics rgle::ray::Renderer::render(const Model& model, const PinholeCamera& camera, gfx::Image8& image) const
+{
+	auto start = std::chrono::steady_clock::now();
+	auto stats = this->render(CompiledModel(model), camera, image);
+	stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	return stats;
+}
+
+rgle::ray::RenderStatistics rgle::ray::Renderer::render(const CompiledModel& compiled, const PinholeCamera& camera, gfx::Image8& image) const
+{
+	if (image.image == nullptr || image.channelSize != 1 || (image.channels != 3 && image.channels != 4)) {
+		throw IllegalArgumentException("ray renderer requires an 8 bit RGB or RGBA image", LOGGER_DETAIL_DEFAULT);
+	}
+	if (this->_options.tileSize == 0) {
+		throw IllegalArgumentException("ray renderer tile size must be positive", LOGGER_DETAIL_DEFAULT);
+	}
+	auto start = std::chrono::steady_clock::now();
+
+	size_t tilesX = (image.width + this->_options.tileSize - 1) / this->_options.tileSize;
+	size_t tilesY = (image.height + this->_options.tileSize - 1) / this->_options.tileSize;
+	std::vector<std::pair<uint32_t, uint32_t>> tiles;
+	tiles.reserve(tilesX * tilesY);
+	for (size_t y = 0; y < tilesY; y++) {
+		for (size_t x = 0; x < tilesX; x++) {
+			tiles.push_back({ math::morton::encode_2d(static_cast<uint32_t>(x), static_cast<uint32_t>(y)), static_cast<uint32_t>(y * tilesX + x) });
+		}
+	}
+	std::sort(tiles.begin(), tiles.end());
+
+	// Jobs are queued in order, so the tiles start in Z-order
+	this->_pool->runJobs(tiles.size(), [this, &tiles, &compiled, &camera, &image, tilesX](size_t i) {
+		size_t x0 = (tiles[i].second % tilesX) * this->_options.tileSize;
+		size_t y0 = (tiles[i].second / tilesX) * this->_options.tileSize;
+		this->_renderTile(compiled, camera, image, x0, y0);
+	});
+
+	return RenderStatistics {
+		.rays = image.width * image.height,
+		.tiles = tiles.size(),
+		.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count()
+	};
+}
+
+rgle::ray::RenderOptions& rgle::ray::Renderer::options()
+{
+	return this->_options;
+}
+
+const rgle::ray::RenderOptions& rgle::ray::Renderer::options() const
+{
+	return this->_options;
+}
+
+void rgle::ray::Renderer::_renderTile(const CompiledModel& model, const PinholeCamera& camera, gfx::Image8& image, size_t x0, size_t y0) const
+{
+	auto light = -glm::normalize(this->_options.lightDirection);
+	size_t x1 = std::min(x0 + this->_options.tileSize, image.width);
+	size_t y1 = std::min(y0 + this->_options.tileSize, image.height);
+	for (size_t y = y0; y < y1; y++) {
+		for (size_t x = x0; x < x1; x++) {
+			auto color = this->_options.background;
+			if (auto intersect = model.intersect(camera.generate(x, y, image.width, image.height))) {
+				float diffuse = std::max(glm::dot(intersect->normal, light), 0.0f);
+				color = this->_options.color * (this->_options.ambient + (1.0f - this->_options.ambient) * diffuse);
+			}
+			color = glm::clamp(color, 0.0f, 1.0f);
+			if (image.channels == 4) {
+				image.set(x, y, glm::vec4(color, 1.0f));
+			}
+			else {
+				image.set(x, y, color);
+			}
+		}
+	}
+}
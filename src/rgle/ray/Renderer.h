@@ -0,0 +1,63 @@
+#pragma once
+
+#include "rgle/ray/CompiledModel.h"
+#include "rgle/sync/Thread.h"
+
+namespace rgle::ray {
+
+	// Pinhole camera generating one primary ray through the center of every pixel
+	struct PinholeCamera {
+		// Computes the ray through pixel (x, y) of a width by height image, y grows downwards
+		Ray generate(size_t x, size_t y, size_t width, size_t height) const;
+
+		glm::vec3 position = glm::vec3(0.0f, 0.0f, 0.0f);
+		glm::vec3 direction = glm::vec3(0.0f, 0.0f, 1.0f);
+		glm::vec3 up = glm::vec3(0.0f, 1.0f, 0.0f);
+		// Vertical field of view in radians
+		float fov = glm::radians(60.0f);
+	};
+
+	struct RenderOptions {
+		// Width and height in pixels of the square tiles scheduled on the thread pool
+		size_t tileSize = 16;
+		// Direction the light travels in, shading is lambertian plus a constant ambient term
+		glm::vec3 lightDirection = glm::vec3(-0.5f, -1.0f, 1.0f);
+		float ambient = 0.1f;
+		glm::vec3 color = glm::vec3(1.0f, 1.0f, 1.0f);
+		glm::vec3 background = glm::vec3(0.0f, 0.0f, 0.0f);
+	};
+
+	struct RenderStatistics {
+		double raysPerSecond() const;
+
+		size_t rays = 0;
+		size_t tiles = 0;
+		double seconds = 0.0;
+	};
+
+	// Headless CPU renderer tracing one primary ray per pixel of a ray::Model
+	// @remarks
+	// The model is compiled once per frame unless it is passed compiled, and the image is split in tiles which are queued on the thread pool in
+	// Z-order so neighbouring tiles, and the nodes of the model they touch, are traced close together in time
+	class Renderer {
+	public:
+		Renderer(RenderOptions options = RenderOptions{});
+		Renderer(std::shared_ptr<sync::ThreadPool> pool, RenderOptions options = RenderOptions{});
+
+		// Renders the model into an 8 bit RGB or RGBA image, the image size sets the resolution
+		// @returns the number of rays traced and the time spent tracing them
+		// @throws the first exception thrown while tracing a tile, once every queued tile has finished or been skipped
+		RenderStatistics render(const Model& model, const PinholeCamera& camera, gfx::Image8& image) const;
+		// Same as render(const Model&, ...) without compiling the model again, for models rendered over many frames
+		RenderStatistics render(const CompiledModel& model, const PinholeCamera& camera, gfx::Image8& image) const;
+
+		RenderOptions& options();
+		const RenderOptions& options() const;
+
+	private:
+		void _renderTile(const CompiledModel& model, const PinholeCamera& camera, gfx::Image8& image, size_t x0, size_t y0) const;
+
+		std::shared_ptr<sync::ThreadPool> _pool;
+		RenderOptions _options;
+	};
+}
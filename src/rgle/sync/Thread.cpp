@@ -39,11 +39,48 @@ void rgle::sync::ThreadPool::startJob(std::function<void()> job)
 	this->_workerCondition.notify_one();
 }
 
+void rgle::sync::ThreadPool::runJobs(size_t count, const std::function<void(size_t)>& job)
+{
+	std::atomic_size_t remaining = count;
+	// An exception leaving a job would terminate the worker, the first one is kept and the remaining jobs are skipped
+	std::atomic_bool failed = false;
+	std::exception_ptr error;
+	std::mutex errorMutex;
+	for (size_t i = 0; i < count; i++) {
+		this->startJob([&job, &remaining, &failed, &error, &errorMutex, i]() {
+			if (!failed) {
+				try {
+					job(i);
+				}
+				catch (...) {
+					std::lock_guard<std::mutex> lock(errorMutex);
+					if (!error) {
+						error = std::current_exception();
+					}
+					failed = true;
+				}
+			}
+			remaining--;
+		});
+	}
+	while (remaining > 0) {
+		std::this_thread::yield();
+	}
+	if (error) {
+		std::rethrow_exception(error);
+	}
+}
+
 bool rgle::sync::ThreadPool::standBy()
 {
 	return this->_jobQueue.empty() && this->_activeWorkers == 0;
 }
 
+size_t rgle::sync::ThreadPool::size() const
+{
+	return this->_workers.size();
+}
+
 void rgle::sync::ThreadPool::_threadLoop()
 {
 	while (this->_alive) {
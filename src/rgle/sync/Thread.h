@@ -15,9 +15,15 @@ namespace rgle::sync {
 		~ThreadPool();
 
 		void startJob(std::function<void()> job);
+		// Runs job(0) to job(count - 1) on the pool and waits for them, must not be called from a job of the same pool
+		// @throws the first exception thrown by a job, once every job has returned or been skipped after it
+		void runJobs(size_t count, const std::function<void(size_t)>& job);
 
 		bool standBy();
 
+		// Number of worker threads
+		size_t size() const;
+
 	private:
 		void _threadLoop();
 
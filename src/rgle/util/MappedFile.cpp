@@ -0,0 +1,108 @@
+#include "rgle/util/MappedFile.h"
+
+#if defined _WIN32 || defined _WIN64
+	#pragma warning(push, 0)
+	#include <windows.h>
+	#pragma warning(pop)
+
+	// Workaround for windows.h defining ERROR which conflicts with LogLevel::ERROR
+	#undef ERROR
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+rgle::util::MappedFile::MappedFile(const std::string& filename, bool sequential) : _data(nullptr), _size(0)
+{
+#if defined _WIN32 || defined _WIN64
+	this->_mapping = nullptr;
+	this->_file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, sequential ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_FLAG_RANDOM_ACCESS, nullptr);
+	if (this->_file == INVALID_HANDLE_VALUE) {
+		throw IOException("could not open file: " + filename, LOGGER_DETAIL_DEFAULT);
+	}
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(this->_file, &size)) {
+		this->_unmap();
+		throw IOException("could not read the size of file: " + filename, LOGGER_DETAIL_DEFAULT);
+	}
+	this->_size = static_cast<size_t>(size.QuadPart);
+	if (this->_size > 0) {
+		this->_mapping = CreateFileMappingA(this->_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (this->_mapping != nullptr) {
+			this->_data = static_cast<const unsigned char*>(MapViewOfFile(this->_mapping, FILE_MAP_READ, 0, 0, 0));
+		}
+		if (this->_data == nullptr) {
+			this->_unmap();
+			throw IOException("could not map file: " + filename, LOGGER_DETAIL_DEFAULT);
+		}
+	}
+#else
+	int file = open(filename.c_str(), O_RDONLY);
+	if (file < 0) {
+		throw IOException("could not open file: " + filename, LOGGER_DETAIL_DEFAULT);
+	}
+	struct stat status;
+	if (fstat(file, &status) != 0) {
+		close(file);
+		throw IOException("could not read the size of file: " + filename, LOGGER_DETAIL_DEFAULT);
+	}
+	this->_size = static_cast<size_t>(status.st_size);
+	if (this->_size > 0) {
+		void* data = mmap(nullptr, this->_size, PROT_READ, MAP_PRIVATE, file, 0);
+		if (data == MAP_FAILED) {
+			close(file);
+			throw IOException("could not map file: " + filename, LOGGER_DETAIL_DEFAULT);
+		}
+		if (sequential) {
+			madvise(data, this->_size, MADV_SEQUENTIAL);
+			madvise(data, this->_size, MADV_WILLNEED);
+		}
+		else {
+			madvise(data, this->_size, MADV_RANDOM);
+		}
+		this->_data = static_cast<const unsigned char*>(data);
+	}
+	// NOTE: the mapping keeps its own reference to the file
+	close(file);
+#endif
+}
+
+rgle::util::MappedFile::~MappedFile()
+{
+	this->_unmap();
+}
+
+const unsigned char* rgle::util::MappedFile::data() const
+{
+	return this->_data;
+}
+
+size_t rgle::util::MappedFile::size() const
+{
+	return this->_size;
+}
+
+void rgle::util::MappedFile::_unmap()
+{
+#if defined _WIN32 || defined _WIN64
+	if (this->_data != nullptr) {
+		UnmapViewOfFile(this->_data);
+	}
+	if (this->_mapping != nullptr) {
+		CloseHandle(this->_mapping);
+	}
+	if (this->_file != INVALID_HANDLE_VALUE) {
+		CloseHandle(this->_file);
+	}
+	this->_mapping = nullptr;
+	this->_file = INVALID_HANDLE_VALUE;
+#else
+	if (this->_data != nullptr) {
+		munmap(const_cast<unsigned char*>(this->_data), this->_size);
+	}
+#endif
+	this->_data = nullptr;
+	this->_size = 0;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "rgle/Exception.h"
+
+namespace rgle::util {
+
+	// Read only memory mapping of a whole file, pages are read from disk on first access
+	class MappedFile {
+	public:
+		// @param sequential hints the file is read front to back, so the system reads ahead
+		MappedFile(const std::string& filename, bool sequential = false);
+		MappedFile(const MappedFile&) = delete;
+		MappedFile(MappedFile&&) = delete;
+		~MappedFile();
+
+		void operator=(const MappedFile&) = delete;
+		void operator=(MappedFile&&) = delete;
+
+		// @returns the first byte of the file, nullptr for an empty file
+		const unsigned char* data() const;
+		size_t size() const;
+
+	private:
+		void _unmap();
+
+		const unsigned char* _data;
+		size_t _size;
+#if defined _WIN32 || defined _WIN64
+		void* _file;
+		void* _mapping;
+#endif
+	};
+}
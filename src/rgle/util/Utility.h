@@ -42,84 +42,131 @@ namespace rgle::util {
 		}
 	};
 
+	// Ordered set of disjoint half open ranges, adjacent and overlapping ranges are merged on insertion
+	// @remarks
+	// Ranges are kept in a balanced tree keyed by their lower bound, so inserting a value or a range takes logarithmic
+	// time in the number of ranges plus the ranges it merges with
 	template<typename Type>
-	class CollectingQueue {
+	class IntervalSet {
 	public:
-		CollectingQueue() {}
-		CollectingQueue(const Range<Type>& range) : _queue{ range } {}
+		class Iterator {
+		public:
+			using iterator_category = std::forward_iterator_tag;
+			using value_type = Range<Type>;
+			using difference_type = std::ptrdiff_t;
+			using pointer = const Range<Type>*;
+			using reference = Range<Type>;
+
+			Iterator(typename std::map<Type, Type>::const_iterator current) : _current(current) {}
+
+			Range<Type> operator*() const {
+				return Range<Type>{ this->_current->first, this->_current->second };
+			}
+
+			Iterator& operator++() {
+				this->_current++;
+				return *this;
+			}
+
+			Iterator operator++(int) {
+				Iterator result = *this;
+				this->_current++;
+				return result;
+			}
+
+			bool operator==(const Iterator& other) const {
+				return this->_current == other._current;
+			}
+
+		private:
+			typename std::map<Type, Type>::const_iterator _current;
+		};
+
+		IntervalSet() {}
+		IntervalSet(const Range<Type>& range) {
+			this->insert(range);
+		}
 
 		void push(const Type& value) {
-			if (this->_queue.empty()) {
-				this->_queue.push_back(Range<Type>{ value, value + unity<Type>() });
+			this->insert(Range<Type>{ value, value + unity<Type>() });
+		}
+
+		void insert(const Range<Type>& range) {
+			if (!(range.lower < range.upper)) {
+				return;
 			}
-			else {
-				size_t idx = this->_queue.size() / 2;
-				size_t half = static_cast<size_t>(std::ceil(this->_queue.size() / 4.0f));
-				while (idx < this->size() && !this->_queue[idx].in(value) && std::ceil(half / 2.0f) != half) {
-					if (value > this->_queue[idx].lower) {
-						idx += half;
-					}
-					else {
-						idx -= half;
+			auto next = this->_ranges.upper_bound(range.lower);
+			if (next != this->_ranges.begin()) {
+				auto previous = std::prev(next);
+				if (!(previous->second < range.lower)) {
+					if (previous->second < range.upper) {
+						previous->second = range.upper;
+						this->_absorb(previous);
 					}
-					half = static_cast<size_t>(std::ceil(half / 2.0f));
+					return;
 				}
-				this->_insert(value, std::min(this->size() - 1, idx));
 			}
+			if (next != this->_ranges.end() && !(range.upper < next->first)) {
+				// NOTE: the node of the range starting inside is reused, keys can only change while extracted
+				auto node = this->_ranges.extract(next);
+				node.key() = range.lower;
+				if (node.mapped() < range.upper) {
+					node.mapped() = range.upper;
+				}
+				this->_absorb(this->_ranges.insert(std::move(node)).position);
+				return;
+			}
+			this->_ranges.emplace_hint(next, range.lower, range.upper);
 		}
 
+		// Removes and returns the highest range
 		Range<Type> pop() {
-			Range<Type> result = this->_queue.back();
-			this->_queue.pop_back();
+			auto last = std::prev(this->_ranges.end());
+			Range<Type> result = { last->first, last->second };
+			this->_ranges.erase(last);
 			return result;
 		}
 
+		bool contains(const Type& value) const {
+			auto next = this->_ranges.upper_bound(value);
+			return next != this->_ranges.begin() && value < std::prev(next)->second;
+		}
+
+		// Number of disjoint ranges
 		size_t size() const {
-			return this->_queue.size();
+			return this->_ranges.size();
 		}
 
 		bool empty() const {
-			return this->_queue.empty();
+			return this->_ranges.empty();
 		}
 
 		void clear() {
-			this->_queue.clear();
+			this->_ranges.clear();
+		}
+
+		// Iterates the ranges in ascending order
+		Iterator begin() const {
+			return Iterator(this->_ranges.begin());
+		}
+
+		Iterator end() const {
+			return Iterator(this->_ranges.end());
 		}
 
 	private:
-		void _insert(const Type& value, const size_t& where) {
-			Range<Type>& at = this->_queue[where];
-			if (!at.in(value)) {
-				if (where > 0 && value == this->_queue[where - 1].upper) {
-					Range<Type>& before = this->_queue[where - 1];
-					before.upper++;
-					if (at.lower == before.upper) {
-						Range<Type> merge = { before.lower, at.upper };
-						this->_queue[where - 1] = merge;
-						this->_queue.erase(this->_queue.begin() + where);
-					}
-				}
-				else if (value == at.lower - unity<Type>()) {
-					at.lower--;
-				}
-				else if (where < this->_queue.size() - 1 && value == this->_queue[where + 1].lower - 1) {
-					Range<Type>& after = this->_queue[where + 1];
-					after.lower--;
-					if (at.upper == after.lower) {
-						Range<Type> merge = { at.lower, after.upper };
-						after = merge;
-						this->_queue.erase(this->_queue.begin() + where);
-					}
-				}
-				else if (value == at.upper) {
-					at.upper++;
-				}
-				else {
-					this->_queue.insert(this->_queue.begin() + where, Range<Type>{ value, value + unity<Type>() });
+		// Merges the ranges following current that start before its end into it
+		void _absorb(typename std::map<Type, Type>::iterator current) {
+			auto next = std::next(current);
+			while (next != this->_ranges.end() && !(current->second < next->first)) {
+				if (current->second < next->second) {
+					current->second = next->second;
 				}
+				next = this->_ranges.erase(next);
 			}
 		}
 
-		std::vector<Range<Type>> _queue;
+		// Upper bound of each range by its lower bound
+		std::map<Type, Type> _ranges;
 	};
 }
\ No newline at end of file
@@ -1,5 +1,91 @@
 #include "rgle.h"
 
+template<size_t N, typename Object>
+bool packet_matches(const Object& object, const std::vector<rgle::ray::Ray>& rays) {
+  for (size_t i = 0; i + N <= rays.size(); i += N) {
+    rgle::ray::RayPacket<N> packet;
+    for (size_t lane = 0; lane < N; lane++) {
+      packet.set(lane, rays[i + lane]);
+    }
+    auto result = object.intersect(packet);
+    for (size_t lane = 0; lane < N; lane++) {
+      if (result.get(lane) != object.intersect(rays[i + lane])) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+class ThrowingObject : public rgle::ray::Intersect {
+public:
+  virtual rgle::ray::IntersectResult intersect(const rgle::ray::Ray& ray) const override {
+    throw std::runtime_error("throwing object");
+  }
+};
+
+// A ball that no ray hits, compiled models must call it instead of copying it as a plain ball
+class HollowBall : public rgle::ray::Ball {
+public:
+  HollowBall() : Ball(1.0f) {}
+
+  virtual rgle::ray::IntersectResult intersect(const rgle::ray::Ray& ray) const override {
+    return rgle::ray::IntersectResult(rgle::ray::Miss {});
+  }
+};
+
+// Dyadic models only use power of two scales and translations in quarter steps, so transforms and their inverses
+// concatenate without rounding
+rgle::ray::Model random_model(int depth, std::mt19937& random, bool dyadic = false) {
+  std::uniform_int_distribution<int> kind(0, depth > 0 ? 6 : 1);
+  std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+  auto child = [&]() {
+    return std::make_unique<rgle::ray::Model>(random_model(depth - 1, random, dyadic));
+  };
+  switch (kind(random)) {
+  case 0:
+    return rgle::ray::Model(rgle::ray::Object { .object = std::make_unique<rgle::ray::Ball>(0.5f + 0.5f * std::abs(unit(random))) });
+  case 1:
+    return rgle::ray::Model(rgle::ray::Object {
+      .object = std::make_unique<rgle::ray::Plane>(glm::vec3(0.0f, -3.0f, 0.0f), glm::normalize(glm::vec3(unit(random), 1.0f, unit(random))))
+    });
+  case 2: {
+    auto translation = glm::vec3(unit(random), unit(random), unit(random));
+    float scale = unit(random);
+    if (dyadic) {
+      translation = glm::round(4.0f * translation) / 4.0f;
+      scale = std::exp2(std::round(scale));
+    }
+    else {
+      scale = 1.0f + 0.5f * scale;
+    }
+    return rgle::ray::Model(rgle::ray::Transform {
+      .transform = rgle::ray::RayTransform(glm::scale(glm::translate(glm::mat4(1.0f), translation), glm::vec3(scale))),
+      .model = child()
+    });
+  }
+  case 3:
+    return rgle::ray::Model(rgle::ray::Clip {
+      .clipPlane = rgle::ray::Plane(glm::vec3(unit(random), unit(random), unit(random)), glm::normalize(glm::vec3(unit(random), unit(random), 1.0f))),
+      .model = child()
+    });
+  case 4:
+    return rgle::ray::Model(rgle::ray::And { .lhs = child(), .rhs = child() });
+  case 5:
+    return rgle::ray::Model(rgle::ray::Or { .lhs = child(), .rhs = child() });
+  default: {
+    auto scene = rgle::ray::Scene {};
+    for (int i = 0; i < 4; i++) {
+      scene.scene.push_back(random_model(depth - 1, random, dyadic));
+    }
+    if (depth % 2 == 0) {
+      scene.build();
+    }
+    return rgle::ray::Model(std::move(scene));
+  }
+  }
+}
+
 int main() {
 	return rgle::util::Tester::run([](rgle::util::Tester& tester) {
     tester.expect("point clip should be inside", []() {
@@ -112,5 +198,432 @@ int main() {
       };
       return model.intersect(ray) == std::nullopt;
     });
+
+    tester.expect("scene hierarchy intersect should match linear scan", []() {
+      std::mt19937 random(7);
+      std::uniform_real_distribution<float> position(-20.0f, 20.0f);
+      std::uniform_real_distribution<float> radius(0.1f, 2.0f);
+      auto scene = rgle::ray::Scene {};
+      for (int i = 0; i < 500; i++) {
+        auto matrix = glm::translate(glm::mat4(1.0f), glm::vec3(position(random), position(random), position(random)));
+        scene.scene.push_back(std::move(*rgle::ray::transform(rgle::ray::Ball(radius(random)), matrix)));
+      }
+      scene.scene.push_back(rgle::ray::Model(rgle::ray::Object {
+        .object = std::make_unique<rgle::ray::Plane>(glm::vec3(0.0f, -25.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f))
+      }));
+      std::vector<rgle::ray::Ray> rays;
+      for (int i = 0; i < 1000; i++) {
+        rays.push_back(rgle::ray::Ray {
+          .eye = glm::vec3(position(random), position(random), position(random)),
+          .target = glm::vec3(position(random), position(random), position(random))
+        });
+      }
+      auto model = rgle::ray::Model(std::move(scene));
+      std::vector<std::optional<rgle::ray::Intersection>> expected;
+      for (const auto& ray : rays) {
+        expected.push_back(model.intersect(ray));
+      }
+      std::get<rgle::ray::Scene>(model).build();
+      for (size_t i = 0; i < rays.size(); i++) {
+        if (model.intersect(rays[i]) != expected[i]) {
+          return false;
+        }
+      }
+      return true;
+    });
+
+    tester.expect("refitted scene hierarchy should match linear scan", []() {
+      std::mt19937 random(37);
+      std::uniform_real_distribution<float> position(-20.0f, 20.0f);
+      std::uniform_real_distribution<float> step(-0.2f, 0.2f);
+      std::vector<glm::vec3> centers;
+      auto model = rgle::ray::Model(rgle::ray::Scene {});
+      auto& scene = std::get<rgle::ray::Scene>(model);
+      for (int i = 0; i < 300; i++) {
+        centers.push_back(glm::vec3(position(random), position(random), position(random)));
+        scene.scene.push_back(std::move(*rgle::ray::transform(rgle::ray::Ball(1.0f), glm::translate(glm::mat4(1.0f), centers.back()))));
+      }
+      scene.scene.push_back(rgle::ray::Model(rgle::ray::Object {
+        .object = std::make_unique<rgle::ray::Plane>(glm::vec3(0.0f, -25.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f))
+      }));
+      scene.build();
+      auto matches = [&]() {
+        auto hierarchy = scene.hierarchy;
+        for (int i = 0; i < 200; i++) {
+          auto ray = rgle::ray::Ray {
+            .eye = glm::vec3(position(random), position(random), position(random)),
+            .target = glm::vec3(position(random), position(random), position(random))
+          };
+          scene.hierarchy = nullptr;
+          auto expected = model.intersect(ray);
+          scene.hierarchy = hierarchy;
+          if (model.intersect(ray) != expected) {
+            return false;
+          }
+        }
+        return true;
+      };
+      size_t nodes = scene.hierarchy->nodes().size();
+      // Small steps keep the topology, scattering the balls degrades the tree until it is rebuilt
+      for (int frame = 0; frame < 5; frame++) {
+        for (size_t i = 0; i < centers.size(); i++) {
+          centers[i] += glm::vec3(step(random), step(random), step(random));
+          scene.update(i, rgle::ray::RayTransform(glm::translate(glm::mat4(1.0f), centers[i])));
+        }
+        if (scene.refit() || scene.hierarchy->nodes().size() != nodes || !matches()) {
+          return false;
+        }
+      }
+      for (size_t i = 0; i < centers.size(); i++) {
+        scene.update(i, rgle::ray::RayTransform(glm::translate(glm::mat4(1.0f), glm::vec3(position(random), position(random), position(random)))));
+      }
+      return scene.refit() && !(scene.hierarchy->cost() > scene.hierarchy->buildCost()) && matches();
+    });
+
+    tester.expect("bounded intersect and occlusion should match closest hit", []() {
+      std::mt19937 random(23);
+      std::uniform_real_distribution<float> position(-6.0f, 6.0f);
+      std::uniform_real_distribution<float> distance(0.0f, 12.0f);
+      for (int i = 0; i < 50; i++) {
+        auto model = random_model(6, random);
+        for (int j = 0; j < 200; j++) {
+          auto ray = rgle::ray::Ray {
+            .eye = glm::vec3(position(random), position(random), position(random)),
+            .target = glm::vec3(position(random), position(random), position(random))
+          };
+          float maxDistance = distance(random);
+          auto closest = model.intersect(ray);
+          bool within = closest && closest->distance(ray) <= maxDistance;
+          if (model.intersect(ray, maxDistance) != (within ? closest : std::nullopt)) {
+            return false;
+          }
+          // Occlusion compares parametric distances, skip hits that land within rounding of the bound
+          if (closest && std::abs(closest->distance(ray) - maxDistance) < 1e-3f) {
+            continue;
+          }
+          if (model.occluded(ray, maxDistance) != within) {
+            return false;
+          }
+        }
+      }
+      return true;
+    });
+
+    tester.expect("batch intersect should match single ray intersect", []() {
+      std::mt19937 random(29);
+      std::uniform_real_distribution<float> position(-6.0f, 6.0f);
+      auto pool = rgle::sync::ThreadPool(4);
+      for (int i = 0; i < 20; i++) {
+        auto model = random_model(6, random);
+        std::vector<rgle::ray::Ray> rays;
+        for (int j = 0; j < 5000; j++) {
+          rays.push_back(rgle::ray::Ray {
+            .eye = glm::vec3(position(random), position(random), position(random)),
+            .target = glm::vec3(position(random), position(random), position(random))
+          });
+        }
+        std::vector<std::optional<rgle::ray::Intersection>> batch(rays.size()), parallel(rays.size());
+        model.intersect(rays, batch);
+        model.intersect(rays, parallel, pool);
+        for (size_t j = 0; j < rays.size(); j++) {
+          auto expected = model.intersect(rays[j]);
+          if (batch[j] != expected || parallel[j] != expected) {
+            return false;
+          }
+        }
+      }
+      return true;
+    });
+
+    tester.expect("optimize should fold nested transforms and prune clipped subtrees", []() {
+      auto outer = glm::translate(glm::mat4(1.0f), glm::vec3(1.0f, 2.0f, 3.0f));
+      auto inner = glm::scale(glm::mat4(1.0f), glm::vec3(2.0f));
+      auto folded = rgle::ray::optimize(rgle::ray::Model(rgle::ray::Transform {
+        .transform = rgle::ray::RayTransform(outer),
+        .model = rgle::ray::transform(rgle::ray::Ball(1.0f), inner)
+      }));
+      auto transform = std::get_if<rgle::ray::Transform>(&folded);
+      if (!transform || !std::holds_alternative<rgle::ray::Object>(*transform->model) || transform->transform.affine != outer * inner || !folded.cachedBounds) {
+        return false;
+      }
+      auto clipped = rgle::ray::optimize(rgle::ray::Model(rgle::ray::Clip {
+        .clipPlane = rgle::ray::Plane(glm::vec3(0.0f, 0.0f, 2.0f), glm::vec3(0.0f, 0.0f, 1.0f)),
+        .model = std::make_unique<rgle::ray::Model>(rgle::ray::Object { .object = std::make_unique<rgle::ray::Ball>(1.0f) })
+      }));
+      auto scene = std::get_if<rgle::ray::Scene>(&clipped);
+      auto ray = rgle::ray::Ray { .eye = glm::vec3(0.0f, 0.0f, -4.0f), .target = glm::vec3(0.0f, 0.0f, 4.0f) };
+      return scene && scene->scene.empty() && !clipped.intersect(ray);
+    });
+
+    tester.expect("optimize should keep the hierarchy options of a pruned scene", []() {
+      auto model = rgle::ray::Model(rgle::ray::Scene {});
+      auto& scene = std::get<rgle::ray::Scene>(model);
+      for (int i = 0; i < 3; i++) {
+        scene.scene.push_back(std::move(*rgle::ray::transform(rgle::ray::Ball(1.0f), glm::translate(glm::mat4(1.0f), glm::vec3(3.0f * i, 0.0f, 0.0f)))));
+      }
+      scene.scene.push_back(rgle::ray::Model(rgle::ray::Clip {
+        .clipPlane = rgle::ray::Plane(glm::vec3(0.0f, 0.0f, 2.0f), glm::vec3(0.0f, 0.0f, 1.0f)),
+        .model = std::make_unique<rgle::ray::Model>(rgle::ray::Object { .object = std::make_unique<rgle::ray::Ball>(1.0f) })
+      }));
+      scene.build(rgle::ray::HierarchyOptions { .maxLeafSize = 1 });
+      auto optimized = rgle::ray::optimize(std::move(model));
+      auto pruned = std::get_if<rgle::ray::Scene>(&optimized);
+      return pruned && pruned->scene.size() == 3 && pruned->hierarchy && pruned->hierarchy->options().maxLeafSize == 1;
+    });
+
+    tester.expect("optimized model should match the source model", []() {
+      std::mt19937 random(31);
+      std::uniform_real_distribution<float> position(-6.0f, 6.0f);
+      for (int i = 0; i < 50; i++) {
+        std::mt19937 copy = random;
+        auto model = random_model(6, random, true);
+        auto optimized = rgle::ray::optimize(random_model(6, copy, true));
+        std::vector<rgle::ray::Ray> rays;
+        for (int j = 0; j < 200; j++) {
+          rays.push_back(rgle::ray::Ray {
+            .eye = glm::vec3(position(random), position(random), position(random)),
+            .target = glm::vec3(position(random), position(random), position(random))
+          });
+        }
+        std::vector<std::optional<rgle::ray::Intersection>> batch(rays.size());
+        optimized.intersect(rays, batch);
+        for (size_t j = 0; j < rays.size(); j++) {
+          auto expected = model.intersect(rays[j]);
+          auto actual = optimized.intersect(rays[j]);
+          // Cached bounds only skip work, so the batch path must agree with the optimized model exactly
+          if (batch[j] != actual) {
+            return false;
+          }
+          // Folded transforms are exact, only applying one instead of two rounds the hit positions differently
+          if (expected.has_value() != actual.has_value() || (expected && glm::distance(expected->position, actual->position) > 1e-3f)) {
+            return false;
+          }
+        }
+      }
+      return true;
+    });
+
+    tester.expect("mesh intersect should match a brute force triangle scan", []() {
+      std::mt19937 random(19);
+      std::uniform_real_distribution<float> position(-10.0f, 10.0f);
+      std::uniform_real_distribution<float> offset(-1.5f, 1.5f);
+      std::vector<glm::vec3> vertices;
+      std::vector<uint32_t> indices;
+      for (uint32_t i = 0; i < 400; i++) {
+        auto center = glm::vec3(position(random), position(random), position(random));
+        for (int j = 0; j < 3; j++) {
+          vertices.push_back(center + glm::vec3(offset(random), offset(random), offset(random)));
+          indices.push_back(3 * i + j);
+        }
+      }
+      auto mesh = rgle::ray::Mesh(vertices, indices);
+      for (int i = 0; i < 2000; i++) {
+        auto ray = rgle::ray::Ray {
+          .eye = glm::vec3(position(random), position(random), position(random)),
+          .target = glm::vec3(position(random), position(random), position(random))
+        };
+        std::optional<size_t> expected = std::nullopt;
+        float closest = 0.0f;
+        for (size_t j = 0; j < indices.size() / 3; j++) {
+          auto hit = rgle::ray::intersect_triangle(ray, vertices[indices[3 * j]], vertices[indices[3 * j + 1]], vertices[indices[3 * j + 2]]);
+          if (hit && (!expected || hit->x < closest)) {
+            expected = j;
+            closest = hit->x;
+          }
+        }
+        auto hit = mesh.closestHit(ray);
+        if (hit.has_value() != expected.has_value() || (hit && hit->triangle != *expected)) {
+          return false;
+        }
+      }
+      return true;
+    });
+
+    tester.expect("picking ray should hit a quad", []() {
+      auto topleft = glm::vec3(0.0f, 0.0f, 0.0f);
+      auto topright = glm::vec3(1.0f, 0.0f, 0.0f);
+      auto bottomleft = glm::vec3(0.0f, 1.0f, 0.0f);
+      auto bottomright = glm::vec3(1.0f, 1.0f, 0.0f);
+      auto hit = rgle::Ray(glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.75f, 0.75f, 0.0f));
+      auto miss = rgle::Ray(glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(1.5f, 0.5f, 0.0f));
+      auto mesh = rgle::ray::Mesh({ topleft, topright, bottomleft, bottomright }, { 1, 0, 2, 2, 3, 1 });
+      return (hit.intersect(topright, topleft, bottomleft) || hit.intersect(bottomleft, bottomright, topright))
+        && !miss.intersect(topright, topleft, bottomleft) && !miss.intersect(bottomleft, bottomright, topright)
+        && hit.intersect(mesh) && !miss.intersect(mesh)
+        && mesh.closestHit(hit.cast())->triangle == 1;
+    });
+
+    tester.expect("barycentric coordinates of a centroid should be equal", []() {
+      auto alpha = rgle::barycentric(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(3.0f, 0.0f, 0.0f), glm::vec3(0.0f, 3.0f, 0.0f), glm::vec3(1.0f, 1.0f, 0.0f));
+      return glm::all(glm::lessThan(glm::abs(alpha - glm::vec3(1.0f / 3.0f)), glm::vec3(1e-6f)));
+    });
+
+    tester.expect("compiled model intersect should match model intersect", []() {
+      std::mt19937 random(17);
+      std::uniform_real_distribution<float> position(-6.0f, 6.0f);
+      for (int i = 0; i < 50; i++) {
+        auto model = random_model(6, random);
+        auto compiled = rgle::ray::CompiledModel(model);
+        for (int j = 0; j < 200; j++) {
+          auto ray = rgle::ray::Ray {
+            .eye = glm::vec3(position(random), position(random), position(random)),
+            .target = glm::vec3(position(random), position(random), position(random))
+          };
+          if (compiled.intersect(ray) != model.intersect(ray)) {
+            return false;
+          }
+        }
+      }
+      return true;
+    });
+
+    tester.expect("compiled model of a wide flat scene should match model intersect", []() {
+      std::mt19937 random(23);
+      std::uniform_real_distribution<float> position(-20.0f, 20.0f);
+      auto model = rgle::ray::Model(rgle::ray::Scene {});
+      auto& scene = std::get<rgle::ray::Scene>(model).scene;
+      for (int i = 0; i < 1000; i++) {
+        auto center = glm::vec3(position(random), position(random), position(random));
+        scene.push_back(std::move(*rgle::ray::transform(rgle::ray::Ball(0.5f), glm::translate(glm::mat4(1.0f), center))));
+      }
+      auto compiled = rgle::ray::CompiledModel(model);
+      for (int i = 0; i < 500; i++) {
+        auto ray = rgle::ray::Ray {
+          .eye = glm::vec3(position(random), position(random), position(random)),
+          .target = glm::vec3(position(random), position(random), position(random))
+        };
+        if (compiled.intersect(ray) != model.intersect(ray)) {
+          return false;
+        }
+      }
+      return true;
+    });
+
+    tester.expect("compiled model should call subclasses of balls instead of copying them", []() {
+      auto model = rgle::ray::Model(rgle::ray::Object { .object = std::make_unique<HollowBall>() });
+      auto compiled = rgle::ray::CompiledModel(model);
+      auto ray = rgle::ray::Ray { .eye = glm::vec3(0.0f, 0.0f, -5.0f), .target = glm::vec3(0.0f, 0.0f, 0.0f) };
+      return compiled.program().size() == 1 && compiled.program()[0].opcode == rgle::ray::CompiledModel::Opcode::OBJECT
+        && !compiled.intersect(ray).has_value() && !model.intersect(ray).has_value();
+    });
+
+    tester.expect("packet intersect should match single ray intersect", []() {
+      std::mt19937 random(11);
+      std::uniform_real_distribution<float> position(-3.0f, 3.0f);
+      std::vector<rgle::ray::Ray> rays;
+      for (int i = 0; i < 4096; i++) {
+        rays.push_back(rgle::ray::Ray {
+          .eye = glm::vec3(position(random), position(random), position(random)),
+          .target = glm::vec3(position(random), position(random), position(random))
+        });
+      }
+      // Include rays parallel to the plane and tangent to the ball
+      rays[0] = rgle::ray::Ray { .eye = glm::vec3(0.0f, 1.0f, -2.0f), .target = glm::vec3(0.0f, 1.0f, 2.0f) };
+      rays[1] = rgle::ray::Ray { .eye = glm::vec3(-2.0f, 0.0f, 0.0f), .target = glm::vec3(2.0f, 0.0f, 0.0f) };
+      auto ball = rgle::ray::Ball(1.0f);
+      auto plane = rgle::ray::Plane(glm::vec3(0.0f, 0.0f, 0.5f), glm::normalize(glm::vec3(0.2f, 0.0f, 1.0f)));
+      auto flat = rgle::ray::Plane(glm::vec3(), glm::vec3(0.0f, 1.0f, 0.0f));
+      return packet_matches<4>(ball, rays) && packet_matches<8>(ball, rays) && packet_matches<16>(ball, rays)
+        && packet_matches<4>(plane, rays) && packet_matches<8>(plane, rays) && packet_matches<16>(plane, rays)
+        && packet_matches<16>(flat, rays);
+    });
+
+    tester.expect("batch quadratic roots should match scalar roots", []() {
+      std::mt19937 random(13);
+      std::uniform_real_distribution<float> coefficient(-4.0f, 4.0f);
+      const size_t count = 1027;
+      std::vector<float> a(count), b(count), c(count), x0(count), x1(count);
+      std::vector<int32_t> roots(count);
+      for (size_t i = 0; i < count; i++) {
+        a[i] = coefficient(random);
+        b[i] = coefficient(random);
+        c[i] = coefficient(random);
+      }
+      a[0] = 1.0f; b[0] = 2.0f; c[0] = 1.0f;
+      rgle::math::quadratic::compute_roots(a.data(), b.data(), c.data(), x0.data(), x1.data(), roots.data(), count);
+      for (size_t i = 0; i < count; i++) {
+        auto expected = rgle::math::quadratic::compute_roots(a[i], b[i], c[i]);
+        if (auto val = std::get_if<rgle::math::quadratic::Two>(&expected)) {
+          if (roots[i] != 2 || val->x0 != x0[i] || val->x1 != x1[i]) {
+            return false;
+          }
+        }
+        else if (auto val = std::get_if<rgle::math::quadratic::One>(&expected)) {
+          if (roots[i] != 1 || val->x0 != x0[i]) {
+            return false;
+          }
+        }
+        else if (roots[i] != 0) {
+          return false;
+        }
+      }
+      return true;
+    });
+
+    tester.expect("ray renderer should shade hits and match a single threaded render", []() {
+      auto model = rgle::ray::Model(rgle::ray::Scene {});
+      auto& scene = std::get<rgle::ray::Scene>(model).scene;
+      scene.push_back(std::move(*rgle::ray::transform(rgle::ray::Ball(1.0f), glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, 4.0f)))));
+      scene.push_back(rgle::ray::Model(rgle::ray::Object {
+        .object = std::make_unique<rgle::ray::Plane>(glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f))
+      }));
+      auto camera = rgle::ray::PinholeCamera {};
+      auto options = rgle::ray::RenderOptions { .tileSize = 7, .background = glm::vec3(0.0f, 0.0f, 1.0f) };
+      auto single = rgle::gfx::Image8(61, 45, 3);
+      auto parallel = rgle::gfx::Image8(61, 45, 3);
+      auto stats = rgle::ray::Renderer(std::make_shared<rgle::sync::ThreadPool>(1), options).render(model, camera, single);
+      rgle::ray::Renderer(std::make_shared<rgle::sync::ThreadPool>(4), options).render(model, camera, parallel);
+      if (stats.rays != 61 * 45 || stats.tiles != 9 * 7) {
+        return false;
+      }
+      if (std::memcmp(single.image, parallel.image, single.size()) != 0) {
+        return false;
+      }
+      auto pixel = [&](size_t x, size_t y) {
+        return single.image + (y * single.width + x) * single.channels;
+      };
+      // The ball covers the center, the sky is above it and the floor below it
+      return pixel(30, 22)[0] > 0 && pixel(30, 22)[2] == pixel(30, 22)[0]
+        && pixel(30, 0)[0] == 0 && pixel(30, 0)[2] == 255
+        && pixel(30, 44)[0] > 0;
+    });
+
+    tester.expect("ray renderer should render a wide flat scene", []() {
+      auto model = rgle::ray::Model(rgle::ray::Scene {});
+      auto& scene = std::get<rgle::ray::Scene>(model).scene;
+      for (int i = 0; i < 1000; i++) {
+        auto center = glm::vec3(static_cast<float>(i % 40) - 20.0f, static_cast<float>(i / 40) - 12.0f, 40.0f);
+        scene.push_back(std::move(*rgle::ray::transform(rgle::ray::Ball(0.25f), glm::translate(glm::mat4(1.0f), center))));
+      }
+      auto image = rgle::gfx::Image8(32, 24, 3);
+      auto stats = rgle::ray::Renderer(std::make_shared<rgle::sync::ThreadPool>(4)).render(model, rgle::ray::PinholeCamera {}, image);
+      return stats.rays == 32 * 24;
+    });
+
+    tester.expect("batch intersect on a pool should rethrow an exception thrown by a chunk", []() {
+      auto model = rgle::ray::Model(rgle::ray::Object { .object = std::make_unique<ThrowingObject>() });
+      auto pool = rgle::sync::ThreadPool(4);
+      std::vector<rgle::ray::Ray> rays(10000, rgle::ray::Ray { .eye = glm::vec3(0.0f, 0.0f, -5.0f), .target = glm::vec3(0.0f) });
+      std::vector<std::optional<rgle::ray::Intersection>> results(rays.size());
+      try {
+        model.intersect(rays, results, pool);
+      }
+      catch (std::runtime_error& error) {
+        return std::string(error.what()) == "throwing object";
+      }
+      return false;
+    });
+
+    tester.expect("ray renderer should rethrow an exception thrown by a tile", []() {
+      auto model = rgle::ray::Model(rgle::ray::Object { .object = std::make_unique<ThrowingObject>() });
+      auto image = rgle::gfx::Image8(32, 24, 3);
+      try {
+        rgle::ray::Renderer(std::make_shared<rgle::sync::ThreadPool>(4), rgle::ray::RenderOptions { .tileSize = 4 }).render(model, rgle::ray::PinholeCamera {}, image);
+      }
+      catch (std::runtime_error& error) {
+        return std::string(error.what()) == "throwing object";
+      }
+      return false;
+    });
   });
 }
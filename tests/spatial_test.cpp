@@ -1,5 +1,498 @@
 #include "rgle.h"
 
 int main() {
-	return rgle::util::Tester::run([](rgle::util::Tester&) {});
+	return rgle::util::Tester::run([](rgle::util::Tester& tester) {
+		using namespace rgle::gfx;
+
+		std::array<glm::vec4, 8> opaque;
+		opaque.fill(glm::vec4(1.0f, 1.0f, 1.0f, 1.0f));
+
+		// Temporary files are named per run, so test runs in parallel do not overwrite each other's files
+		const std::string run = std::to_string(std::chrono::system_clock::now().time_since_epoch().count()) + "_" + std::to_string(std::random_device()());
+		auto temp_file = [&run](const std::string& name) {
+			return (std::filesystem::temp_directory_path() / ("rgle_spatial_test_" + run + "_" + name)).string();
+		};
+
+		tester.expect("voxel pool handles should navigate inserted children", [&opaque]() {
+			SparseVoxelPool pool;
+			pool.rootSize() = 4.0f;
+			auto root = pool.root();
+			root.insertChildren(opaque);
+			auto child = root.child(OctreeIndex::RIGHT, OctreeIndex::TOP, OctreeIndex::FRONT);
+			child.insertChildren(opaque);
+			auto grandchild = child.child(OctreeIndex::LEFT, OctreeIndex::BOTTOM, OctreeIndex::BACK);
+			return child.valid() && !root.leaf() && !child.leaf() && grandchild.leaf()
+				&& child.parent() == root && grandchild.parent() == child && !root.parent().valid()
+				&& !grandchild.child(OctreeIndex::LEFT, OctreeIndex::TOP, OctreeIndex::FRONT).valid()
+				&& child.depth() == 1 && grandchild.depth() == 2
+				&& child.size() == 2.0f && grandchild.size() == 1.0f
+				&& child.position() == glm::vec3(1.0f, 1.0f, 1.0f)
+				&& grandchild.position() == glm::vec3(0.5f, 0.5f, 0.5f)
+				&& child.index() / 8 != grandchild.index() / 8
+				&& root.color() == glm::vec4(1.0f, 1.0f, 1.0f, 1.0f);
+		});
+
+		tester.expect("voxel pool should mark inserted blocks modified", []() {
+			SparseVoxelPool pool;
+			pool.modifiedBlocks().clear();
+			auto root = pool.root();
+			root.insertChildren({});
+			root.child(OctreeIndex::LEFT, OctreeIndex::TOP, OctreeIndex::FRONT).insertChildren({});
+			auto range = pool.modifiedBlocks().pop();
+			return pool.blockCount() == 3 && pool.modifiedBlocks().empty() && range.lower == 0 && range.upper == 3;
+		});
+
+		tester.expect("voxel payload should pack colors, child block and child mask in 8 bytes", [&opaque]() {
+			SparseVoxelPool pool;
+			auto root = pool.root();
+			auto colors = opaque;
+			colors[2] = glm::vec4(0.0f, 0.0f, 0.0f, 0.0f);
+			colors[5] = glm::vec4(1.0f, 0.0f, 0.0f, 0.001f);
+			root.insertChildren(colors);
+			auto payload = root.toPayload();
+			auto leaf = root.child(OctreeIndex::LEFT, OctreeIndex::TOP, OctreeIndex::FRONT).toPayload();
+			std::array<unsigned char, 8> buffer;
+			payload.mapToBuffer(buffer.data());
+			GLuint mapped[2];
+			std::memcpy(mapped, buffer.data(), sizeof(mapped));
+			auto color = glm::vec4(0.25f, 0.5f, 0.75f, 1.0f);
+			auto unpacked = SparseVoxelNodePayload::unpackColor(SparseVoxelNodePayload::packColor(color));
+			return SparseVoxelNodePayload::SIZE == 8 && SparseVoxelOctree::BLOCK_SIZE == 64
+				&& payload.children == ((1u << 8) | 0xDBu) && leaf.children == 0
+				&& mapped[0] == payload.color && mapped[1] == payload.children
+				&& glm::all(glm::lessThanEqual(glm::abs(unpacked - color), glm::vec4(0.5f / 255.0f)))
+				&& SparseVoxelNodePayload::packColor(glm::vec4(NAN, NAN, NAN, 0.0f)) == 0;
+		});
+
+		tester.expect("voxel edit transaction should blend the same colors as immediate propagation", []() {
+			auto build = [](SparseVoxelPool& pool) {
+				std::vector<SparseVoxelNode> frontier = { pool.root() };
+				for (int level = 0; level < 4; level++) {
+					std::vector<SparseVoxelNode> next;
+					for (size_t n = 0; n < frontier.size(); n++) {
+						std::array<glm::vec4, 8> colors;
+						for (size_t i = 0; i < 8; i++) {
+							float shade = static_cast<float>((n * 8 + i) % 7) / 6.0f;
+							colors[i] = glm::vec4(shade, 1.0f - shade, 0.5f, (i + n) % 5 == 0 ? 0.0f : 0.25f + 0.75f * shade);
+						}
+						frontier[n].insertChildren(colors);
+						for (size_t i = 0; i < 8; i += 2) {
+							OctreeIndex::X x;
+							OctreeIndex::Y y;
+							OctreeIndex::Z z;
+							OctreeIndex::from_index(i, x, y, z);
+							next.push_back(frontier[n].child(x, y, z));
+						}
+					}
+					frontier = std::move(next);
+				}
+				pool.remove(pool.root().child(OctreeIndex::LEFT, OctreeIndex::BOTTOM, OctreeIndex::FRONT));
+			};
+			SparseVoxelPool immediate;
+			build(immediate);
+			SparseVoxelPool deferred;
+			rgle::sync::ThreadPool threads(2);
+			deferred.begin();
+			build(deferred);
+			deferred.commit(threads);
+			auto range = deferred.modifiedBlocks().pop();
+			bool same = immediate.blockCount() == deferred.blockCount() && !deferred.editing();
+			for (uint32_t i = 0; same && i < 8 * deferred.blockCount(); i++) {
+				auto a = immediate.payload(i);
+				auto b = deferred.payload(i);
+				same = a.color == b.color && a.children == b.children;
+			}
+			return same && deferred.modifiedBlocks().empty() && range.lower == 0 && range.upper == deferred.blockCount();
+		});
+
+		tester.expect("voxelizer should build one layer of leaves for a quad", []() {
+			VoxelMesh quad;
+			quad.vertices = {
+				glm::vec3(-0.9f, -0.9f, 0.1f),
+				glm::vec3(0.9f, -0.9f, 0.1f),
+				glm::vec3(0.9f, 0.9f, 0.1f),
+				glm::vec3(-0.9f, 0.9f, 0.1f)
+			};
+			quad.indices = { 0, 1, 2, 0, 2, 3 };
+			quad.colors.assign(4, glm::vec4(1.0f, 0.0f, 0.0f, 1.0f));
+			SparseVoxelPool pool;
+			pool.rootSize() = 2.0f;
+			Voxelizer voxelizer(std::make_shared<rgle::sync::ThreadPool>(2), VoxelizeOptions{ .depth = 3, .fit = false });
+			auto stats = voxelizer.voxelize(quad, pool);
+			// Subtrees are inserted depth first, so the last block holds leaves, 4 of them in the lower z half
+			size_t red = 0;
+			for (uint32_t i = 0; i < 8; i++) {
+				red += pool.payload(8 * 21 + i).color == SparseVoxelNodePayload::packColor(glm::vec4(1.0f, 0.0f, 0.0f, 1.0f)) ? 1 : 0;
+			}
+			// The root now has children, voxelizing over them would orphan the existing subtrees
+			bool rejected = false;
+			try {
+				voxelizer.voxelize(quad, pool);
+			}
+			catch (rgle::IllegalArgumentException&) {
+				rejected = true;
+			}
+			// 8 x 8 leaves in the layer 0 <= z < 0.25, below 16 + 4 + 1 inner nodes and the root block
+			return rejected && stats.triangles == 2 && stats.leaves == 64 && stats.blocks == 22 && pool.blockCount() == 22
+				&& !pool.editing() && red == 4 && (pool.payload(0).children & 0xFFu) == 0x0Fu;
+		});
+
+		tester.expect("point cloud importer should average the points of each leaf", []() {
+			std::vector<glm::vec3> positions = {
+				glm::vec3(0.5f, 0.5f, 0.5f),
+				glm::vec3(-1.5f, -1.5f, -1.5f),
+				glm::vec3(0.6f, 0.6f, 0.6f),
+				glm::vec3(10.0f, 0.0f, 0.0f)
+			};
+			std::vector<glm::vec4> colors = {
+				glm::vec4(1.0f, 0.0f, 0.0f, 1.0f),
+				glm::vec4(0.0f, 1.0f, 0.0f, 1.0f),
+				glm::vec4(0.0f, 0.0f, 1.0f, 1.0f),
+				glm::vec4(1.0f, 1.0f, 1.0f, 1.0f)
+			};
+			auto threads = std::make_shared<rgle::sync::ThreadPool>(2);
+			SparseVoxelPool pool;
+			pool.rootSize() = 4.0f;
+			auto stats = PointCloudImporter(threads, PointCloudOptions{ .depth = 2, .fit = false }).build(positions, colors, pool);
+			SparseVoxelPool chunked;
+			chunked.rootSize() = 4.0f;
+			PointCloudImporter(threads, PointCloudOptions{ .depth = 2, .chunkSize = 1, .fit = false }).build(positions, colors, chunked);
+			bool same = pool.blockCount() == chunked.blockCount();
+			for (uint32_t i = 0; same && i < 8 * pool.blockCount(); i++) {
+				same = pool.payload(i).color == chunked.payload(i).color && pool.payload(i).children == chunked.payload(i).children;
+			}
+			// Child 1 (right, top, front) is inserted before child 6 (left, bottom, back), both leaves are their child 6
+			return stats.points == 4 && stats.leaves == 2 && stats.blocks == 4 && !pool.editing() && same
+				&& (pool.payload(0).children & 0xFFu) == 0x42u && (pool.payload(9).children & 0xFFu) == 0x40u
+				&& pool.payload(8 * 2 + 6).color == SparseVoxelNodePayload::packColor(glm::vec4(0.5f, 0.0f, 0.5f, 1.0f))
+				&& pool.payload(8 * 3 + 6).color == SparseVoxelNodePayload::packColor(glm::vec4(0.0f, 1.0f, 0.0f, 1.0f));
+		});
+
+		tester.expect("point cloud importer should stream points in chunks like one build", []() {
+			std::vector<glm::vec3> positions;
+			std::vector<glm::vec4> colors;
+			for (int i = 0; i < 64; i++) {
+				positions.push_back(glm::vec3(float(i % 4) - 1.5f, float((i / 4) % 4) - 1.5f, float(i / 16) - 1.5f) * 0.9f);
+				colors.push_back(glm::vec4(float(i % 2), float(i % 3) / 2.0f, 1.0f, 1.0f));
+			}
+			auto threads = std::make_shared<rgle::sync::ThreadPool>(2);
+			SparseVoxelPool pool;
+			pool.rootSize() = 4.0f;
+			PointCloudImporter(threads, PointCloudOptions{ .depth = 3, .fit = false }).build(positions, colors, pool);
+			SparseVoxelPool streamed;
+			PointCloudImporter importer(threads, PointCloudOptions{ .depth = 3 });
+			importer.begin(4.0f);
+			for (size_t offset = 0; offset < positions.size(); offset += 5) {
+				size_t count = std::min<size_t>(5, positions.size() - offset);
+				importer.add(std::span<const glm::vec3>(positions).subspan(offset, count), std::span<const glm::vec4>(colors).subspan(offset, count));
+			}
+			auto stats = importer.finish(streamed);
+			bool same = pool.blockCount() == streamed.blockCount();
+			for (uint32_t i = 0; same && i < 8 * pool.blockCount(); i++) {
+				same = pool.payload(i).color == streamed.payload(i).color && pool.payload(i).children == streamed.payload(i).children;
+			}
+			bool unstarted = false;
+			try {
+				importer.add(positions, colors);
+			}
+			catch (rgle::InvalidStateException&) {
+				unstarted = true;
+			}
+			return same && stats.points == 64 && stats.leaves == 64 && streamed.rootSize() == 4.0f && unstarted;
+		});
+
+		tester.expect("voxel file should store the payloads and restore the same pool", [&opaque, &temp_file]() {
+			SparseVoxelPool pool;
+			pool.rootSize() = 4.0f;
+			auto colors = opaque;
+			colors[2] = glm::vec4(0.2f, 0.4f, 0.6f, 0.8f);
+			colors[7] = glm::vec4(0.0f, 0.0f, 0.0f, 0.0f);
+			auto root = pool.root();
+			root.insertChildren(colors);
+			root.child(OctreeIndex::LEFT, OctreeIndex::BOTTOM, OctreeIndex::FRONT).insertChildren(colors);
+			auto filename = temp_file("pool.svo");
+			SparseVoxelFile::write(filename, pool);
+			bool same = false;
+			bool header = false;
+			{
+				SparseVoxelFile file(filename);
+				SparseVoxelPool loaded;
+				loaded.load(file);
+				same = loaded.blockCount() == pool.blockCount() && loaded.rootSize() == pool.rootSize();
+				for (uint32_t i = 0; same && i < 8 * pool.blockCount(); i++) {
+					SparseVoxelNodePayload stored;
+					std::memcpy(&stored.color, file.blocks() + i * SparseVoxelNodePayload::SIZE, sizeof(GLuint));
+					std::memcpy(&stored.children, file.blocks() + i * SparseVoxelNodePayload::SIZE + sizeof(GLuint), sizeof(GLuint));
+					same = stored.color == pool.payload(i).color && stored.children == pool.payload(i).children
+						&& loaded.payload(i).color == stored.color && loaded.payload(i).children == stored.children;
+				}
+				same = same && loaded.root().child(OctreeIndex::LEFT, OctreeIndex::BOTTOM, OctreeIndex::FRONT).child(OctreeIndex::RIGHT, OctreeIndex::TOP, OctreeIndex::FRONT).depth() == 2;
+				// Child 7 (right, bottom, back) of the root is transparent, the visible leaves still span the root
+				const auto& h = file.header();
+				header = h.blockCount == 3 && h.depth == 2 && h.rootSize == 4.0f
+					&& h.lower[0] == -2.0f && h.lower[1] == -2.0f && h.lower[2] == -2.0f
+					&& h.upper[0] == 2.0f && h.upper[1] == 2.0f && h.upper[2] == 2.0f;
+			}
+			// Block 2 names a parent past the last node
+			bool rejected = false;
+			{
+				std::fstream stream(filename, std::ios::in | std::ios::out | std::ios::binary);
+				uint32_t parent = 8 * 3;
+				stream.seekp(sizeof(SparseVoxelFileHeader) + 3 * SparseVoxelOctree::BLOCK_SIZE + 2 * sizeof(uint32_t));
+				stream.write(reinterpret_cast<const char*>(&parent), sizeof(parent));
+			}
+			{
+				SparseVoxelFile file(filename);
+				SparseVoxelPool loaded;
+				try {
+					loaded.load(file);
+				}
+				catch (rgle::IOException&) {
+					rejected = loaded.blockCount() == 1;
+				}
+			}
+			std::filesystem::remove(filename);
+			return same && header && rejected;
+		});
+
+		tester.expect("voxel pool compression should share identical subtrees", [&opaque, &temp_file]() {
+			SparseVoxelPool pool;
+			auto colors = opaque;
+			colors[4] = glm::vec4(1.0f, 0.0f, 0.0f, 1.0f);
+			auto root = pool.root();
+			root.insertChildren(opaque);
+			root.child(OctreeIndex::LEFT, OctreeIndex::TOP, OctreeIndex::FRONT).insertChildren(opaque);
+			root.child(OctreeIndex::RIGHT, OctreeIndex::TOP, OctreeIndex::FRONT).insertChildren(opaque);
+			root.child(OctreeIndex::LEFT, OctreeIndex::BOTTOM, OctreeIndex::FRONT).insertChildren(colors);
+			auto before = pool.payload(0);
+			auto stats = pool.compress();
+			pool.modifiedBlocks().clear();
+			// Nodes 8 and 9 of the root's block had equal subtrees, node 10 keeps its own
+			auto shared = pool.payload(8).children;
+			// Shared blocks are bounded once, the header matches the uncompressed tree
+			auto filename = temp_file("compressed.svo");
+			SparseVoxelFile::write(filename, pool);
+			bool header = false;
+			{
+				SparseVoxelFile file(filename);
+				const auto& h = file.header();
+				header = h.blockCount == 4 && h.depth == 2
+					&& h.lower[0] == -0.5f && h.lower[1] == -0.5f && h.lower[2] == -0.5f
+					&& h.upper[0] == 0.5f && h.upper[1] == 0.5f && h.upper[2] == 0.5f;
+			}
+			std::filesystem::remove(filename);
+			return header && stats.blocks == 5 && stats.compressedBlocks == 4 && pool.blockCount() == 4 && pool.shared()
+				&& pool.payload(0).color == before.color && pool.payload(0).children == before.children
+				&& shared >> 8 == 2 && pool.payload(9).children == shared && pool.payload(10).children >> 8 == 3
+				&& pool.payload(8 * 3 + 4).color == SparseVoxelNodePayload::packColor(colors[4])
+				&& pool.root().child(OctreeIndex::RIGHT, OctreeIndex::TOP, OctreeIndex::FRONT).child(OctreeIndex::LEFT, OctreeIndex::TOP, OctreeIndex::FRONT).depth() == 2;
+		});
+
+		tester.expect("voxel pool should free removed children and defragment the blocks left", [&opaque]() {
+			SparseVoxelPool pool;
+			auto red = opaque;
+			red.fill(glm::vec4(1.0f, 0.0f, 0.0f, 1.0f));
+			auto root = pool.root();
+			root.insertChildren(opaque);
+			auto removed = root.child(OctreeIndex::LEFT, OctreeIndex::TOP, OctreeIndex::FRONT);
+			auto kept = root.child(OctreeIndex::RIGHT, OctreeIndex::TOP, OctreeIndex::FRONT);
+			removed.insertChildren(opaque);
+			removed.child(OctreeIndex::LEFT, OctreeIndex::TOP, OctreeIndex::FRONT).insertChildren(opaque);
+			kept.insertChildren(opaque);
+			kept.child(OctreeIndex::LEFT, OctreeIndex::TOP, OctreeIndex::FRONT).insertChildren(red);
+			pool.removeChildren(removed);
+			bool detached = removed.leaf() && pool.blockCount() == 6 && pool.reclaim(std::chrono::seconds(1));
+			// Blocks 2 and 3 are free, block 4 and 5 of the kept subtree move in front of them
+			bool finished = pool.defragment(std::chrono::seconds(1));
+			auto child = kept.child(OctreeIndex::LEFT, OctreeIndex::TOP, OctreeIndex::FRONT);
+			auto grandchild = child.child(OctreeIndex::RIGHT, OctreeIndex::BOTTOM, OctreeIndex::BACK);
+			return detached && finished && pool.blockCount() == 4
+				&& child.index() / 8 == 2 && grandchild.index() / 8 == 3
+				&& grandchild.parent() == child && child.parent() == kept && grandchild.depth() == 3
+				&& grandchild.color() == red[7] && pool.payload(kept.index()).children >> 8 == 2
+				&& pool.acquireBlock() == 4;
+		});
+
+		tester.expect("voxel pool should finish a defragmentation pass over several calls without a budget", [&opaque]() {
+			SparseVoxelPool pool;
+			auto root = pool.root();
+			root.insertChildren(opaque);
+			for (size_t i = 0; i < 8; i++) {
+				OctreeIndex::X x;
+				OctreeIndex::Y y;
+				OctreeIndex::Z z;
+				OctreeIndex::from_index(i, x, y, z);
+				auto child = root.child(x, y, z);
+				child.insertChildren(opaque);
+				for (size_t j = 0; j < 8; j++) {
+					OctreeIndex::from_index(j, x, y, z);
+					child.child(x, y, z).insertChildren(opaque);
+				}
+			}
+			bool rejected = false;
+			pool.begin();
+			try {
+				pool.removeChildren(root.child(OctreeIndex::LEFT, OctreeIndex::TOP, OctreeIndex::FRONT));
+			}
+			catch (rgle::InvalidStateException&) {
+				rejected = true;
+			}
+			pool.commit();
+			// Every child but the last loses its subtree, 10 of the 73 blocks are left
+			for (size_t i = 0; i < 7; i++) {
+				OctreeIndex::X x;
+				OctreeIndex::Y y;
+				OctreeIndex::Z z;
+				OctreeIndex::from_index(i, x, y, z);
+				pool.removeChildren(root.child(x, y, z));
+			}
+			size_t calls = 1;
+			while (!pool.defragment(std::chrono::microseconds(0)) && calls < 100) {
+				calls++;
+			}
+			OctreeIndex::X x;
+			OctreeIndex::Y y;
+			OctreeIndex::Z z;
+			OctreeIndex::from_index(7, x, y, z);
+			auto kept = root.child(x, y, z);
+			auto grandchild = kept.child(x, y, z);
+			return rejected && calls > 1 && calls < 100 && pool.blockCount() == 10
+				&& !grandchild.leaf() && grandchild.child(x, y, z).depth() == 3 && grandchild.parent() == kept
+				&& pool.acquireBlock() == 10;
+		});
+
+		tester.expect("voxel page cache should link streamed bricks and evict the least recently used", [&opaque, &temp_file]() {
+			SparseVoxelPool pool;
+			pool.rootSize() = 4.0f;
+			auto root = pool.root();
+			root.insertChildren(opaque);
+			for (size_t i = 0; i < 8; i++) {
+				OctreeIndex::X x;
+				OctreeIndex::Y y;
+				OctreeIndex::Z z;
+				OctreeIndex::from_index(i, x, y, z);
+				root.child(x, y, z).insertChildren(opaque);
+			}
+			auto octreeFile = temp_file("paged.svo");
+			auto brickFile = temp_file("paged.svb");
+			SparseVoxelFile::write(octreeFile, pool);
+			SparseVoxelBrickFile::write(brickFile, SparseVoxelFile(octreeFile), 2);
+			auto children = [](const std::vector<unsigned char>& buffer, size_t node) {
+				GLuint word;
+				std::memcpy(&word, buffer.data() + node * SparseVoxelNodePayload::SIZE + sizeof(GLuint), sizeof(GLuint));
+				return word;
+			};
+			bool result = false;
+			{
+				auto file = std::make_shared<SparseVoxelBrickFile>(brickFile);
+				SparseVoxelPageCache cache(file, 3, std::make_shared<rgle::sync::ThreadPool>(2));
+				std::vector<unsigned char> buffer(3 * 2 * SparseVoxelOctree::BLOCK_SIZE, 0);
+				auto stream = [&cache, &buffer](uint32_t brick, uint64_t frame) {
+					cache.request(std::span<const uint32_t>(&brick, 1));
+					auto start = std::chrono::steady_clock::now();
+					while (cache.pending() > 0 && std::chrono::steady_clock::now() - start < std::chrono::seconds(5)) {
+						cache.update(buffer.data(), 8, frame);
+						std::this_thread::yield();
+					}
+				};
+				// Brick 0 holds the root block and the root's children, each grandchild block is a brick of its own
+				auto rootBlocks = cache.initialize(buffer.data());
+				// Bricks take the blocks they use only, 2 for brick 0 and 1 for each other brick
+				bool layout = file->header().brickCount == 9 && rootBlocks.upper == 2
+					&& std::filesystem::file_size(brickFile) == sizeof(SparseVoxelBrickFileHeader) + 10 * SparseVoxelOctree::BLOCK_SIZE + 9 * sizeof(SparseVoxelBrick)
+					&& file->brick(3).parent == 0 && file->brick(3).node == 10 && file->brick(3).blocks == 1
+					&& children(buffer, 10) == (SparseVoxelBrickFile::MISSING | (3u << 8) | 0xFFu);
+				stream(3, 1);
+				stream(5, 2);
+				bool linked = cache.slot(3) == 1 && cache.slot(5) == 2
+					&& children(buffer, 10) == ((2u << 8) | 0xFFu) && children(buffer, 12) == ((4u << 8) | 0xFFu);
+				// Brick 3 was visited after brick 5, so brick 5 makes room for brick 7
+				cache.touch(1, 3);
+				stream(7, 4);
+				bool evicted = !cache.resident(5) && cache.slot(7) == 2 && cache.slot(3) == 1
+					&& children(buffer, 12) == (SparseVoxelBrickFile::MISSING | (5u << 8) | 0xFFu)
+					&& children(buffer, 14) == ((4u << 8) | 0xFFu)
+					&& cache.statistics().evicted == 1 && cache.statistics().resident == 3;
+				// Both bricks were visited during the newest recorded frame, so brick 5 finds no slot
+				cache.touch(1, 4);
+				stream(5, 4);
+				bool kept = !cache.resident(5) && cache.slot(3) == 1 && cache.slot(7) == 2
+					&& cache.statistics().dropped == 1 && cache.statistics().evicted == 1;
+				result = layout && linked && evicted && kept;
+			}
+			std::filesystem::remove(octreeFile);
+			std::filesystem::remove(brickFile);
+			return result;
+		});
+
+		tester.expect("voxel raycaster should keep the closest node each pixel stops at", [&opaque]() {
+			SparseVoxelPool pool;
+			pool.rootSize() = 4.0f;
+			auto colors = opaque;
+			colors[5] = glm::vec4(1.0f, 0.0f, 0.0f, 1.0f);
+			pool.root().insertChildren(colors);
+			SparseVoxelCamera camera(0.1f, 100.0f, 1.0f);
+			camera.translate(0.5f, 0.5f, -10.0f);
+			Image offsets(16, 16, 1, 1, sizeof(GLint));
+			SparseVoxelRaycaster raycaster(std::make_shared<rgle::sync::ThreadPool>(2));
+			auto stats = raycaster.render(pool, camera, offsets);
+			Image8 image(16, 16, 4);
+			SparseVoxelRaycaster::realize(pool, offsets, image);
+			GLint center;
+			GLint corner;
+			std::memcpy(&center, offsets.image + (8 * 16 + 8) * sizeof(GLint), sizeof(GLint));
+			std::memcpy(&corner, offsets.image, sizeof(GLint));
+			const unsigned char* pixel = image.image + (8 * 16 + 8) * 4;
+			// The ray through the center passes child 5 (right, top, back) before child 1 (right, top, front)
+			return center == 13 && corner == -1 && stats.rays == 256 && stats.nodes > 256
+				&& pixel[0] == 255 && pixel[1] == 0 && pixel[2] == 0 && pixel[3] == 255;
+		});
+
+		tester.expect("voxel raycaster output should not depend on the tiling", [&opaque]() {
+			SparseVoxelPool pool;
+			pool.rootSize() = 8.0f;
+			auto colors = opaque;
+			colors[3] = glm::vec4(0.0f, 0.0f, 0.0f, 0.0f);
+			auto root = pool.root();
+			root.insertChildren(colors);
+			for (size_t i = 0; i < 8; i += 3) {
+				OctreeIndex::X x;
+				OctreeIndex::Y y;
+				OctreeIndex::Z z;
+				OctreeIndex::from_index(i, x, y, z);
+				root.child(x, y, z).insertChildren(colors);
+			}
+			SparseVoxelCamera camera(0.1f, 100.0f, 1.2f);
+			camera.translate(1.0f, -0.5f, -12.0f);
+			camera.rotate(0.1f, 0.05f, 0.0f);
+			auto threads = std::make_shared<rgle::sync::ThreadPool>(2);
+			Image single(37, 23, 1, 1, sizeof(GLint));
+			Image tiled(37, 23, 1, 1, sizeof(GLint));
+			SparseVoxelRaycaster(threads, SparseVoxelRaycastOptions{ .tileSize = 1 }).render(pool, camera, single);
+			SparseVoxelRaycaster(threads, SparseVoxelRaycastOptions{ .tileSize = 8 }).render(pool, camera, tiled);
+			return std::memcmp(single.image, tiled.image, single.size()) == 0;
+		});
+
+		tester.expectAndPrint("voxel pool should store far less than a pointer based node per voxel", []() {
+			SparseVoxelPool pool;
+			std::vector<SparseVoxelNode> frontier = { pool.root() };
+			for (int level = 0; level < 5; level++) {
+				std::vector<SparseVoxelNode> next;
+				for (auto& node : frontier) {
+					node.insertChildren({});
+					for (size_t i = 0; i < 8; i++) {
+						OctreeIndex::X x;
+						OctreeIndex::Y y;
+						OctreeIndex::Z z;
+						OctreeIndex::from_index(i, x, y, z);
+						next.push_back(node.child(x, y, z));
+					}
+				}
+				frontier = std::move(next);
+			}
+			return static_cast<double>(pool.memoryUsage()) / (8.0 * pool.blockCount()) < 48.0;
+		}, []() -> std::string {
+			return "expected less than 48 bytes of CPU storage per node";
+		});
+	});
 }
@@ -7,58 +7,58 @@ int main() {
 			return rgle::util::uid() != rgle::util::uid();
 		});
 
-		rgle::util::CollectingQueue<size_t> collectingQueue;
+		rgle::util::IntervalSet<size_t> intervalSet;
 
-		tester.expectAndPrint("collecting queue should have size of 1", [&collectingQueue]() {
-			collectingQueue.push(0);
-			collectingQueue.push(1);
-			collectingQueue.push(2);
-			return collectingQueue.size() == 1;
-		}, [&collectingQueue]() -> std::string {
+		tester.expectAndPrint("interval set should have size of 1", [&intervalSet]() {
+			intervalSet.push(0);
+			intervalSet.push(1);
+			intervalSet.push(2);
+			return intervalSet.size() == 1;
+		}, [&intervalSet]() -> std::string {
 			std::stringstream ss;
-			ss << "expected " << collectingQueue.size() << " to equal 1";
+			ss << "expected " << intervalSet.size() << " to equal 1";
 			return ss.str();
 		});
 
-		tester.expectAndPrint("collecting queue clear should clear queue", [&collectingQueue]() {
-			collectingQueue.clear();
-			return collectingQueue.size() == 0;
-		}, [&collectingQueue]() -> std::string {
+		tester.expectAndPrint("interval set clear should clear the set", [&intervalSet]() {
+			intervalSet.clear();
+			return intervalSet.size() == 0;
+		}, [&intervalSet]() -> std::string {
 			std::stringstream ss;
-			ss << "expected " << collectingQueue.size() << " to equal 0";
+			ss << "expected " << intervalSet.size() << " to equal 0";
 			return ss.str();
 		});
 
-		tester.expectAndPrint("collecting queue should have size of 3", [&collectingQueue]() {
-			collectingQueue.push(0);
-			collectingQueue.push(1);
-			collectingQueue.push(2);
-			collectingQueue.push(4);
-			collectingQueue.push(5);
-			collectingQueue.push(6);
-			collectingQueue.push(8);
-			collectingQueue.push(9);
-			collectingQueue.push(10);
-			return collectingQueue.size() == 3;
-		}, [&collectingQueue]() -> std::string {
+		tester.expectAndPrint("interval set should have size of 3", [&intervalSet]() {
+			intervalSet.push(0);
+			intervalSet.push(1);
+			intervalSet.push(2);
+			intervalSet.push(4);
+			intervalSet.push(5);
+			intervalSet.push(6);
+			intervalSet.push(8);
+			intervalSet.push(9);
+			intervalSet.push(10);
+			return intervalSet.size() == 3;
+		}, [&intervalSet]() -> std::string {
 			std::stringstream ss;
-			ss << "expected " << collectingQueue.size() << " to equal 3";
+			ss << "expected " << intervalSet.size() << " to equal 3";
 			return ss.str();
 		});
 
 		rgle::util::Range<size_t> range;
 
-		tester.expectAndPrint("collecting queue pop should return top of queue", [&collectingQueue, &range]() {
-			collectingQueue.clear();
-			collectingQueue.push(0);
-			collectingQueue.push(1);
-			collectingQueue.push(2);
-			range = collectingQueue.pop();
-			return range.lower == 0 && range.upper == 3 && collectingQueue.size() == 0;
-		}, [&collectingQueue, &range]() -> std::string {
+		tester.expectAndPrint("interval set pop should return the highest range", [&intervalSet, &range]() {
+			intervalSet.clear();
+			intervalSet.push(0);
+			intervalSet.push(1);
+			intervalSet.push(2);
+			range = intervalSet.pop();
+			return range.lower == 0 && range.upper == 3 && intervalSet.size() == 0;
+		}, [&intervalSet, &range]() -> std::string {
 			std::stringstream ss;
-			if (collectingQueue.size() == 0)
-				ss << "expected " << collectingQueue.size() << " to equal 0";
+			if (intervalSet.size() == 0)
+				ss << "expected " << intervalSet.size() << " to equal 0";
 			else
 				ss << "expected {" << range.lower << ", " << range.upper << "} to equal {0, 3}";
 			return ss.str();
@@ -68,28 +68,28 @@ int main() {
 		rgle::util::Range<size_t> second;
 		rgle::util::Range<size_t> third;
 
-		tester.expectAndPrint("collecting queue should have correct ordering", [&collectingQueue, &first, &second, &third]() {
-			collectingQueue.clear();
-			collectingQueue.push(9);
-			collectingQueue.push(0);
-			collectingQueue.push(10);
-			collectingQueue.push(2);
-			collectingQueue.push(1);
-			collectingQueue.push(6);
-			collectingQueue.push(8);
-			collectingQueue.push(5);
-			collectingQueue.push(4);
-			first = collectingQueue.pop();
-			second = collectingQueue.pop();
-			third = collectingQueue.pop();
+		tester.expectAndPrint("interval set should have correct ordering", [&intervalSet, &first, &second, &third]() {
+			intervalSet.clear();
+			intervalSet.push(9);
+			intervalSet.push(0);
+			intervalSet.push(10);
+			intervalSet.push(2);
+			intervalSet.push(1);
+			intervalSet.push(6);
+			intervalSet.push(8);
+			intervalSet.push(5);
+			intervalSet.push(4);
+			first = intervalSet.pop();
+			second = intervalSet.pop();
+			third = intervalSet.pop();
 			return first.lower == 8 &&
 				first.upper == 11 &&
 				second.lower == 4 &&
 				second.upper == 7 &&
 				third.lower == 0 &&
 				third.upper == 3 &&
-				collectingQueue.size() == 0;
-		}, [&collectingQueue, &first, &second, &third]() -> std::string {
+				intervalSet.size() == 0;
+		}, [&intervalSet, &first, &second, &third]() -> std::string {
 			std::stringstream ss;
 			if (first.lower != 8 || first.upper != 11)
 				ss << "expected {" << first.lower << ", " << first.upper << "} to equal {8, 11}";
@@ -98,8 +98,22 @@ int main() {
 			else if (third.lower != 0 || third.upper != 3)
 				ss << "expected {" << second.lower << ", " << second.upper << "} to equal {0, 3}";
 			else
-				ss << "expected " << collectingQueue.size() << " to equal 0";
+				ss << "expected " << intervalSet.size() << " to equal 0";
 			return ss.str();
 		});
+
+		tester.expect("interval set should merge overlapping ranges and iterate them in order", [&intervalSet]() {
+			intervalSet.clear();
+			intervalSet.insert({ 10, 20 });
+			intervalSet.insert({ 30, 40 });
+			intervalSet.insert({ 50, 60 });
+			intervalSet.insert({ 15, 35 });
+			intervalSet.insert({ 60, 62 });
+			intervalSet.insert({ 52, 55 });
+			std::vector<rgle::util::Range<size_t>> ranges(intervalSet.begin(), intervalSet.end());
+			return ranges.size() == 2 && ranges[0].lower == 10 && ranges[0].upper == 40
+				&& ranges[1].lower == 50 && ranges[1].upper == 62
+				&& intervalSet.contains(39) && !intervalSet.contains(40) && !intervalSet.contains(9);
+		});
 	});
 }
\ No newline at end of file